@@ -0,0 +1,60 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+// bench 是单线程的，不需要原子操作
+size_t allocatedBytes  = 0;
+size_t allocationCount = 0;
+}   // namespace
+
+AllocStats currentAllocStats()
+{
+    return {allocatedBytes, allocationCount};
+}
+
+void reportAllocations(benchmark::State& state, const AllocStats& before)
+{
+    AllocStats after  = currentAllocStats();
+    auto       bytes  = static_cast<double>(after.bytes - before.bytes);
+    auto       allocs = static_cast<double>(after.count - before.count);
+
+    state.counters["heap_bytes"]  = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+    state.counters["heap_allocs"] = benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+}
+
+void* operator new(size_t size)
+{
+    allocatedBytes += size;
+    allocationCount++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
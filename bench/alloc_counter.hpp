@@ -0,0 +1,19 @@
+#ifndef BENCH_ALLOC_COUNTER_HPP
+#define BENCH_ALLOC_COUNTER_HPP
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+
+// 替换全局 operator new 统计堆分配，bench 进程内全局生效
+struct AllocStats
+{
+    size_t bytes = 0;
+    size_t count = 0;
+};
+
+AllocStats currentAllocStats();
+
+// 以每次迭代的平均值报告 before 之后的堆分配量（heap_bytes / heap_allocs）
+void reportAllocations(benchmark::State& state, const AllocStats& before);
+
+#endif   // BENCH_ALLOC_COUNTER_HPP
@@ -0,0 +1,129 @@
+#include "corpus.hpp"
+
+#include "utils/process.hpp"
+
+#include <string>
+
+namespace {
+
+std::string className(int hierarchy, int level)
+{
+    return "H" + std::to_string(hierarchy) + "L" + std::to_string(level);
+}
+
+// 方法体：局部变量、算术/比较/逻辑表达式、分支、对 self 字段和方法的访问交替出现
+void emitMethodBody(std::string& out, int level, int method, int statements)
+{
+    auto field = "f" + std::to_string(level);
+    out += "        var acc:int = a;\n";
+    for (int s = 0; s < statements; s++) {
+        auto k = std::to_string(s);
+        switch (s % 5) {
+            case 0:
+                out += "        var x" + k + ":int = (a + b * " + k + " - " + field +
+                       " / 2) % 7 + f0;\n";
+                break;
+            case 1:
+                out += "        val c" + k + " = a < b && b <= " + field + " || !(acc == " + k +
+                       ");\n";
+                break;
+            case 2:
+                out += "        if (acc > " + k + ") {\n            acc = acc - " + field +
+                       " * 3;\n        } else {\n            acc = acc + b;\n        }\n";
+                break;
+            case 3:
+                if (method > 0) {
+                    out += "        acc = acc + self.m" + std::to_string(level) + "_" +
+                           std::to_string(method - 1) + "(a, acc);\n";
+                }
+                else {
+                    out += "        acc = acc + self.area();\n";
+                }
+                break;
+            default:
+                out += "        acc = -acc * (" + k + " + a) - (b - acc) * (acc + 1);\n";
+                break;
+        }
+    }
+    out += "        return acc;\n";
+}
+
+void emitClass(std::string& out, const CorpusOptions& options, int hierarchy, int level)
+{
+    auto param = "p" + std::to_string(level);
+    auto field = "f" + std::to_string(level);
+
+    out += "class " + className(hierarchy, level) + "(" + param + ":int)";
+    if (level > 0) {
+        out += " inherits " + className(hierarchy, level - 1) + "(" + param + " + 1)";
+    }
+    out += " {\n";
+    out += "    var " + field + ":int = " + std::to_string(level + 1) + ";\n";
+
+    // 每一层都覆盖 area，形成深度为 depth 的虚调用链
+    out += "    fn area() -> int {\n        return " + param + " * " + field + " + f0;\n    }\n";
+
+    for (int m = 0; m < options.methodsPerClass; m++) {
+        out += "    fn m" + std::to_string(level) + "_" + std::to_string(m) +
+               "(a:int, b:int) -> int {\n";
+        emitMethodBody(out, level, m, options.statementsPerMethod);
+        out += "    }\n";
+    }
+    out += "}\n\n";
+}
+
+void emitFunction(std::string& out, const CorpusOptions& options, int index)
+{
+    int  hierarchy = index % options.hierarchies;
+    auto leaf      = className(hierarchy, options.depth - 1);
+
+    out += "fn g" + std::to_string(index) + "(a:int, b:int) -> int {\n";
+    out += "    var acc:int = a;\n";
+    out += "    val o = " + leaf + "(a);\n";
+    out += "    val root:" + className(hierarchy, 0) + " = o;\n";
+    for (int s = 0; s < options.statementsPerMethod; s++) {
+        auto k = std::to_string(s);
+        switch (s % 3) {
+            case 0: out += "    acc = acc + o.area() * " + k + " - root.area();\n"; break;
+            case 1:
+                out += "    acc = (acc + b * " + k + " - a / 3) % 11 + o.m0_0(a, acc);\n";
+                break;
+            default:
+                out += "    if (acc < b || a == " + k + ") {\n        acc = acc + " + k +
+                       ";\n    }\n";
+                break;
+        }
+    }
+    out += "    return acc;\n}\n\n";
+}
+
+}   // namespace
+
+std::string generateCorpus(const CorpusOptions& options)
+{
+    std::string out;
+    for (int h = 0; h < options.hierarchies; h++) {
+        for (int d = 0; d < options.depth; d++) {
+            emitClass(out, options, h, d);
+        }
+    }
+    for (int f = 0; f < options.functions; f++) {
+        emitFunction(out, options, f);
+    }
+    if (options.functions > 0) {
+        out += "fn main() -> int {\n    return g0(1, 2);\n}\n";
+    }
+    return out;
+}
+
+std::vector<std::pair<std::string, std::string>> loadStdSources()
+{
+    std::vector<std::string> files;
+    collectLibFiles(WATERMELON_STD_DIR, ".wm", files);
+
+    std::vector<std::pair<std::string, std::string>> sources;
+    for (const auto& file : files) {
+        sources.emplace_back(file, readFile(file));
+    }
+    return sources;
+}
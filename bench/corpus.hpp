@@ -0,0 +1,24 @@
+#ifndef BENCH_CORPUS_HPP
+#define BENCH_CORPUS_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// 合成 .wm 语料的规模参数
+struct CorpusOptions
+{
+    int hierarchies         = 100;   // 互不相关的继承链条数
+    int depth               = 10;    // 每条继承链的深度
+    int methodsPerClass     = 4;     // 每个类新增的方法数（另有一个逐层覆盖的 area 方法）
+    int statementsPerMethod = 20;    // 每个方法体的语句数
+    int functions           = 50;    // 顶层函数数
+};
+
+// 生成能通过语义分析的合成源码：多条深继承链、长方法体、表达式密集的语句
+std::string generateCorpus(const CorpusOptions& options);
+
+// 读取源码树中的标准库（.wm），语义分析依赖其中的 Object 等声明
+std::vector<std::pair<std::string, std::string>> loadStdSources();
+
+#endif   // BENCH_CORPUS_HPP
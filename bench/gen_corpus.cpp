@@ -0,0 +1,27 @@
+#include "corpus.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// 把合成语料写到标准输出，便于直接交给 watermelon 做端到端的计时和 profile
+// 用法: watermelon_gen_corpus [hierarchies] [depth] [methods] [statements] [functions]
+int main(int argc, char* argv[])
+{
+    CorpusOptions options;
+    int*          fields[] = {&options.hierarchies,
+                              &options.depth,
+                              &options.methodsPerClass,
+                              &options.statementsPerMethod,
+                              &options.functions};
+    for (int i = 1; i < argc && i <= 5; i++) {
+        *fields[i - 1] = std::atoi(argv[i]);
+    }
+    if (options.hierarchies <= 0 || options.depth <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [hierarchies] [depth] [methods] [statements] [functions]" << std::endl;
+        return 1;
+    }
+    std::cout << generateCorpus(options);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include "alloc_counter.hpp"
+#include "corpus.hpp"
+#include "lexer/lexer.hpp"
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+// range(0): 继承链条数, range(1): 继承深度
+void BM_LexCorpus(benchmark::State& state)
+{
+    CorpusOptions options;
+    options.hierarchies     = static_cast<int>(state.range(0));
+    options.depth           = static_cast<int>(state.range(1));
+    const std::string source = generateCorpus(options);
+
+    size_t     tokens = 0;
+    AllocStats before = currentAllocStats();
+    for (auto _ : state) {
+        Lexer lexer(source, "corpus.wm");
+        auto [result, error] = lexer.tokenize();
+        if (error) {
+            state.SkipWithError("lex error");
+            break;
+        }
+        tokens += result.size();
+        benchmark::DoNotOptimize(result);
+    }
+    reportAllocations(state, before);
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(source.size()));
+    state.counters["tokens"] =
+        benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_LexCorpus)->Args({100, 10})->Args({20, 50})->Unit(benchmark::kMillisecond);
+
+}   // namespace
@@ -0,0 +1,97 @@
+#include "alloc_counter.hpp"
+#include "corpus.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token_stream.hpp"
+#include "parser/parser.hpp"
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+// 生成表达式密集的源码：每个函数体由大量算术/比较/逻辑表达式组成
+std::string makeExpressionSource(int functions, int statementsPerFunction)
+{
+    std::string source;
+    for (int f = 0; f < functions; f++) {
+        source += "fn f" + std::to_string(f) + "(a:int, b:int, c:int, d:bool) -> int {\n";
+        source += "    var x:int = 0;\n";
+        for (int s = 0; s < statementsPerFunction; s++) {
+            auto k = std::to_string(s);
+            switch (s % 4) {
+                case 0: source += "    x = (a + b * " + k + " - c / 2) % 7 + x;\n"; break;
+                case 1:
+                    source += "    val y" + k + " = a < b && b <= c || !d && x != " + k + ";\n";
+                    break;
+                case 2: source += "    x = -x * (" + k + " + a) - (b - c) * (c + 1);\n"; break;
+                default: source += "    foo(1, 2, " + k + ", a + 1, \"s\", true, x * 2);\n"; break;
+            }
+        }
+        source += "    return x;\n}\n";
+    }
+    return source;
+}
+
+// 只有字面量的长参数列表，单个 primary 表达式的解析开销占主导
+std::string makeLiteralSource(int statements)
+{
+    std::string source = "fn g() -> void {\n";
+    for (int s = 0; s < statements; s++) {
+        source += "    foo(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);\n";
+    }
+    source += "}\n";
+    return source;
+}
+
+// 报告 bytes/s、nodes/s（Arena 中分配的节点数）以及每次解析的 Arena 和堆分配量
+void runParse(benchmark::State& state, const std::string& source)
+{
+    size_t     nodes      = 0;
+    size_t     arenaBytes = 0;
+    AllocStats before     = currentAllocStats();
+    for (auto _ : state) {
+        Parser parser{TokenStream(Lexer(source, "bench.wm"))};
+        auto [program, error] = parser.parse();
+        if (error) {
+            state.SkipWithError("parse error");
+            break;
+        }
+        nodes += program->arena.getObjectCount();
+        arenaBytes += program->arena.getBytesAllocated();
+        benchmark::DoNotOptimize(program);
+    }
+    reportAllocations(state, before);
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(source.size()));
+    state.counters["nodes"] =
+        benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+    state.counters["arena_bytes"] =
+        benchmark::Counter(static_cast<double>(arenaBytes), benchmark::Counter::kAvgIterations);
+}
+
+void BM_ParseExpressions(benchmark::State& state)
+{
+    const std::string source = makeExpressionSource(static_cast<int>(state.range(0)), 200);
+    runParse(state, source);
+}
+BENCHMARK(BM_ParseExpressions)->Arg(20)->Unit(benchmark::kMillisecond);
+
+void BM_ParseLiterals(benchmark::State& state)
+{
+    const std::string source = makeLiteralSource(static_cast<int>(state.range(0)));
+    runParse(state, source);
+}
+BENCHMARK(BM_ParseLiterals)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+// range(0): 继承链条数, range(1): 继承深度
+void BM_ParseCorpus(benchmark::State& state)
+{
+    CorpusOptions options;
+    options.hierarchies = static_cast<int>(state.range(0));
+    options.depth       = static_cast<int>(state.range(1));
+    runParse(state, generateCorpus(options));
+}
+BENCHMARK(BM_ParseCorpus)->Args({100, 10})->Args({20, 50})->Unit(benchmark::kMillisecond);
+
+}   // namespace
@@ -0,0 +1,76 @@
+#include "alloc_counter.hpp"
+#include "corpus.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/token_stream.hpp"
+#include "parser/parser.hpp"
+#include "semantic/semantic.hpp"
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::unique_ptr<Program> parseWithStd(
+    const std::vector<std::pair<std::string, std::string>>& stdSources, const std::string& source)
+{
+    std::vector<Lexer> lexers;
+    for (const auto& [filename, text] : stdSources) {
+        lexers.emplace_back(text, filename);
+    }
+    lexers.emplace_back(source, "corpus.wm");
+
+    Parser parser{TokenStream(std::move(lexers))};
+    auto [program, error] = parser.parse();
+    if (error) return nullptr;
+    return std::move(program);
+}
+
+// 只计时语义分析：每次迭代先在暂停计时的状态下重新解析（analyze 会消耗 Program）
+// range(0): 继承链条数, range(1): 继承深度
+void BM_AnalyzeCorpus(benchmark::State& state)
+{
+    CorpusOptions options;
+    options.hierarchies = static_cast<int>(state.range(0));
+    options.depth       = static_cast<int>(state.range(1));
+    const std::string source     = generateCorpus(options);
+    const auto        stdSources = loadStdSources();
+
+    size_t     nodes = 0;
+    AllocStats heap;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto program = parseWithStd(stdSources, source);
+        if (program == nullptr) {
+            state.SkipWithError("parse error");
+            break;
+        }
+        nodes += program->arena.getObjectCount();
+        AllocStats before = currentAllocStats();
+        state.ResumeTiming();
+
+        SemanticAnalyzer analyzer(std::move(program));
+        auto [resolved, error] = analyzer.analyze();
+
+        state.PauseTiming();
+        if (error) {
+            state.SkipWithError("semantic error");
+            break;
+        }
+        AllocStats after = currentAllocStats();
+        heap.bytes += after.bytes - before.bytes;
+        heap.count += after.count - before.count;
+        resolved.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["nodes"] =
+        benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+    state.counters["heap_bytes"] =
+        benchmark::Counter(static_cast<double>(heap.bytes), benchmark::Counter::kAvgIterations);
+    state.counters["heap_allocs"] =
+        benchmark::Counter(static_cast<double>(heap.count), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_AnalyzeCorpus)->Args({100, 10})->Args({20, 50})->Unit(benchmark::kMillisecond);
+
+}   // namespace
@@ -87,4 +87,5 @@ public:
     void  start(void* stk);
     void  stop();
     void* alloc(size_t size);
+    void* allocUninit(size_t size);
 };
@@ -354,6 +354,17 @@ void* GC::alloc(size_t size)
     return ptr;
 }
 
+// 不清零：调用者保证在对象可能被读到之前写完所有字段。
+// addPtr 中可能发生回收，扫描到尚未写入的内容只会多保留一些对象
+void* GC::allocUninit(size_t size)
+{
+    void* ptr = malloc(size);
+    if (ptr != nullptr) {
+        addPtr(ptr, size);
+    }
+    return ptr;
+}
+
 static GC gc;
 
 extern "C" {
@@ -372,6 +383,11 @@ void* gc_alloc(size_t size)
     return gc.alloc(size);
 }
 
+void* gc_alloc_uninit(size_t size)
+{
+    return gc.allocUninit(size);
+}
+
 extern int builtin_main();
 
 }
@@ -0,0 +1,130 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Arena 中一段连续存放的元素，不拥有内存，生命周期与所属 Arena 相同
+template<typename T> class ArenaSpan
+{
+private:
+    T*     elements = nullptr;
+    size_t count    = 0;
+
+public:
+    ArenaSpan() = default;
+    ArenaSpan(T* elements, size_t count)
+        : elements(elements)
+        , count(count)
+    {
+    }
+
+    T*     begin() const { return elements; }
+    T*     end() const { return elements + count; }
+    size_t size() const { return count; }
+    bool   empty() const { return count == 0; }
+    T&     operator[](size_t index) const { return elements[index]; }
+    T&     front() const { return elements[0]; }
+    T&     back() const { return elements[count - 1]; }
+};
+
+// bump-pointer 分配器：AST 节点按分配顺序紧密排列，整棵树随 Arena 一次性释放。
+// 只有持有堆内存的对象（如 std::string 成员）才会登记析构函数，平凡类型不产生任何记录。
+class Arena
+{
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Destructor
+    {
+        void*  object;
+        size_t count;
+        void (*destroy)(void*, size_t);
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::vector<Destructor>                   destructors;
+    std::byte*                                cursor         = nullptr;
+    std::byte*                                limit          = nullptr;
+    size_t                                    bytesAllocated = 0;
+    size_t                                    objectCount    = 0;
+
+    template<typename T> static void destroyObjects(void* object, size_t count)
+    {
+        T* elements = static_cast<T*>(object);
+        for (size_t i = 0; i < count; i++) {
+            elements[i].~T();
+        }
+    }
+
+    void* allocateSlow(size_t size, size_t align)
+    {
+        size_t blockSize = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+        blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[blockSize]));
+        cursor = blocks.back().get();
+        limit  = cursor + blockSize;
+        return allocate(size, align);
+    }
+
+    template<typename T> void registerDestructor(T* object, size_t count)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back({object, count, &destroyObjects<T>});
+        }
+    }
+
+public:
+    Arena()                        = default;
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena()
+    {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+            it->destroy(it->object, it->count);
+        }
+    }
+
+    void* allocate(size_t size, size_t align)
+    {
+        auto address = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(align - 1);
+        if (cursor == nullptr || address + size > reinterpret_cast<uintptr_t>(limit)) {
+            return allocateSlow(size, align);
+        }
+        cursor = reinterpret_cast<std::byte*>(address + size);
+        bytesAllocated += size;
+        return reinterpret_cast<void*>(address);
+    }
+
+    template<typename T, typename... Args> T* create(Args&&... args)
+    {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        registerDestructor(object, 1);
+        objectCount++;
+        return object;
+    }
+
+    // 把解析时临时收集的元素搬进 Arena
+    template<typename T> ArenaSpan<T> copySpan(std::vector<T>&& items)
+    {
+        if (items.empty()) {
+            return ArenaSpan<T>();
+        }
+        T* elements = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+        for (size_t i = 0; i < items.size(); i++) {
+            new (elements + i) T(std::move(items[i]));
+        }
+        registerDestructor(elements, items.size());
+        return ArenaSpan<T>(elements, items.size());
+    }
+
+    size_t getBytesAllocated() const { return bytesAllocated; }
+    size_t getObjectCount() const { return objectCount; }
+    size_t getBlockCount() const { return blocks.size(); }
+};
+
+#endif   // ARENA_HPP
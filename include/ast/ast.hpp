@@ -1,11 +1,15 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include "ast/arena.hpp"
+#include "utils/casting.hpp"
 #include "utils/error.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -24,6 +28,42 @@ class Expression;
 class Statement;
 class Declaration;
 
+// 节点种类标签，配合 utils/casting.hpp 中的 isa/dyn_cast/cast 使用
+enum class NodeKind
+{
+    LITERAL_EXPR,
+    IDENTIFIER_EXPR,
+    BINARY_EXPR,
+    UNARY_EXPR,
+    CALL_EXPR,
+    MEMBER_EXPR,
+    METHOD_CALL_EXPR,
+    ARRAY_EXPR,
+    LAMBDA_EXPR,
+    TYPE_CHECK_EXPR,
+
+    EXPRESSION_STMT,
+    BLOCK_STMT,
+    IF_STMT,
+    WHEN_STMT,
+    FOR_STMT,
+    RETURN_STMT,
+    VARIABLE_STMT,
+
+    // Declaration 也是 Statement，FIRST_DECL..LAST_DECL 之间的都是 Declaration
+    FUNCTION_DECL,
+    ENUM_DECL,
+    CLASS_DECL,
+    FIRST_DECL = FUNCTION_DECL,
+    LAST_DECL  = CLASS_DECL,
+
+    PROPERTY_MEMBER,
+    METHOD_MEMBER,
+    INIT_BLOCK_MEMBER,
+};
+
+// Type 是指向全局类型表条目的句柄：每个不同的 (kind, name) 只驻留一次，
+// 比较和哈希都只是指针操作，拷贝 Type 也不会再拷贝类型名字符串
 class Type
 {
 public:
@@ -36,58 +76,99 @@ public:
         BOOL,
         STR,
         CLASS,
+        ENUM,
         FUNCTION
     };
-    Kind        kind;
-    std::string name;
-    static Type builtinVoid() { return Type(Kind::VOID, "void"); }
-    static Type builtinInt() { return Type(Kind::INT, "int"); }
-    static Type builtinFloat() { return Type(Kind::FLOAT, "float"); }
-    static Type builtinBool() { return Type(Kind::BOOL, "bool"); }
-    static Type builtinStr() { return Type(Kind::STR, "str"); }
-    static Type classType(const std::string& name) { return Type(Kind::CLASS, name); }
-    static Type functionType(const std::string& name) { return Type(Kind::FUNCTION, name); }
-
-    bool isBool() const { return kind == Kind::BOOL; }
-    bool isVoid() const { return kind == Kind::VOID; }
-    bool isStr() const { return kind == Kind::STR; }
-    bool canMathOp() const { return kind == Kind::INT || kind == Kind::FLOAT; }
-    bool canCompare() const { return kind == Kind::INT || kind == Kind::FLOAT; }
-
-    bool operator==(const Type& other) const { return kind == other.kind && name == other.name; }
-    bool operator!=(const Type& other) const { return !(*this == other); }
 
-    std::string dump(const std::string& prefix = "", bool isLast = true) const
+private:
+    struct Info
+    {
+        Kind        kind;
+        std::string name;
+    };
+    const Info* info;
+
+    explicit Type(const Info* info)
+        : info(info)
     {
-        return prefix + (prefix.empty() ? "" : (isLast ? "'---" : "|---")) + "Type: " + name;
     }
-    std::string getName() const { return name; }
 
-    Type(Kind kind, std::string name)
-        : kind(kind)
-        , name(std::move(name)){};
+    static const Info* intern(Kind kind, const std::string& name)
+    {
+        // unordered_map 的节点地址稳定，可以直接把条目地址当作句柄
+        static std::unordered_map<std::string, Info> tables[static_cast<size_t>(Kind::FUNCTION) + 1];
+        auto& table = tables[static_cast<size_t>(kind)];
+        auto  it    = table.find(name);
+        if (it == table.end()) {
+            it = table.emplace(name, Info{kind, name}).first;
+        }
+        return &it->second;
+    }
+    static Type builtin(Kind kind, const char* name)
+    {
+        return Type(intern(kind, name));
+    }
 
-    Type(std::string name)
-        : name(std::move(name))
+public:
+    static Type builtinVoid()
     {
-        if (name == "void")
-            kind = Kind::VOID;
-        else if (name == "int")
-            kind = Kind::INT;
-        else if (name == "float")
-            kind = Kind::FLOAT;
-        else if (name == "bool")
-            kind = Kind::BOOL;
-        else if (name == "str")
-            kind = Kind::STR;
-        else
-            kind = Kind::CLASS;
+        static const Type type = builtin(Kind::VOID, "void");
+        return type;
     }
+    static Type builtinInt()
+    {
+        static const Type type = builtin(Kind::INT, "int");
+        return type;
+    }
+    static Type builtinFloat()
+    {
+        static const Type type = builtin(Kind::FLOAT, "float");
+        return type;
+    }
+    static Type builtinBool()
+    {
+        static const Type type = builtin(Kind::BOOL, "bool");
+        return type;
+    }
+    static Type builtinStr()
+    {
+        static const Type type = builtin(Kind::STR, "str");
+        return type;
+    }
+    static Type classType(const std::string& name) { return Type(intern(Kind::CLASS, name)); }
+    static Type enumType(const std::string& name) { return Type(intern(Kind::ENUM, name)); }
+    static Type functionType(const std::string& name) { return Type(intern(Kind::FUNCTION, name)); }
+
+    Kind               getKind() const { return info->kind; }
+    const std::string& getName() const { return info->name; }
+
+    bool isBool() const { return info->kind == Kind::BOOL; }
+    bool isVoid() const { return info->kind == Kind::VOID; }
+    bool isStr() const { return info->kind == Kind::STR; }
+    bool isEnum() const { return info->kind == Kind::ENUM; }
+    bool isEmpty() const { return info->kind == Kind::EMPTY; }
+    bool canMathOp() const { return info->kind == Kind::INT || info->kind == Kind::FLOAT; }
+    bool canCompare() const { return info->kind == Kind::INT || info->kind == Kind::FLOAT; }
+
+    bool operator==(const Type& other) const { return info == other.info; }
+    bool operator!=(const Type& other) const { return info != other.info; }
+
+    std::string dump(const std::string& prefix = "", bool isLast = true) const
+    {
+        return prefix + (prefix.empty() ? "" : (isLast ? "'---" : "|---")) + "Type: " + getName();
+    }
+
     Type()
-        : kind(Kind::EMPTY)
-        , name("none")
+        : info(builtinEmpty().info)
     {
     }
+
+private:
+    static Type builtinEmpty()
+    {
+        static const Type type = builtin(Kind::EMPTY, "none");
+        return type;
+    }
 };
 
 namespace std {
@@ -95,27 +176,68 @@ template<> struct hash<Type>
 {
     std::size_t operator()(const Type& type) const noexcept
     {
-        return std::hash<std::string>{}(type.getName());
+        return std::hash<const void*>{}(&type.getName());
     }
 };
 }   // namespace std
 
+// 语义分析阶段为标识符和成员访问解析出的绑定，IRGen 直接按下标取用，不再按名字查表
+struct Binding
+{
+    enum class Kind
+    {
+        NONE,
+        LOCAL,        // 当前函数的局部变量槽位
+        FIELD,        // 字段，下标对应 ClassLayout::fields
+        METHOD,       // 方法，下标对应 ClassLayout::methods
+        FUNCTION,     // 顶层函数编号
+        CLASS,        // 类编号，即继承树上的先序编号
+        ENUM,         // 枚举编号
+        ENUM_VALUE,   // 枚举值在声明中的序号，即它的整数值
+        SELF,
+    };
+
+    Kind kind  = Kind::NONE;
+    int  index = -1;
+};
+
+// 语义分析推断的函数副作用，按位组合，IRGen 据此生成 readnone/readonly 等函数属性
+namespace Effects {
+enum : uint8_t
+{
+    NONE           = 0,
+    READS_MEMORY   = 1 << 0,
+    WRITES_MEMORY  = 1 << 1,
+    ALLOCATES      = 1 << 2,   // 经 gc_alloc 分配对象或字符串
+    IO             = 1 << 3,
+    NON_ARG_MEMORY = 1 << 4,   // 访问了参数（含 self）所指对象之外的内存
+    MAY_DIVERGE    = 1 << 5,   // 含循环或递归，可能不返回
+    ALL            = (1 << 6) - 1,
+};
+}   // namespace Effects
+
 class Expression
 {
+private:
+    NodeKind nodeKind;
+
 protected:
     Location location;
     Type     type;
 
 public:
-    Expression(Location l)
-        : location(l)
+    Expression(NodeKind k, Location l)
+        : nodeKind(k)
+        , location(l)
     {
     }
-    Expression(Location l, Type t)
-        : location(l)
+    Expression(NodeKind k, Location l, Type t)
+        : nodeKind(k)
+        , location(l)
         , type(t)
     {
     }
+    NodeKind getNodeKind() const { return nodeKind; }
     Location getLocation() const { return location; }
     Type     getType() const { return type; }
     void     setType(Type t) { type = t; }
@@ -131,14 +253,19 @@ public:
     explicit LiteralExpression(Location location, Type type,
                                std::variant<int, float, bool, std::string> value)
         : value(std::move(value))
-        , Expression(location, type)
+        , Expression(NodeKind::LITERAL_EXPR, location, type)
     {
     }
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::LITERAL_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string kindStr, s;
-        switch (type.kind) {
+        switch (type.getKind()) {
             case Type::Kind::INT:
                 kindStr = "INT";
                 s       = std::to_string(std::get<int>(value));
@@ -168,14 +295,20 @@ class IdentifierExpression : public Expression
 {
 public:
     std::string name;
+    Binding     binding;
 
     explicit IdentifierExpression(Location location, std::string name)
         : name(std::move(name))
-        , Expression(location)
+        , Expression(NodeKind::IDENTIFIER_EXPR, location)
     {
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::IDENTIFIER_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         return getTreePrefix(prefix, isLast) + "IdentifierExpression: " + name +
@@ -204,20 +337,24 @@ public:
         ASSIGN
     };
 
-    Operator                    op;
-    std::unique_ptr<Expression> left;
-    std::unique_ptr<Expression> right;
+    Operator    op;
+    Expression* left;
+    Expression* right;
 
-    BinaryExpression(Location location, Operator op, std::unique_ptr<Expression> left,
-                     std::unique_ptr<Expression> right)
+    BinaryExpression(Location location, Operator op, Expression* left, Expression* right)
         : op(op)
-        , left(std::move(left))
-        , right(std::move(right))
-        , Expression(location)
+        , left(left)
+        , right(right)
+        , Expression(NodeKind::BINARY_EXPR, location)
     {
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::BINARY_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string opStr;
@@ -256,17 +393,22 @@ public:
         NOT
     };
 
-    Operator                    op;
-    std::unique_ptr<Expression> operand;
+    Operator    op;
+    Expression* operand;
 
-    UnaryExpression(Location location, Operator op, std::unique_ptr<Expression> operand)
+    UnaryExpression(Location location, Operator op, Expression* operand)
         : op(op)
-        , operand(std::move(operand))
-        , Expression(location)
+        , operand(operand)
+        , Expression(NodeKind::UNARY_EXPR, location)
     {
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::UNARY_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string opStr  = (op == Operator::NEG) ? "-" : "!";
@@ -281,18 +423,24 @@ class CallExpression : public Expression
 {
     // function call & class init
 public:
-    std::unique_ptr<Expression>              callee;
-    std::vector<std::unique_ptr<Expression>> arguments;
+    Expression*            callee;
+    ArenaSpan<Expression*> arguments;
+    // 逃逸分析：构造出的对象不会逃出当前函数，可以分配在栈上
+    bool stackAllocated = false;
 
-    CallExpression(Location location, std::unique_ptr<Expression> callee,
-                   std::vector<std::unique_ptr<Expression>> arguments)
-        : callee(std::move(callee))
-        , arguments(std::move(arguments))
-        , Expression(location)
+    CallExpression(Location location, Expression* callee, ArenaSpan<Expression*> arguments)
+        : callee(callee)
+        , arguments(arguments)
+        , Expression(NodeKind::CALL_EXPR, location)
     {
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::CALL_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result =
@@ -325,30 +473,40 @@ public:
         METHOD,
     };
 
-    std::unique_ptr<Expression>              object;
-    std::string                              property;
-    std::string                              methodName;
-    std::vector<std::unique_ptr<Expression>> arguments;
-    Kind                                     kind;
-
-    MemberExpression(Location location, std::unique_ptr<Expression> object, std::string property)
-        : object(std::move(object))
+    Expression*            object;
+    std::string            property;
+    std::string            methodName;
+    ArenaSpan<Expression*> arguments;
+    Kind                   kind;
+    Binding                binding;
+    // 类层次分析：接收者的静态类型及其所有子类都解析到同一实现时可以直接调用
+    bool monomorphic = false;
+    // 经虚表调用时所有可能实现的副作用之并
+    uint8_t effects = Effects::ALL;
+
+    MemberExpression(Location location, Expression* object, std::string property)
+        : object(object)
         , property(std::move(property))
-        , Expression(location)
+        , Expression(NodeKind::MEMBER_EXPR, location)
     {
         kind = Kind::PROPERTY;
     }
-    MemberExpression(Location location, std::unique_ptr<Expression> object, std::string methodName,
-                     std::vector<std::unique_ptr<Expression>> arguments)
-        : object(std::move(object))
+    MemberExpression(Location location, Expression* object, std::string methodName,
+                     ArenaSpan<Expression*> arguments)
+        : object(object)
         , methodName(std::move(methodName))
-        , arguments(std::move(arguments))
-        , Expression(location)
+        , arguments(arguments)
+        , Expression(NodeKind::MEMBER_EXPR, location)
     {
         kind = Kind::METHOD;
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::MEMBER_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string kindStr    = (kind == Kind::PROPERTY) ? "PROPERTY" : "METHOD";
@@ -378,19 +536,24 @@ public:
 class MethodCallExpression : public Expression
 {
 public:
-    std::unique_ptr<Expression>              object;
-    std::string                              methodName;
-    std::vector<std::unique_ptr<Expression>> arguments;
+    Expression*            object;
+    std::string            methodName;
+    ArenaSpan<Expression*> arguments;
 
-    MethodCallExpression(Location location, std::unique_ptr<Expression> object,
-                         std::string methodName, std::vector<std::unique_ptr<Expression>> arguments)
-        : object(std::move(object))
+    MethodCallExpression(Location location, Expression* object, std::string methodName,
+                         ArenaSpan<Expression*> arguments)
+        : object(object)
         , methodName(std::move(methodName))
-        , arguments(std::move(arguments))
-        , Expression(location)
+        , arguments(arguments)
+        , Expression(NodeKind::METHOD_CALL_EXPR, location)
     {
     }
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::METHOD_CALL_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result = getTreePrefix(prefix, isLast) + "MethodCallExpression: " + methodName +
@@ -417,12 +580,17 @@ public:
 class ArrayExpression : public Expression
 {
 public:
-    std::vector<std::unique_ptr<Expression>> elements;
+    ArenaSpan<Expression*> elements;
+
+    explicit ArrayExpression(Location location, ArenaSpan<Expression*> elements)
+        : elements(elements)
+        , Expression(NodeKind::ARRAY_EXPR, location)
+    {
+    }
 
-    explicit ArrayExpression(Location location, std::vector<std::unique_ptr<Expression>> elements)
-        : elements(std::move(elements))
-        , Expression(location)
+    static bool classof(const Expression* node)
     {
+        return node->getNodeKind() == NodeKind::ARRAY_EXPR;
     }
 
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
@@ -436,22 +604,26 @@ class LambdaExpression : public Expression
 public:
     struct Parameter
     {
-        std::string           name;
-        std::unique_ptr<Type> type;
+        std::string name;
+        Type*       type;
     };
 
-    std::vector<Parameter>      parameters;
-    std::unique_ptr<Expression> body;
+    ArenaSpan<Parameter> parameters;
+    Expression*          body;
 
-    LambdaExpression(Location location, std::vector<Parameter> parameters,
-                     std::unique_ptr<Expression> body)
-        : parameters(std::move(parameters))
-        , body(std::move(body))
-        , Expression(location)
+    LambdaExpression(Location location, ArenaSpan<Parameter> parameters, Expression* body)
+        : parameters(parameters)
+        , body(body)
+        , Expression(NodeKind::LAMBDA_EXPR, location)
     {
     }
 
 
+    static bool classof(const Expression* node)
+    {
+        return node->getNodeKind() == NodeKind::LAMBDA_EXPR;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         throw "LambdaExpression::dump()";
@@ -461,20 +633,28 @@ public:
 class TypeCheckExpression : public Expression
 {
 public:
-    std::unique_ptr<Expression> expression;
-    std::unique_ptr<Type>       type;
+    Expression* expression;
+    Type*       type;
+
+    TypeCheckExpression(Location location, Expression* expression, Type* type)
+        : expression(expression)
+        , type(type)
+        , Expression(NodeKind::TYPE_CHECK_EXPR, location)
+    {
+    }
 
-    TypeCheckExpression(Location location, std::unique_ptr<Expression> expression,
-                        std::unique_ptr<Type> type)
-        : expression(std::move(expression))
-        , type(std::move(type))
-        , Expression(location)
+    static bool classof(const Expression* node)
     {
+        return node->getNodeKind() == NodeKind::TYPE_CHECK_EXPR;
     }
 
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
-        throw "TypeCheckExpression::dump()";
+        std::string result =
+            getTreePrefix(prefix, isLast) + "TypeCheckExpression: is " + type->getName() + "\n";
+        std::string childPrefix = getChildPrefix(prefix, isLast);
+        result += expression->dump(childPrefix, true);
+        return result;
     }
 };
 
@@ -482,13 +662,16 @@ class Statement
 {
 
 private:
+    NodeKind nodeKind;
     Location location;
 
 public:
-    Statement(Location l)
-        : location(l)
+    Statement(NodeKind k, Location l)
+        : nodeKind(k)
+        , location(l)
     {
     }
+    NodeKind getNodeKind() const { return nodeKind; }
     Location getLocation() const { return location; }
     virtual ~Statement()                                                               = default;
     virtual std::string dump(const std::string& prefix = "", bool isLast = true) const = 0;
@@ -497,15 +680,20 @@ public:
 class ExpressionStatement : public Statement
 {
 public:
-    std::unique_ptr<Expression> expression;
+    Expression* expression;
 
-    explicit ExpressionStatement(Location location, std::unique_ptr<Expression> expression)
-        : expression(std::move(expression))
-        , Statement(location)
+    explicit ExpressionStatement(Location location, Expression* expression)
+        : expression(expression)
+        , Statement(NodeKind::EXPRESSION_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::EXPRESSION_STMT;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "ExpressionStatement:\n";
@@ -518,15 +706,20 @@ public:
 class BlockStatement : public Statement
 {
 public:
-    std::vector<std::unique_ptr<Statement>> statements;
+    ArenaSpan<Statement*> statements;
 
-    explicit BlockStatement(Location location, std::vector<std::unique_ptr<Statement>> statements)
-        : statements(std::move(statements))
-        , Statement(location)
+    explicit BlockStatement(Location location, ArenaSpan<Statement*> statements)
+        : statements(statements)
+        , Statement(NodeKind::BLOCK_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::BLOCK_STMT;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "BlockStatement:\n";
@@ -544,21 +737,22 @@ public:
 class IfStatement : public Statement
 {
 public:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Statement>  thenBranch;
-    std::unique_ptr<Statement>  elseBranch;
+    Expression* condition;
+    Statement*  thenBranch;
+    Statement*  elseBranch;
 
-    IfStatement(Location location, std::unique_ptr<Expression> condition,
-                std::unique_ptr<Statement> thenBranch,
-                std::unique_ptr<Statement> elseBranch = nullptr)
-        : condition(std::move(condition))
-        , thenBranch(std::move(thenBranch))
-        , elseBranch(std::move(elseBranch))
-        , Statement(location)
+    IfStatement(Location location, Expression* condition, Statement* thenBranch,
+                Statement* elseBranch = nullptr)
+        : condition(condition)
+        , thenBranch(thenBranch)
+        , elseBranch(elseBranch)
+        , Statement(NodeKind::IF_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node) { return node->getNodeKind() == NodeKind::IF_STMT; }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "IfStatement:\n";
@@ -587,21 +781,26 @@ class WhenStatement : public Statement
 public:
     struct Case
     {
-        std::unique_ptr<Expression> value;
-        std::unique_ptr<Statement>  body;
+        Expression* value;
+        Statement*  body;
     };
 
-    std::unique_ptr<Expression> subject;
-    std::vector<Case>           cases;
+    Expression*     subject;
+    ArenaSpan<Case> cases;
 
-    WhenStatement(Location location, std::unique_ptr<Expression> subject, std::vector<Case> cases)
-        : subject(std::move(subject))
-        , cases(std::move(cases))
-        , Statement(location)
+    WhenStatement(Location location, Expression* subject, ArenaSpan<Case> cases)
+        : subject(subject)
+        , cases(cases)
+        , Statement(NodeKind::WHEN_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::WHEN_STMT;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "WhenStatement:\n";
@@ -639,20 +838,27 @@ public:
 class ForStatement : public Statement
 {
 public:
-    std::string                 variable;
-    std::unique_ptr<Expression> iterable;
-    std::unique_ptr<Statement>  body;
-
-    ForStatement(Location location, std::string variable, std::unique_ptr<Expression> iterable,
-                 std::unique_ptr<Statement> body)
+    std::string variable;
+    Expression* iterable;
+    Statement*  body;
+    int         slot = -1;
+    // 迭代对象是新构造的计数迭代器（如 Range）时按计数循环生成：
+    // 循环变量从 countStart 开始每次加 countStep，不小于 countEnd 时结束
+    Expression* countEnd   = nullptr;
+    int         countStart = 0;
+    int         countStep  = 1;
+
+    ForStatement(Location location, std::string variable, Expression* iterable, Statement* body)
         : variable(std::move(variable))
-        , iterable(std::move(iterable))
-        , body(std::move(body))
-        , Statement(location)
+        , iterable(iterable)
+        , body(body)
+        , Statement(NodeKind::FOR_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node) { return node->getNodeKind() == NodeKind::FOR_STMT; }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "ForStatement:\n";
@@ -675,15 +881,20 @@ public:
 class ReturnStatement : public Statement
 {
 public:
-    std::unique_ptr<Expression> value;
+    Expression* value;
 
-    explicit ReturnStatement(Location location, std::unique_ptr<Expression> value = nullptr)
+    explicit ReturnStatement(Location location, Expression* value = nullptr)
         : value(std::move(value))
-        , Statement(location)
+        , Statement(NodeKind::RETURN_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::RETURN_STMT;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result = getTreePrefix(prefix, isLast) + "ReturnStatement:";
@@ -699,25 +910,30 @@ public:
 class VariableStatement : public Statement
 {
 public:
-    bool                        immutable;
-    std::string                 name;
-    std::unique_ptr<Type>       declType;
-    std::unique_ptr<Type>       initType;
-    std::unique_ptr<Expression> initializer;
-
-    VariableStatement(Location location, bool immutable, std::string name,
-                      std::unique_ptr<Type> declType, std::unique_ptr<Type> initType,
-                      std::unique_ptr<Expression> initializer)
+    bool        immutable;
+    std::string name;
+    Type*       declType;
+    Type*       initType;
+    Expression* initializer;
+    int         slot = -1;
+
+    VariableStatement(Location location, bool immutable, std::string name, Type* declType,
+                      Type* initType, Expression* initializer)
         : immutable(immutable)
         , name(std::move(name))
-        , initType(std::move(initType))
-        , declType(std::move(declType))
-        , initializer(std::move(initializer))
-        , Statement(location)
+        , initType(initType)
+        , declType(declType)
+        , initializer(initializer)
+        , Statement(NodeKind::VARIABLE_STMT, location)
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::VARIABLE_STMT;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string kindStr = immutable ? "val" : "var";
@@ -753,25 +969,30 @@ class Declaration : public Statement
 {
 
 public:
-    Declaration(Location l)
-        : Statement(l)
+    Declaration(NodeKind k, Location l)
+        : Statement(k, l)
     {
     }
     virtual ~Declaration() = default;
+
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() >= NodeKind::FIRST_DECL &&
+               node->getNodeKind() <= NodeKind::LAST_DECL;
+    }
 };
 
 class FunctionParameter
 {
 public:
-    std::string                 name;
-    std::unique_ptr<Type>       type;
-    std::unique_ptr<Expression> defaultValue;
+    std::string name;
+    Type*       type;
+    Expression* defaultValue;
 
-    FunctionParameter(std::string name, std::unique_ptr<Type> type,
-                      std::unique_ptr<Expression> defaultValue = nullptr)
+    FunctionParameter(std::string name, Type* type, Expression* defaultValue = nullptr)
         : name(std::move(name))
-        , type(std::move(type))
-        , defaultValue(std::move(defaultValue))
+        , type(type)
+        , defaultValue(defaultValue)
     {
     }
 
@@ -808,20 +1029,23 @@ public:
 class FunctionDeclaration : public Declaration
 {
 public:
-    std::string                    name;
-    std::vector<FunctionParameter> parameters;
-    std::unique_ptr<Type>          returnType;
-    std::unique_ptr<Statement>     body;
-    bool                           isOperator;
+    std::string                  name;
+    ArenaSpan<FunctionParameter> parameters;
+    Type*                        returnType;
+    Statement*                   body;
+    bool                         isOperator;
+    int                          localCount      = 0;              // 参数依次占用 0..n-1 号槽位
+    int                          allocationSites = 0;              // 函数体中构造对象的调用点数量
+    uint8_t                      effects         = Effects::ALL;   // 推断的副作用，含所调用的函数
 
     FunctionDeclaration(Location location, std::string name,
-                        std::vector<FunctionParameter> parameters, std::unique_ptr<Type> returnType,
-                        std::unique_ptr<Statement> body, bool isOperator = false)
-        : Declaration(location)
+                        ArenaSpan<FunctionParameter> parameters, Type* returnType, Statement* body,
+                        bool isOperator = false)
+        : Declaration(NodeKind::FUNCTION_DECL, location)
         , name(std::move(name))
-        , parameters(std::move(parameters))
-        , returnType(std::move(returnType))
-        , body(std::move(body))
+        , parameters(parameters)
+        , returnType(returnType)
+        , body(body)
         , isOperator(isOperator)
 
     {
@@ -850,6 +1074,11 @@ public:
         return *returnType == *func->returnType;
     }
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::FUNCTION_DECL;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result = getTreePrefix(prefix, isLast) + "FunctionDeclaration: " + name;
@@ -897,18 +1126,23 @@ public:
 class EnumDeclaration : public Declaration
 {
 public:
-    std::string              name;
-    std::vector<std::string> values;
+    std::string            name;
+    ArenaSpan<std::string> values;
 
-    EnumDeclaration(Location location, std::string name, std::vector<std::string> values)
+    EnumDeclaration(Location location, std::string name, ArenaSpan<std::string> values)
         : name(std::move(name))
-        , values(std::move(values))
-        , Declaration(location)
+        , values(values)
+        , Declaration(NodeKind::ENUM_DECL, location)
 
     {
     }
 
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::ENUM_DECL;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "EnumDeclaration: " + name + "\n";
@@ -930,13 +1164,16 @@ public:
 class ClassMember
 {
 private:
+    NodeKind nodeKind;
     Location location;
 
 public:
-    ClassMember(Location l)
-        : location(l)
+    ClassMember(NodeKind k, Location l)
+        : nodeKind(k)
+        , location(l)
     {
     }
+    NodeKind getNodeKind() const { return nodeKind; }
     Location getLocation() const { return location; }
 
     virtual ~ClassMember()                                                             = default;
@@ -948,24 +1185,29 @@ public:
 class PropertyMember : public ClassMember
 {
 public:
-    bool                        immutable;
-    std::string                 name;
-    std::unique_ptr<Type>       type;
-    std::unique_ptr<Expression> initializer;
+    bool        immutable;
+    std::string name;
+    Type*       type;
+    Expression* initializer;
 
-    PropertyMember(Location location, bool immutable, std::string name, std::unique_ptr<Type> type,
-                   std::unique_ptr<Expression> initializer = nullptr)
+    PropertyMember(Location location, bool immutable, std::string name, Type* type,
+                   Expression* initializer = nullptr)
         : immutable(immutable)
         , name(std::move(name))
-        , type(std::move(type))
-        , ClassMember(location)
-        , initializer(std::move(initializer))
+        , type(type)
+        , ClassMember(NodeKind::PROPERTY_MEMBER, location)
+        , initializer(initializer)
     {
     }
 
     std::string getName() const override { return name; }
     Type        getType() const override { return *type; }
 
+    static bool classof(const ClassMember* node)
+    {
+        return node->getNodeKind() == NodeKind::PROPERTY_MEMBER;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result = getTreePrefix(prefix, isLast) + "PropertyMember: " + name;
@@ -998,20 +1240,28 @@ public:
 class MethodMember : public ClassMember
 {
 public:
-    std::unique_ptr<FunctionDeclaration> function;
+    FunctionDeclaration* function;
+    bool                 isFinal;
 
-    explicit MethodMember(Location location, std::unique_ptr<FunctionDeclaration> function)
-        : function(std::move(function))
-        , ClassMember(location)
+    explicit MethodMember(Location location, FunctionDeclaration* function, bool isFinal = false)
+        : function(function)
+        , isFinal(isFinal)
+        , ClassMember(NodeKind::METHOD_MEMBER, location)
     {
     }
 
-    std::string getName() const override { return function.get()->name; }
+    std::string getName() const override { return function->name; }
     Type        getType() const override { return *function->returnType; }
 
+    static bool classof(const ClassMember* node)
+    {
+        return node->getNodeKind() == NodeKind::METHOD_MEMBER;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
-        std::string result      = getTreePrefix(prefix, isLast) + "MethodMember:\n";
+        std::string result      = getTreePrefix(prefix, isLast) + "MethodMember" +
+                             (isFinal ? " (final)" : "") + ":\n";
         std::string childPrefix = getChildPrefix(prefix, isLast);
         result += function->dump(childPrefix, true);
         return result;
@@ -1021,11 +1271,13 @@ public:
 class InitBlockMember : public ClassMember
 {
 public:
-    std::unique_ptr<BlockStatement> block;
+    BlockStatement* block;
+    int             localCount      = 0;
+    int             allocationSites = 0;
 
-    explicit InitBlockMember(Location location, std::unique_ptr<BlockStatement> block)
-        : block(std::move(block))
-        , ClassMember(location)
+    explicit InitBlockMember(Location location, BlockStatement* block)
+        : block(block)
+        , ClassMember(NodeKind::INIT_BLOCK_MEMBER, location)
     {
     }
 
@@ -1033,6 +1285,11 @@ public:
     Type        getType() const override { return Type(); }
 
 
+    static bool classof(const ClassMember* node)
+    {
+        return node->getNodeKind() == NodeKind::INIT_BLOCK_MEMBER;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string result      = getTreePrefix(prefix, isLast) + "InitBlockMember:\n";
@@ -1052,24 +1309,27 @@ public:
         BASE
     };
 
-    Kind                                      kind;
-    std::string                               name;
-    std::vector<FunctionParameter>            constructorParameters;
-    std::string                               baseClass;
-    std::vector<std::unique_ptr<Expression>>  baseConstructorArgs;
-    std::vector<std::unique_ptr<ClassMember>> members;
+    Kind                         kind;
+    std::string                  name;
+    ArenaSpan<FunctionParameter> constructorParameters;
+    std::string                  baseClass;
+    ArenaSpan<Expression*>       baseConstructorArgs;
+    ArenaSpan<ClassMember*>      members;
+    bool                         isFinal;
+    bool                         stackAllocated = false;   // 逃逸分析：有该类的对象分配在栈上
 
     ClassDeclaration(Location location, Kind kind, std::string name,
-                     std::vector<FunctionParameter> constructorParameters, std::string baseClass,
-                     std::vector<std::unique_ptr<Expression>>  baseConstructorArgs,
-                     std::vector<std::unique_ptr<ClassMember>> members)
+                     ArenaSpan<FunctionParameter> constructorParameters, std::string baseClass,
+                     ArenaSpan<Expression*> baseConstructorArgs, ArenaSpan<ClassMember*> members,
+                     bool isFinal = false)
         : kind(kind)
         , name(std::move(name))
-        , constructorParameters(std::move(constructorParameters))
+        , constructorParameters(constructorParameters)
         , baseClass(std::move(baseClass))
-        , baseConstructorArgs(std::move(baseConstructorArgs))
-        , members(std::move(members))
-        , Declaration(location)
+        , baseConstructorArgs(baseConstructorArgs)
+        , members(members)
+        , isFinal(isFinal)
+        , Declaration(NodeKind::CLASS_DECL, location)
     {
     }
 
@@ -1077,7 +1337,7 @@ public:
     {
         for (const auto& m : this->members) {
             if (m->getName() == member->getName()) {
-                return m.get();
+                return m;
             }
         }
         return nullptr;
@@ -1086,7 +1346,7 @@ public:
     {
         for (const auto& m : this->members) {
             if (m->getName() == member) {
-                return m.get();
+                return m;
             }
         }
         return nullptr;
@@ -1095,7 +1355,7 @@ public:
     {
         for (const auto& param : constructorParameters) {
             if (param.name == paramName) {
-                return param.type.get();
+                return param.type;
             }
         }
         return nullptr;
@@ -1103,13 +1363,18 @@ public:
     bool containInitMember() const
     {
         for (const auto& m : this->members) {
-            if (const auto _ = dynamic_cast<const InitBlockMember*>(m.get())) {
+            if (isa<InitBlockMember>(m)) {
                 return true;
             }
         }
         return false;
     }
 
+    static bool classof(const Statement* node)
+    {
+        return node->getNodeKind() == NodeKind::CLASS_DECL;
+    }
+
     std::string dump(const std::string& prefix = "", bool isLast = true) const override
     {
         std::string kindStr;
@@ -1119,6 +1384,8 @@ public:
             case Kind::BASE: kindStr = "base class"; break;
         }
 
+        if (isFinal) kindStr = "final " + kindStr;
+
         std::string result =
             getTreePrefix(prefix, isLast) + "ClassDeclaration (" + kindStr + "): " + name;
 
@@ -1174,15 +1441,14 @@ public:
     }
 };
 
+// Program 持有整棵 AST 的 Arena，所有节点都由它分配，随 Program 一起释放
 class Program
 {
 public:
-    std::vector<std::unique_ptr<Declaration>> declarations;
+    Arena                   arena;
+    ArenaSpan<Declaration*> declarations;
 
-    explicit Program(std::vector<std::unique_ptr<Declaration>> declarations)
-        : declarations(std::move(declarations))
-    {
-    }
+    Program() = default;
 
     std::string dump() const
     {
@@ -11,9 +11,11 @@
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
@@ -30,75 +32,18 @@
 #include <variant>
 #include <vector>
 
-enum class IRValueKind
+// 每个类的虚表：方法槽位 = methodOffset + Binding 下标
+// methodSlots[i] 为 ClassLayout::methods[i] 在虚表结构体中的下标，没有槽位的 final 方法为 -1
+struct VTableInfo
 {
-    PROPERTY,
-    PARAM,
+    llvm::StructType*                type = nullptr;
+    std::vector<int>                 methodSlots;
+    std::vector<llvm::FunctionType*> methodTypes;
+    std::vector<llvm::Function*>     methods;
 };
 
-class IRValue
-{
-private:
-    IRValueKind                     kind;
-    std::variant<int, llvm::Value*> data;
-
-public:
-    IRValue(int offset)
-        : kind(IRValueKind::PROPERTY)
-        , data(offset)
-    {
-    }
-
-    IRValue(llvm::Value* value)
-        : kind(IRValueKind::PARAM)
-        , data(value)
-    {
-    }
-
-    IRValueKind getKind() const { return kind; }
-
-    int getOffset() const
-    {
-        assert(kind == IRValueKind::PROPERTY);
-        return std::get<int>(data);
-    }
-
-    llvm::Value* getValue() const
-    {
-        assert(kind == IRValueKind::PARAM);
-        return std::get<llvm::Value*>(data);
-    }
-};
-
-class IRValueScope
-{
-private:
-    std::string                              name;
-    std::unordered_map<std::string, IRValue> map;
-
-public:
-    IRValueScope(const std::string& s)
-        : name(s)
-    {
-    }
-    void                                            add(const std::string& key, IRValue value);
-    const IRValue*                                  find(const std::string& key);
-    const std::unordered_map<std::string, IRValue>& getMap() const { return map; }
-    const std::string&                              getName() const { return name; }
-};
-
-class IRValueTable
-{
-private:
-    std::vector<IRValueScope> scopes;
-
-public:
-    void           enterScope(const std::string& name = "");
-    void           exitScope();
-    void           add(const std::string& key, IRValue value);
-    const IRValue* find(const std::string& key);
-    void           debug() const;
-};
+// when 中合为一条 switch 的常量分支：(分支值, 分支体)
+using SwitchCases = std::vector<std::pair<const Expression*, llvm::BasicBlock*>>;
 
 class IRGen
 {
@@ -108,7 +53,6 @@ private:
     std::unique_ptr<llvm::IRBuilder<>> builder;
     std::unique_ptr<llvm::DataLayout>  dataLayout;
 
-    IRValueTable             valueTable;
     std::unique_ptr<Program> program;
     ClassTable               classTable;
     FunctionTable            functionTable;
@@ -118,17 +62,28 @@ private:
     llvm::Instruction*      allocaInsertPoint = nullptr;
     llvm::Value*            retVal            = nullptr;
     llvm::BasicBlock*       retBB             = nullptr;
+    llvm::Value*            selfPtr           = nullptr;
+    llvm::Value*            constructedObject = nullptr;   // 构造链中正在初始化的对象（i8*）
+    bool                    constructing      = false;   // 正在生成构造过程，val 属性尚未写完
+    bool                    seesStackObject   = false;   // 当前函数可能访问栈上对象
+
+    // 当前函数的局部变量，按语义分析分配的槽位索引
+    std::vector<llvm::Value*> locals;
 
-    std::unordered_map<Type, llvm::Type*> typeMap;
-    std::unordered_map<std::string,
-                       std::vector<std::variant<const FunctionParameter*, const PropertyMember*>>>
-                                                           classAllParams;
+    std::unordered_map<Type, llvm::Type*>                  typeMap;
     std::unordered_map<std::string, llvm::StructType*>     classTypes;
     std::unordered_map<std::string, llvm::Type*>           vTableTypes;
     std::unordered_map<std::string, llvm::Function*>       methodMap;
-    std::unordered_map<std::string, llvm::FunctionType*>   methodTypeMap;
     std::unordered_map<std::string, llvm::GlobalVariable*> vTableVars;
-    std::unordered_map<std::string, size_t>                vTableOffsetMap;
+    std::unordered_map<Type, VTableInfo>                   vTables;
+    std::unordered_map<Type, std::vector<int>>             fieldSlots;         // 字段在结构体中的下标
+    std::vector<llvm::Function*>                           functionValues;     // 按函数编号
+    std::vector<llvm::Function*>                           classMallocInits;   // 按类编号
+
+    // TBAA 类型树：标量类型节点按名字，结构体类型节点按类
+    llvm::MDNode*                                  tbaaRoot = nullptr;
+    std::unordered_map<std::string, llvm::MDNode*> tbaaScalars;
+    std::unordered_map<Type, llvm::MDNode*>        tbaaStructs;
 
     llvm::Type* int32Ty;
     llvm::Type* int64Ty;
@@ -143,7 +98,6 @@ public:
         , module(std::make_unique<llvm::Module>("test_module", *context))
         , builder(std::make_unique<llvm::IRBuilder<>>(*context))
         , dataLayout(std::make_unique<llvm::DataLayout>(module.get()))
-        , valueTable(IRValueTable())
         , currFuncName("")
         , program(std::move(p))
         , classTable(classTable)
@@ -160,31 +114,44 @@ public:
 
     /* setup methods */
    void declareBuiltInClasses();
+    void declareEnums();
     void declareClasses();
     void defineClasses();
     void buildVTables();
-    void addVTableMethod(std::vector<llvm::Type*>&     vTableMethods,
-                         std::vector<llvm::Constant*>& vTableInitializers,
-                         const std::string& methodName, llvm::FunctionType* funcType);
+    llvm::Function* getOrCreateMethod(const std::string& methodName, llvm::FunctionType* funcType);
+    void            addVTableMethod(std::vector<llvm::Type*>&     vTableMethods,
+                                    std::vector<llvm::Constant*>& vTableInitializers,
+                                    const std::string& methodName, llvm::FunctionType* funcType);
     void setupClasses();
     void setupFunctions();
+    int  getFieldSlot(const Type& classType, int fieldIndex) const;
+    void buildTBAA();
+    void printLayouts(const std::vector<std::string>& files);
 
     /* utils methods */
     llvm::Type* generateType(const Type& type, bool ptr);
     llvm::Type* generateType(const std::string& type, bool ptr);
 
+    std::vector<llvm::Attribute::AttrKind> effectAttributes(uint8_t effects);
+    llvm::MDNode* getTBAAScalar(const std::string& name);
+    void setFieldTBAA(llvm::Instruction* inst, const Type& classType, int fieldIndex);
+    void setVTableTBAA(llvm::Instruction* inst, const Type& classType);
+    void addSelfAttributes(llvm::Function* function, const std::string& className);
+    llvm::LoadInst* generateFieldLoad(const ClassField& field, llvm::Type* type, llvm::Value* ptr,
+                                      const std::string& name);
+    bool            selfMayBeOnStack(const ClassDeclaration& decl) const;
+    void            dropInvariantLoads(llvm::Function* function);
+
     llvm::Function* getCurrFunc()
     {
         return currClass == nullptr
                    ? this->module->getFunction(currFuncName)
                    : this->module->getFunction(Format("{0}_{1}", currClass->name, currFuncName));
     }
-    llvm::Type* getParamType(
-        const std::variant<const FunctionParameter*, const PropertyMember*>& param);
-    std::string getParamName(
-        const std::variant<const FunctionParameter*, const PropertyMember*>& param);
-    const Expression* getParamInitExpr(
-        const std::variant<const FunctionParameter*, const PropertyMember*>& param);
+    llvm::Type*       getParamType(const ClassField& param);
+    std::string       getParamName(const ClassField& param);
+    std::string       getParamTypeName(const ClassField& param);
+    const Expression* getParamInitExpr(const ClassField& param);
 
     llvm::AllocaInst* allocateStackVariable(const std::string_view identifier, llvm::Type* type);
 
@@ -195,9 +162,13 @@ public:
     void generateClassDeclaration(const ClassDeclaration& decl);
 
     /* generate class init methods  */
-    void generateClassBuiltinInit(const ClassDeclaration& decl);
-    void generateClassConstructor(const ClassDeclaration& decl);
+    void generateClassInit(const ClassDeclaration& decl, llvm::Value* self,
+                           const std::vector<llvm::Value*>& args);
     void generateClassMallocInit(const ClassDeclaration& decl);
+    void generateObjectHeader(const ClassDeclaration& decl, llvm::Value* object);
+    bool initializesAllFields(llvm::Instruction* start, llvm::Value* object, llvm::Type* classType);
+    llvm::Value* generateStackObject(const ClassDeclaration&          decl,
+                                     const std::vector<llvm::Value*>& constructorArgs);
     void generateClassSelfDefinedInit(const InitBlockMember& init, const std::string& className);
 
     void generateEnumDeclaration(const EnumDeclaration& decl);
@@ -207,14 +178,21 @@ public:
     void generateBlockStatement(const BlockStatement& stmt);
     void generateExpressionStatement(const ExpressionStatement& stmt);
     void generateForStatement(const ForStatement& stmt);
+    void generateCountedLoop(const ForStatement& stmt);
     void generateIfStatement(const IfStatement& stmt);
     void generateReturnStatement(const ReturnStatement& stmt);
     void generateVariableStatement(const VariableStatement& stmt);
     void generateWhenStatement(const WhenStatement& stmt);
+    void generateSwitch(llvm::Value* subject, const SwitchCases& cases,
+                        llvm::BasicBlock* defaultBB);
+    void generateStringSwitch(llvm::Value* subject, const SwitchCases& cases,
+                              llvm::BasicBlock* defaultBB);
+    llvm::Value* generateWhenMatch(llvm::Value* subject, llvm::Value* value, const Type& type);
 
     llvm::Value* generateExpression(const Expression& expr);
     llvm::Value* generateArrayExpression(const ArrayExpression& expr);
     llvm::Value* generateBinaryExpression(const BinaryExpression& expr);
+    llvm::Value* generateLogicalExpression(const BinaryExpression& expr);
     llvm::Value* generateCallExpression(const CallExpression& expr);
     llvm::Value* generateIdentifierExpression(const IdentifierExpression& expr);
     llvm::Value* generateIdentifierExpressionPtr(const IdentifierExpression& expr);
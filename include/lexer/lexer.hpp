@@ -13,11 +13,11 @@
 class Lexer
 {
 private:
-    std::string source;
-    std::string filename;
-    size_t      position = 0;
-    int         line     = 1;
-    int         column   = 1;
+    std::string      source;
+    std::string_view filename;   // 已驻留，见 Location::internFilename
+    size_t           position = 0;
+    int              line     = 1;
+    int              column   = 1;
 
     static const std::map<std::string, TokenType> keywords;
 
@@ -32,9 +32,9 @@ private:
     Token scanString();
 
 public:
-    explicit Lexer(const std::string& source, const std::string& filename = "")
-        : source(source)
-        , filename(filename)
+    explicit Lexer(std::string source, const std::string& filename = "")
+        : source(std::move(source))
+        , filename(Location::internFilename(filename))
     {
     }
     explicit Lexer(std::ifstream& file, const std::string& filename = "");
@@ -29,6 +29,7 @@ enum class TokenType
     IS,
     SELF,
     OPERATOR,
+    FINAL,
     // PRINT,
     // PRINTLN,
     VOID,
@@ -89,7 +90,7 @@ struct Token
     // std::string                                                 filename;
     Location location;
 
-    explicit Token(TokenType type, int line, int column, const std::string& filename = "")
+    explicit Token(TokenType type, int line, int column, std::string_view filename = {})
         : type(type)
         , value(std::monostate{})
         , location(line, column, filename)
@@ -97,7 +98,7 @@ struct Token
     }
 
     explicit Token(TokenType type, int value, int line, int column,
-                   const std::string& filename = "")
+                   std::string_view filename = {})
         : type(type)
         , value(value)
         , location(line, column, filename)
@@ -105,7 +106,7 @@ struct Token
     }
 
     explicit Token(TokenType type, float value, int line, int column,
-                   const std::string& filename = "")
+                   std::string_view filename = {})
         : type(type)
         , value(value)
         , location(line, column, filename)
@@ -113,7 +114,7 @@ struct Token
     }
 
     explicit Token(TokenType type, std::string value, int line, int column,
-                   const std::string& filename = "")
+                   std::string_view filename = {})
         : type(type)
         , value(std::move(value))
         , location(line, column, filename)
@@ -121,7 +122,7 @@ struct Token
     }
     
     explicit Token(TokenType type, bool value, int line, int column,
-                   const std::string& filename = "")
+                   std::string_view filename = {})
         : type(type)
         , value(value)
         , location(line, column, filename)
@@ -0,0 +1,39 @@
+#ifndef TOKEN_STREAM_HPP
+#define TOKEN_STREAM_HPP
+
+#include "lexer.hpp"
+#include "token.hpp"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+// 按需从 Lexer 拉取 token，多个源文件首尾相接（中间文件的 EOF 被丢弃）。
+// 只保留 previous 和 current 两个 token，内存占用与源文件大小无关。
+class TokenStream
+{
+private:
+    static constexpr size_t RING_SIZE = 2;   // 必须是 2 的幂
+    static constexpr size_t RING_MASK = RING_SIZE - 1;
+
+    std::vector<Lexer>                          sources;
+    size_t                                      currSource = 0;
+    std::array<std::optional<Token>, RING_SIZE> ring;
+    // head: current token 的序号; tail: 已读入的最后一个 token 的序号 + 1
+    size_t head = 0;
+    size_t tail = 0;
+
+    Token pull();
+    void  fill(size_t count);
+
+public:
+    explicit TokenStream(std::vector<Lexer> sources);
+    explicit TokenStream(Lexer source);
+
+    const Token& peek() const { return *ring[head & RING_MASK]; }
+    const Token& previous() const { return *ring[(head - 1) & RING_MASK]; }
+    bool         isAtEnd() const { return peek().type == TokenType::END_OF_FILE; }
+    void         advance();
+};
+
+#endif   // TOKEN_STREAM_HPP
@@ -3,6 +3,7 @@
 
 #include "ast/ast.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_stream.hpp"
 #include "utils/error.hpp"
 
 #include <memory>
@@ -13,13 +14,23 @@
 class Parser
 {
 private:
-    std::vector<Token> tokens;
-    size_t             current = 0;
+    TokenStream tokens;
+    // 当前正在构建的 Program 的 Arena，所有节点都从这里分配
+    Arena* arena = nullptr;
 
-    Token                                       peek() const;
-    Token                                       previous() const;
+    template<typename T, typename... Args> T* make(Args&&... args)
+    {
+        return arena->create<T>(std::forward<Args>(args)...);
+    }
+    template<typename T> ArenaSpan<T> span(std::vector<T>&& items)
+    {
+        return arena->copySpan(std::move(items));
+    }
+
+    const Token&                                peek() const;
+    const Token&                                previous() const;
     bool                                        isAtEnd() const;
-    Token                                       advance();
+    const Token&                                advance();
     bool                                        check(TokenType type) const;
     bool                                        match(TokenType type);
     bool                                        match(std::initializer_list<TokenType> types);
@@ -28,43 +39,56 @@ private:
     Error currentError = Error("", 0, 0);
     Error createError(const Token& token, const std::string& message);
 
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> expression();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> assignment();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> logicalOr();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> logicalAnd();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> equality();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> comparison();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> addition();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> multiplication();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> unary();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> call();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> primary();
-    std::pair<std::unique_ptr<Expression>, std::optional<Error>> finishCall(
-        std::unique_ptr<Expression> callee);
-
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> statement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> expressionStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> blockStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> ifStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> whenStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> forStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> returnStatement();
-    std::pair<std::unique_ptr<Statement>, std::optional<Error>> variableStatment();
-
-
-    std::pair<std::unique_ptr<Declaration>, std::optional<Error>> declaration();
-    std::pair<std::unique_ptr<Declaration>, std::optional<Error>> functionDeclaration();
-    std::pair<std::unique_ptr<Declaration>, std::optional<Error>> enumDeclaration();
-    std::pair<std::unique_ptr<Declaration>, std::optional<Error>> classDeclaration();
+    // 二元运算符优先级，由低到高
+    enum class Precedence
+    {
+        NONE,
+        ASSIGNMENT,   // =
+        OR,           // ||
+        AND,          // &&
+        EQUALITY,     // == !=
+        COMPARISON,   // < <= > >=
+        TERM,         // + -
+        FACTOR,       // * / %
+    };
+    struct InfixRule
+    {
+        Precedence                 precedence;
+        BinaryExpression::Operator op;
+    };
+    static const InfixRule& infixRule(TokenType type);
+
+    std::pair<Expression*, std::optional<Error>> expression();
+    std::pair<Expression*, std::optional<Error>> parsePrecedence(Precedence minPrecedence);
+    std::pair<Expression*, std::optional<Error>> assignment(Expression* target);
+    std::pair<Expression*, std::optional<Error>> unary();
+    std::pair<Expression*, std::optional<Error>> call();
+    std::pair<Expression*, std::optional<Error>> primary();
+    std::pair<Expression*, std::optional<Error>> finishCall(Expression* callee);
+
+    std::pair<Statement*, std::optional<Error>> statement();
+    std::pair<Statement*, std::optional<Error>> expressionStatement();
+    std::pair<Statement*, std::optional<Error>> blockStatement();
+    std::pair<Statement*, std::optional<Error>> ifStatement();
+    std::pair<Statement*, std::optional<Error>> whenStatement();
+    std::pair<Statement*, std::optional<Error>> forStatement();
+    std::pair<Statement*, std::optional<Error>> returnStatement();
+    std::pair<Statement*, std::optional<Error>> variableStatment();
+
+
+    std::pair<Declaration*, std::optional<Error>> declaration();
+    std::pair<Declaration*, std::optional<Error>> functionDeclaration();
+    std::pair<Declaration*, std::optional<Error>> enumDeclaration();
+    std::pair<Declaration*, std::optional<Error>> classDeclaration(bool isFinal = false);
 
     // 解析类成员
-    std::pair<std::unique_ptr<ClassMember>, std::optional<Error>> classMember();
+    std::pair<ClassMember*, std::optional<Error>> classMember();
 
     // 解析类型
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> type();
+    std::pair<Type*, std::optional<Error>> type();
 
 public:
-    explicit Parser(std::vector<Token> tokens)
+    explicit Parser(TokenStream tokens)
         : tokens(std::move(tokens))
     {
     }
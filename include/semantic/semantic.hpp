@@ -6,10 +6,14 @@
 #include "lexer/token.hpp"
 #include "utils/error.hpp"
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <stack>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <variant>
 #include <vector>
 
 enum class SymbolKind
@@ -17,28 +21,32 @@ enum class SymbolKind
     VAR,
     VAL,
     FUNC,
-    CLASS
+    CLASS,
+    ENUM
+};
+
+struct Symbol
+{
+    Type       type;
+    SymbolKind kind;
+    Binding    binding;
 };
 
 class Scope
 {
 private:
-    std::string                                                  name;
-    std::unordered_map<std::string, std::pair<Type, SymbolKind>> map;
+    std::string                             name;
+    std::unordered_map<std::string, Symbol> map;
 
 public:
     Scope(const std::string s)
         : name(s)
     {
     }
-    void              add(const std::string& key, Type type, SymbolKind kind);
-    const Type*       findType(const std::string& key);
-    const SymbolKind* findKind(const std::string& key);
-    const std::unordered_map<std::string, std::pair<Type, SymbolKind>>& getMap() const
-    {
-        return map;
-    }
-    const std::string& getName() const { return name; }
+    void                                           add(const std::string& key, Symbol symbol);
+    const Symbol*                                  find(const std::string& key);
+    const std::unordered_map<std::string, Symbol>& getMap() const { return map; }
+    const std::string&                             getName() const { return name; }
 };
 
 class SymbolTable
@@ -49,19 +57,63 @@ private:
 public:
     void              enterScope(const std::string& name);
     void              exitScope();
+    const Symbol*     find(const std::string& key);
     const Type*       findType(const std::string& key);
     const SymbolKind* findKind(const std::string& key);
-    void              add(const std::string& key, const Type& type, bool immutable);
-    void add(const std::string& key, const Type& type, SymbolKind kind = SymbolKind::VAR);
+    void add(const std::string& key, const Type& type, bool immutable, Binding binding = {});
+    void add(const std::string& key, const Type& type, SymbolKind kind = SymbolKind::VAR,
+             Binding binding = {});
     void debug() const;
 };
 
+using ClassField = std::variant<const FunctionParameter*, const PropertyMember*>;
+
+struct ClassMethod
+{
+    const ClassDeclaration* owner;
+    const MethodMember*     method;
+};
+
+// 类的字段与方法布局，语义分析和 IRGen 共用：
+// 字段按继承链从根到自身排列，每个类先构造参数后属性；
+// 方法先沿用父类的顺序（子类覆盖时替换实现），再追加本类新增的方法（按名字排序），
+// 因此父类的方法下标和虚表槽位在子类中保持不变。
+// overridden[i] 表示是否有子类给 methods[i] 提供了不同的实现（类层次分析的结果）；
+// vtableSlots[i] 为 methods[i] 在虚表中的槽位，新引入的 final 方法总是直接调用，不占槽位（-1）
+struct ClassLayout
+{
+    std::vector<ClassField>              fields;
+    std::vector<ClassMethod>             methods;
+    std::vector<bool>                    overridden;
+    std::vector<int>                     vtableSlots;
+    int                                  vtableSize = 0;
+    std::unordered_map<std::string, int> fieldIndex;
+    std::unordered_map<std::string, int> methodIndex;
+};
+
+// 类在继承树上的先序编号：id 为自身编号，lastDescendant 为其子树中最大的编号，
+// 子树恰好覆盖区间 [id, lastDescendant]
+struct ClassIdRange
+{
+    int id             = -1;
+    int lastDescendant = -1;
+
+    bool contains(const ClassIdRange& other) const
+    {
+        return id <= other.id && other.id <= lastDescendant;
+    }
+};
+
 class ClassTable
 {
 private:
     std::unordered_map<std::string, const ClassDeclaration*>              classes;
+    std::vector<const ClassDeclaration*>                                  classOrder;
     std::unordered_map<std::string, std::vector<const ClassDeclaration*>> inheritMap;
     std::unordered_map<std::string, std::pair<bool, Type>>                classIterableMap;
+    std::unordered_map<Type, ClassIdRange>                                classIdRanges;
+    std::vector<const ClassDeclaration*>                                  classesById;
+    std::unordered_map<Type, ClassLayout>                                 layouts;
 
 public:
     void                    add(const std::string& className, const ClassDeclaration*);
@@ -69,20 +121,178 @@ public:
 
     const std::vector<const ClassDeclaration*>* getInheritMap(const std::string& className) const;
     const std::pair<bool, Type>*                isClassIterable(const std::string& className) const;
+    const ClassIdRange*                         getClassIdRange(const Type& classType) const;
+    const ClassDeclaration*                     getClassById(int id) const;
+    size_t                                      size() const { return classesById.size(); }
+    const ClassLayout*                          getLayout(const Type& classType) const;
 
     void addInheritMap(const std::string& className, std::vector<const ClassDeclaration*> parents);
-    bool checkInherit(const std::string& child, const std::string& parent) const;
+    void numberClasses();
+    void buildLayouts();
+    bool checkInherit(const Type& child, const Type& parent) const;
     void setClassIterableMap(const std::string& className, bool iterable, const Type& type);
 };
 
 class FunctionTable
 {
 private:
-    std::unordered_map<std::string, const FunctionDeclaration*> functions;
+    std::unordered_map<std::string, int>    functionIds;
+    std::vector<const FunctionDeclaration*> functions;
 
 public:
-    void                       add(const std::string& className, const FunctionDeclaration*);
+    int                        add(const std::string& className, const FunctionDeclaration*);
     const FunctionDeclaration* find(const std::string& className);
+    const FunctionDeclaration* get(int id) const { return functions[id]; }
+    size_t                     size() const { return functions.size(); }
+};
+
+class EnumTable
+{
+private:
+    std::unordered_map<std::string, int> enumIds;
+    std::vector<const EnumDeclaration*>  enums;
+
+public:
+    int                    add(const std::string& enumName, const EnumDeclaration* enumDecl);
+    const EnumDeclaration* find(const std::string& enumName) const;
+    const EnumDeclaration* get(int id) const { return enums[id]; }
+    size_t                 size() const { return enums.size(); }
+};
+
+using ConstantValue = std::variant<int, bool, std::string>;
+
+// 编译期求值：语义分析在每个表达式分析完成后调用 fold，子表达式已是字面量时把它替换为
+// LiteralExpression。支持 int/bool 运算与比较、字符串字面量拼接、以常量初始化的 val 局部变量，
+// 以及参数全为常量的纯内建函数（len、int_to_str、bool_to_str）和用户函数调用。
+// 用户函数的函数体可能还没有分析，这类调用点连同外层表达式先记录下来，整个程序分析完成后
+// 再按 AST 解释执行并继续向外折叠；遇到字段、对象、I/O、循环等无法求值的结构即放弃，
+// 每个调用点最多执行 budget 步。
+// float 的字面量是单精度而运行时按双精度计算，不参与折叠
+class ConstantEvaluator
+{
+private:
+    static constexpr int MAX_CALL_DEPTH = 128;
+
+    // 解释执行用户函数时的栈帧，局部变量按槽位存放
+    struct Frame
+    {
+        std::vector<std::optional<ConstantValue>> locals;
+        std::optional<ConstantValue>              returnValue;
+    };
+
+    // 推迟求值的调用点，ancestors 为包含它的外层表达式（由内向外）
+    struct PendingCall
+    {
+        Expression**              slot;
+        std::vector<Expression**> ancestors;
+    };
+
+    const FunctionTable&                   functionTable;
+    Arena&                                 arena;
+    int                                    budget;
+    int                                    steps = 0;
+    int                                    depth = 0;
+    int                                    folds = 0;
+    Frame*                                 frame      = nullptr;
+    bool                                   deferCalls = true;
+    std::unordered_map<int, ConstantValue> constants;   // 当前函数中以常量初始化的 val 局部变量
+    std::vector<Expression**>              slots;       // 正在分析的表达式及其外层表达式
+    std::vector<PendingCall>               pendingCalls;
+
+    void replace(Expression*& expr, const ConstantValue& value);
+
+    std::optional<ConstantValue> literalValue(const Expression& expr) const;
+    std::optional<ConstantValue> evaluateBinary(BinaryExpression::Operator op,
+                                                const ConstantValue&       left,
+                                                const ConstantValue&       right) const;
+    std::optional<ConstantValue> evaluateUnary(UnaryExpression::Operator op,
+                                               const ConstantValue&      operand) const;
+    std::optional<ConstantValue> evaluateBuiltin(const std::string&                name,
+                                                 const std::vector<ConstantValue>& args) const;
+    std::optional<ConstantValue> evaluateCall(const CallExpression&      expr,
+                                              std::vector<ConstantValue> args);
+    std::optional<ConstantValue> evaluateExpression(const Expression& expr);
+    bool                         executeStatement(const Statement& stmt);
+
+public:
+    static constexpr int DEFAULT_BUDGET = 10000;
+
+    ConstantEvaluator(const FunctionTable& functionTable, Arena& arena, int budget)
+        : functionTable(functionTable)
+        , arena(arena)
+        , budget(budget)
+    {
+    }
+
+    void enterExpression(Expression*& expr) { slots.push_back(&expr); }
+    void exitExpression() { slots.pop_back(); }
+    void clearLocals() { constants.clear(); }
+    void defineLocal(int slot, const Expression& initializer);
+    void fold(Expression*& expr);
+    // 求值记录下来的用户函数调用，返回被替换为字面量的表达式总数
+    int evaluatePendingCalls();
+};
+
+// 副作用推断：语义分析时为每个函数、方法和类的构造过程记录自身的副作用与调用关系，
+// 分析完成后在调用图上按强连通分量求不动点，结果写入 FunctionDeclaration::effects
+// 和虚调用点的 MemberExpression::effects。
+// 局部变量不算内存访问；经虚表调用会读取全局的虚表，按访问了参数之外的内存处理；
+// 循环和递归可能不返回。内建函数的函数体只是占位，副作用按其运行时实现给出
+class EffectAnalyzer
+{
+private:
+    struct Edge
+    {
+        int  target;
+        bool foreignPointers;   // 传入了不是当前函数参数的指针，被调用者访问内存时不再局限于参数
+    };
+
+    // 调用图上的结点：函数或方法、某个类的构造过程，或者某个方法槽位的所有可能实现
+    struct Node
+    {
+        FunctionDeclaration* function   = nullptr;
+        int                  paramCount = 0;
+        uint8_t              local      = Effects::NONE;
+        uint8_t              effects    = Effects::NONE;
+        std::vector<Edge>    callees;
+    };
+
+    const ClassTable&                                   classTable;
+    std::vector<Node>                                   nodes;
+    std::unordered_map<const FunctionDeclaration*, int> functionNodes;
+    std::vector<int>                                    constructionNodes;   // 按类编号
+    std::unordered_map<int64_t, int>                    dispatchNodes;       // 按 (类编号, 方法下标)
+    std::vector<std::pair<MemberExpression*, int>>      dispatchSites;
+    int                                                 current = -1;
+
+    int  functionNode(const FunctionDeclaration* function);
+    int  constructionNode(int classId);
+    int  dispatchNode(int classId, int methodIndex);
+    bool isForeignPointer(const Expression& expr) const;
+    void addEdge(int target, bool foreignPointers);
+    void solveComponent(const std::vector<int>& component);
+
+public:
+    explicit EffectAnalyzer(const ClassTable& classTable)
+        : classTable(classTable)
+    {
+    }
+
+    // 进入函数或构造过程，返回之前的结点，离开时交给 exit 恢复
+    int  enterFunction(FunctionDeclaration& decl);
+    int  enterConstruction(int classId);
+    void exit(int saved) { current = saved; }
+
+    void addEffects(uint8_t effects);
+    void addAssignment(const Expression& target);
+    void addPropertyAccess(const MemberExpression& expr);
+    void addCall(const FunctionDeclaration& callee, const ArenaSpan<Expression*>& arguments);
+    void addMethodCall(MemberExpression& expr);
+    void addConstruction(int classId);
+    void addIteration(const Expression& iterable);
+    void addStringMatch(const WhenStatement& stmt);
+
+    void solve();
 };
 
 class SemanticAnalyzer
@@ -91,16 +301,28 @@ private:
     SymbolTable                           symbolTable;
     ClassTable                            classTable;
     FunctionTable                         functionTable;
+    EnumTable                             enumTable;
     std::unordered_map<std::string, bool> varDefinedMap;
     std::unique_ptr<Program>              program;
     std::stack<std::pair<Type, Location>> currentFunctionReturnTypes;
+    int                                   localCount      = 0;
+    int                                   allocationSites = 0;
+    ConstantEvaluator                     constantEvaluator;
+    EffectAnalyzer                        effectAnalyzer;
+    // 正在分析 init 块的类，以及块中顶层的表达式语句
+    const ClassDeclaration*                   constructingClass = nullptr;
+    std::unordered_set<const Expression*>     initializingWrites;
+    std::unordered_set<const PropertyMember*> initializedProperties;
 
 public:
-    SemanticAnalyzer(std::unique_ptr<Program> p)
+    SemanticAnalyzer(std::unique_ptr<Program> p,
+                     int                      constEvalBudget = ConstantEvaluator::DEFAULT_BUDGET)
         : program(std::move(p))
         , symbolTable(SymbolTable())
         , classTable(ClassTable())
         , functionTable(FunctionTable())
+        , constantEvaluator(functionTable, program->arena, constEvalBudget)
+        , effectAnalyzer(classTable)
     {
     }
     ClassTable    getClassTable() { return classTable; }
@@ -117,6 +339,9 @@ public:
     std::optional<Error> checkPropertyConstructorConflict(const PropertyMember*   property,
                                                           const ClassDeclaration* classDecl);
     std::optional<Error> checkClassOperator(const ClassDeclaration* classDecl);
+    std::optional<Error> checkAssignment(const BinaryExpression& expr);
+    void                 resolveType(Type* type) const;
+    void                 resolveSignatureTypes();
 
     std::pair<std::unique_ptr<Program>, std::optional<Error>> analyze();
     std::optional<Error>                                      analyzeDeclaration(Declaration& decl);
@@ -128,35 +353,146 @@ public:
     std::optional<Error> analyzeBlockStatement(BlockStatement& stmt);
     std::optional<Error> analyzeExpressionStatement(ExpressionStatement& stmt);
     std::optional<Error> analyzeForStatement(ForStatement& stmt);
+    void                 detectCountedLoop(ForStatement& stmt);
     std::optional<Error> analyzeIfStatement(IfStatement& stmt);
     std::optional<Error> analyzeReturnStatement(ReturnStatement& stmt);
     std::optional<Error> analyzeVariableStatement(VariableStatement& stmt);
     std::optional<Error> analyzeWhenStatement(WhenStatement& stmt);
 
     template<typename ExprType>
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> handleExpression(
+    std::pair<Type, std::optional<Error>> handleExpression(
         Expression& expr,
-        std::function<std::pair<std::unique_ptr<Type>, std::optional<Error>>(ExprType&)>
-            analyzeFunc);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeExpression(Expression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeArrayExpression(
-        ArrayExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeBinaryExpression(
-        BinaryExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeCallExpression(
-        CallExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeIdentifierExpression(
-        IdentifierExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeLambdaExpression(
-        LambdaExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeLiteralExpression(
-        LiteralExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeMemberExpression(
-        MemberExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeTypeCheckExpression(
-        TypeCheckExpression& expr);
-    std::pair<std::unique_ptr<Type>, std::optional<Error>> analyzeUnaryExpression(
-        UnaryExpression& expr);
+        std::function<std::pair<Type, std::optional<Error>>(ExprType&)> analyzeFunc);
+    std::pair<Type, std::optional<Error>> analyzeExpression(Expression& expr);
+    std::pair<Type, std::optional<Error>> analyzeExpression(Expression*& expr);
+    std::pair<Type, std::optional<Error>> analyzeArrayExpression(ArrayExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeBinaryExpression(BinaryExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeCallExpression(CallExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeIdentifierExpression(IdentifierExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeLambdaExpression(LambdaExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeLiteralExpression(LiteralExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeMemberExpression(MemberExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeTypeCheckExpression(TypeCheckExpression& expr);
+    std::pair<Type, std::optional<Error>> analyzeUnaryExpression(UnaryExpression& expr);
+};
+
+// 逃逸分析：在语义分析之后遍历 AST，找出只在当前函数内通过字段访问和方法调用使用、
+// 不会被保存、传参或返回的新建对象，标记 CallExpression::stackAllocated，
+// IRGen 把这些对象分配在栈上，不经过 gc_alloc。
+// 被跟踪的对象有三种：for 循环的迭代对象、直接作为接收者的临时对象、
+// 以构造调用初始化且之后不被重新赋值的局部变量。
+// 对象的构造过程和被调用的方法都要求 self 不逃逸，方法按对象的实际类型解析。
+class EscapeAnalyzer
+{
+private:
+    enum class State
+    {
+        UNKNOWN,
+        VISITING,
+        CAPTURED,
+        ESCAPED,
+    };
+
+    struct Candidate
+    {
+        CallExpression* site;
+        int             classId;
+        bool            escaped = false;
+    };
+
+    // 当前遍历的上下文：检查 self 时 selfClassId 为对象的实际类型，
+    // 遍历函数体时 candidates 记录以构造调用初始化的局部变量（按槽位）
+    struct Context
+    {
+        int                                 selfClassId = -1;
+        bool                                selfEscaped = false;
+        std::unordered_map<int, Candidate>* candidates  = nullptr;
+    };
+
+    const ClassTable&               classTable;
+    std::vector<State>              constructionStates;
+    std::vector<std::vector<State>> methodStates;
+    Context                         context;
+    std::vector<bool>               stackClasses;
+    int                             stackAllocations = 0;
+
+    bool constructionEscapes(int classId);
+    bool methodEscapes(int classId, int methodIndex);
+    bool iterationEscapes(int classId);
+
+    int  trackedClass(const Expression& expr) const;
+    void markEscaped(const Expression& expr);
+    void markStackAllocated(CallExpression& site);
+    int  allocatedClass(const Expression& expr) const;
+
+    void analyzeFunction(Statement& body);
+    void visitStatement(Statement& stmt);
+    void visitExpression(Expression& expr);
+    void visitMemberExpression(MemberExpression& expr);
+
+public:
+    explicit EscapeAnalyzer(const ClassTable& classTable);
+
+    // 返回改为栈上分配的构造调用数量
+    int analyze(Program& program);
+};
+
+struct PerfWarning
+{
+    // 估计的运行时开销：HIGH 为每次迭代一次堆分配，MEDIUM 为可避免的运行时调用或扫描，
+    // LOW 为可避免的间接调用
+    enum class Cost
+    {
+        LOW,
+        MEDIUM,
+        HIGH,
+    };
+
+    Location    location;
+    Cost        cost;
+    std::string message;
+
+    void print() const;
+};
+
+// --perf-lint：在语义分析（及逃逸分析）之后遍历用户代码，报告运行时开销大的写法：
+// 循环中的字符串拼接和堆上构造、循环中以 Range 循环变量为下标的 IntArray.at、
+// 对同一个字符串重复调用 len()，以及接收者的实际类型已知却仍经虚表的方法调用
+class PerfLinter
+{
+private:
+    // 对局部变量调用 len() 的位置，inLoop 表示调用位于变量定义之外的循环中
+    struct LengthSite
+    {
+        Location location;
+        bool     inLoop;
+    };
+
+    // 以下按局部变量槽位记录，每个函数开始时清空
+    const ClassTable&                                classTable;
+    std::vector<PerfWarning>                         warnings;
+    int                                              loopDepth = 0;
+    std::unordered_map<int, int>                     slotDepths;         // 定义时的循环层数
+    std::unordered_set<int>                          countedLoopSlots;   // 计数循环的循环变量
+    std::unordered_map<int, int>                     exactClasses;       // 以构造调用初始化的 val
+    std::unordered_set<int>                          assignedSlots;
+    std::unordered_map<int, std::vector<LengthSite>> lengthSites;
+
+    void lintFunction(const Statement& body);
+    void visitStatement(const Statement& stmt);
+    void visitExpression(const Expression& expr);
+    void visitCall(const CallExpression& expr);
+    void visitMethodCall(const MemberExpression& expr);
+    void report(const Location& location, PerfWarning::Cost cost, std::string message);
+
+public:
+    explicit PerfLinter(const ClassTable& classTable)
+        : classTable(classTable)
+    {
+    }
+
+    // 只检查 files 中的源文件，标准库不报告
+    std::vector<PerfWarning> lint(const Program& program, const std::vector<std::string>& files);
 };
 
 #endif
\ No newline at end of file
@@ -25,7 +25,10 @@ inline const std::vector<std::string> BUILTIN_FUNC = {
 
     // builtin utils function
     "_concat_strs",
+    "_str_equals",
+    "_str_hash",
     "clone",
+    "is_null",
 
     // array mem function
     "_builtin_malloc",
@@ -37,13 +40,14 @@ inline const std::vector<std::string> BUILTIN_CLASS = {"Object", "String", "Rang
 }   // namespace BUILTIN
 
 namespace OBJECT_LAYOUT {
-const int SIZE_OFFSET       = 1;
+// 对象头只有一个虚表指针
 const int VTABLE_OFFSET     = 0;
-const int BUILTIN_FIELD_NUM = 2;
-const int VALID_OFFSET      = 2;
+const int BUILTIN_FIELD_NUM = 1;
 
-
-const int BUILTIN_METHOD_NUM = 3;
+// 虚表开头是类编号、子树中最大的编号和对象大小，之后才是方法指针
+const int VTABLE_CLASS_ID        = 0;
+const int VTABLE_LAST_DESCENDANT = 1;
+const int VTABLE_OBJECT_SIZE     = 2;
 }   // namespace OBJECT_LAYOUT
 
 #endif
@@ -0,0 +1,34 @@
+#ifndef CASTING_HPP
+#define CASTING_HPP
+
+#include <cassert>
+#include <type_traits>
+
+// LLVM 风格的类型判断与转换：To 需要提供 static bool classof(const Base*)，
+// 通过节点上的 kind 标签判断，不依赖 RTTI
+
+template<typename To, typename From>
+using CastResult = std::conditional_t<std::is_const_v<From>, const To*, To*>;
+
+template<typename To, typename From> bool isa(From* node)
+{
+    assert(node != nullptr && "isa<> on a null pointer");
+    return To::classof(node);
+}
+
+template<typename To, typename From> CastResult<To, From> cast(From* node)
+{
+    assert(isa<To>(node) && "cast<> argument of incompatible type");
+    return static_cast<CastResult<To, From>>(node);
+}
+
+// node 为空或类型不匹配时返回 nullptr
+template<typename To, typename From> CastResult<To, From> dyn_cast(From* node)
+{
+    if (node == nullptr || !To::classof(node)) {
+        return nullptr;
+    }
+    return static_cast<CastResult<To, From>>(node);
+}
+
+#endif   // CASTING_HPP
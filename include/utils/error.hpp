@@ -9,6 +9,8 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 
 namespace Color {
 const std::string RESET  = "\033[0m";
@@ -52,32 +54,75 @@ inline void cout_cyan(const std::string& s)
 
 struct Location
 {
-    int         line     = 0;
-    int         column   = 0;
-    std::string filename = "";
+    int              line   = 0;
+    int              column = 0;
+    std::string_view filename;   // 指向 internFilename 中的常驻字符串，Location 可以随意拷贝
 
-    Location(int l, int c, const std::string& fname = "")
+    Location(int l, int c, std::string_view fname = {})
         : line(l)
         , column(c)
-        , filename(fname)
+        , filename(internFilename(fname))
     {
     }
-    Location()
-        : line(0)
-        , column(0)
-        , filename("")
+    Location() = default;
+
+    // 同一个文件名只保存一份；lexer 连续传入同一个已驻留的名字时直接命中缓存
+    static std::string_view internFilename(std::string_view name)
     {
+        static std::unordered_set<std::string> pool;
+        static std::string_view                last;
+        if (name.empty()) return {};
+        if (name.data() == last.data() && name.size() == last.size()) return last;
+        last = *pool.emplace(name).first;
+        return last;
     }
 
     std::string to_string() { return Format("{0}:{1}:{2}", filename, line, column); }
 };
 
+// 打印 location 所在行及其前后各一行，并在对应列下标出 ^
+inline void printSourceContext(const Location& location, void (*printCaret)(const std::string&))
+{
+    int line   = location.line;
+    int column = location.column;
+
+    if (location.filename.empty() || !std::filesystem::exists(location.filename)) {
+        return;
+    }
+
+    std::ifstream file{std::string(location.filename)};
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string currentLine;
+    int         currentLineNumber = 0;
+    std::string lineNumberStr;
+
+    while (std::getline(file, currentLine) && currentLineNumber < line + 1) {
+        currentLineNumber++;
+
+        if (currentLineNumber >= line - 1 && currentLineNumber <= line + 1) {
+            lineNumberStr = std::to_string(currentLineNumber);
+            std::cout << lineNumberStr << " | " << currentLine << std::endl;
+
+            if (currentLineNumber == line) {
+                int padding = column + lineNumberStr.length() + 3;   // +3 for " | "
+                std::cout << std::string(padding, ' ');
+                printCaret("^\n");
+            }
+        }
+    }
+
+    file.close();
+}
+
 struct Error
 {
     std::string             message;
     std::optional<Location> location;
 
-    Error(const std::string& msg, int l, int c, const std::string& fname = "")
+    Error(const std::string& msg, int l, int c, std::string_view fname = {})
         : message(msg)
         , location(Location(l, c, fname))
     {
@@ -95,45 +140,12 @@ struct Error
     void print() const
     {
         if (location) {
-            std::cerr << (location->filename.empty() ? "" : location->filename + ":")
+            std::cerr << (location->filename.empty() ? "" : std::string(location->filename) + ":")
                       << location->line << ":" << location->column << ": ";
         }
         cout_red(Format("error: {}\n", message));
 
-        if (location) {
-            int line   = location->line;
-            int column = location->column;
-
-            if (location->filename.empty() || !std::filesystem::exists(location->filename)) {
-                return;
-            }
-
-            std::ifstream file(location->filename);
-            if (!file.is_open()) {
-                return;
-            }
-
-            std::string currentLine;
-            int         currentLineNumber = 0;
-            std::string lineNumberStr;
-
-            while (std::getline(file, currentLine) && currentLineNumber < line + 1) {
-                currentLineNumber++;
-
-                if (currentLineNumber >= line - 1 && currentLineNumber <= line + 1) {
-                    lineNumberStr = std::to_string(currentLineNumber);
-                    std::cout << lineNumberStr << " | " << currentLine << std::endl;
-
-                    if (currentLineNumber == line) {
-                        int padding = column + lineNumberStr.length() + 3;   // +3 for " | "
-                        std::cout << std::string(padding, ' ');
-                        cout_red("^\n");
-                    }
-                }
-            }
-
-            file.close();
-        }
+        if (location) printSourceContext(*location, cout_red);
     }
 };
 
@@ -2,11 +2,19 @@
 #define PROCESS_HPP
 
 #include "lexer/token.hpp"
+#include "semantic/semantic.hpp"
 
 #include <algorithm>
 #include <string>
 #include <vector>
 
+// 命令行中除输入文件外的编译选项
+struct CompileOptions
+{
+    int  constEvalBudget = ConstantEvaluator::DEFAULT_BUDGET;
+    bool perfLint        = false;
+    bool printLayouts    = false;
+};
 
 void        collectLibFiles(const std::string& stdLibPath, const std::string& extension,
                                std::vector<std::string>& stdLibFiles);
@@ -15,7 +23,7 @@ void        collectDirectoryFiles(const std::string& dirPath, const std::string&
 std::string getLibPath(std::string name);
 std::string readFile(const std::string& filepath);
 void        processFiles(const std::vector<std::string>& stdLibFiles,
-                         const std::vector<std::string>& userFiles);
+                         const std::vector<std::string>& userFiles, const CompileOptions& options);
 void        printUsage(const char* programName);
 void        printLogo();
 
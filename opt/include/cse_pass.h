@@ -25,7 +25,8 @@ struct CSEExpression
         CMP_INST,
         CAST_OP,
         GETELEMENTPTR_INST,
-        LOAD_INST
+        LOAD_INST,
+        CALL_INST
     };
     ExpressionType            exprType;
     unsigned                  opcode;
@@ -50,8 +51,27 @@ struct CSEPass : PassInfoMixin<CSEPass>
     }
 
 private:
+    // 不写内存、不抛异常且一定返回的调用，被调用者和参数相同时结果相同；
+    // 只读内存的调用还要求两次调用之间没有写内存
+    bool isPureCall(Instruction* I, bool readOnly)
+    {
+        auto* call = dyn_cast<CallInst>(I);
+        if (!call || call->getType()->isVoidTy() || call->mayHaveSideEffects())
+            return false;
+        return readOnly ? call->onlyReadsMemory() && !call->doesNotAccessMemory()
+                        : call->doesNotAccessMemory();
+    }
+
+    // 标记为 !invariant.load 的读取：所读位置不会改变，中间写内存不影响结果
+    bool isInvariantLoad(Instruction* I)
+    {
+        auto* load = dyn_cast<LoadInst>(I);
+        return load && !load->isVolatile() && load->hasMetadata(LLVMContext::MD_invariant_load);
+    }
+
     bool canCSE(Instruction* I)
     {
+        if (isPureCall(I, false) || isInvariantLoad(I)) return true;
         if (I->mayHaveSideEffects() || I->mayReadFromMemory() || I->isTerminator() ||
             isa<PHINode>(I) || isa<CallInst>(I) || isa<InvokeInst>(I))
             return false;
@@ -23,6 +23,8 @@ CSEExpression::CSEExpression(Instruction& inst)
         this->exprType = CSEExpression::ExpressionType::GETELEMENTPTR_INST;
     else if (isa<LoadInst>(&inst))
         this->exprType = CSEExpression::ExpressionType::LOAD_INST;
+    else if (isa<CallInst>(&inst))
+        this->exprType = CSEExpression::ExpressionType::CALL_INST;
 
     this->opcode        = inst.getOpcode();
     this->ty            = inst.getType();
@@ -58,7 +60,21 @@ PreservedAnalyses CSEPass::run(Function& F, FunctionAnalysisManager& AM)
     std::unordered_map<CSEExpression, Instruction*> map;
     for (auto& block : F) {
         std::vector<Instruction*> toRemove;
+        // 只读内存的调用只在基本块内合并，遇到可能写内存的指令就失效
+        std::unordered_map<CSEExpression, Instruction*> readOnlyCalls;
         for (auto& inst : block) {
+            if (isPureCall(&inst, true)) {
+                CSEExpression cseExpr{inst};
+
+                auto [iter, inserted] = readOnlyCalls.emplace(cseExpr, &inst);
+                if (!inserted) {
+                    inst.replaceAllUsesWith(iter->second);
+                    toRemove.push_back(&inst);
+                    changed = true;
+                }
+                continue;
+            }
+            if (inst.mayWriteToMemory()) readOnlyCalls.clear();
             if (!canCSE(&inst)) continue;
             CSEExpression cseExpr{inst};
 
@@ -1,215 +1,263 @@
 #include "ir/ir.hpp"
 #include "utils/format.hpp"
 
+#include <unordered_set>
+
 void IRGen::generateDeclaration(const Declaration& decl)
 {
-    if (const auto* classDecl = dynamic_cast<const ClassDeclaration*>(&decl)) {
-        generateClassDeclaration(*classDecl);
-    }
-    else if (const auto* enumDecl = dynamic_cast<const EnumDeclaration*>(&decl)) {
-        generateEnumDeclaration(*enumDecl);
-    }
-    else if (const auto* funcDecl = dynamic_cast<const FunctionDeclaration*>(&decl)) {
-        if (std::count(
-                BUILTIN::BUILTIN_FUNC.begin(), BUILTIN::BUILTIN_FUNC.end(), funcDecl->name)) {
-            return;
+    switch (decl.getNodeKind()) {
+        case NodeKind::CLASS_DECL: generateClassDeclaration(*cast<ClassDeclaration>(&decl)); break;
+        case NodeKind::ENUM_DECL: generateEnumDeclaration(*cast<EnumDeclaration>(&decl)); break;
+        case NodeKind::FUNCTION_DECL: {
+            const auto* funcDecl = cast<FunctionDeclaration>(&decl);
+            if (std::count(
+                    BUILTIN::BUILTIN_FUNC.begin(), BUILTIN::BUILTIN_FUNC.end(), funcDecl->name)) {
+                return;
+            }
+            generateFunctionDeclaration(*funcDecl);
+            break;
         }
-        generateFunctionDeclaration(*funcDecl);
+        default: break;
     }
 }
 
 void IRGen::generateClassDeclaration(const ClassDeclaration& decl)
 {
-    this->valueTable.enterScope(decl.name);
-    this->currClass = &decl;
-    int offset      = OBJECT_LAYOUT::BUILTIN_FIELD_NUM;
-    for (const auto& param : this->classAllParams[decl.name]) {
-        std::string paramName = this->getParamName(param);
-        this->valueTable.add(paramName, IRValue(offset));
-        offset++;
-    }
-
+    this->currClass    = &decl;
+    this->constructing = true;
     this->generateClassMallocInit(decl);
-    this->generateClassBuiltinInit(decl);
-    this->generateClassConstructor(decl);
     for (const auto& member : decl.members) {
-        if (const auto method = dynamic_cast<const MethodMember*>(member.get())) {
+        if (const auto method = dyn_cast<MethodMember>(member)) {
+            this->constructing = false;
             generateFunctionDeclaration(*method->function);
         }
-        else if (const auto init = dynamic_cast<const InitBlockMember*>(member.get())) {
+        else if (const auto init = dyn_cast<InitBlockMember>(member)) {
+            this->constructing = true;
             this->generateClassSelfDefinedInit(*init, decl.name);
         }
     }
-    this->currClass = nullptr;
-    this->valueTable.exitScope();
+    this->currClass    = nullptr;
+    this->constructing = false;
 }
 
-void IRGen::generateClassBuiltinInit(const ClassDeclaration& decl)
+// 在当前插入点初始化 decl 这一层：先写本类新增字段的初始值，再内联父类这一层，
+// 然后写入构造参数，最后调用 init 块。self 为 i8*，args 为本类的构造参数
+void IRGen::generateClassInit(const ClassDeclaration& decl, llvm::Value* self,
+                              const std::vector<llvm::Value*>& args)
 {
-
-    this->currFuncName = "builtin_init";
-    this->valueTable.enterScope(Format("{0}_{1}", decl.name, this->currFuncName));
-    llvm::Function* function = this->getCurrFunc();
-    auto            entryBB  = llvm::BasicBlock::Create(*this->context, "entry", function);
-    this->builder->SetInsertPoint(entryBB);
-
-    auto self = this->builder->CreateBitCast(
-        this->getCurrFunc()->getArg(0), this->generateType(decl.name, true), "self");
-
-    int offset = OBJECT_LAYOUT::BUILTIN_FIELD_NUM;
-    for (const auto& param : this->classAllParams[decl.name]) {
-        const Expression* initExpr  = this->getParamInitExpr(param);
-        std::string       paramName = this->getParamName(param);
-        if (initExpr != nullptr) {
-            auto initValue = generateExpression(*initExpr);
-            auto ptr =
-                this->builder->CreateStructGEP(this->generateType(this->currClass->name, false),
-                                               self,
-                                               offset,
-                                               Format("{0}_ptr", paramName));
-            this->builder->CreateStore(initValue, ptr);
+    const ClassDeclaration* outerClass        = this->currClass;
+    llvm::Value*            outerObject       = this->constructedObject;
+    llvm::Value*            outerSelfPtr      = this->selfPtr;
+    bool                    outerConstructing = this->constructing;
+    this->currClass                           = &decl;
+    this->constructedObject                   = self;
+    this->selfPtr                             = nullptr;
+    this->constructing                        = true;
+
+    Type         classType  = Type::classType(decl.name);
+    llvm::Type*  structType = this->generateType(decl.name, false);
+    const auto*  layout     = this->classTable.getLayout(classType);
+    llvm::Value* typedSelf =
+        this->builder->CreateBitCast(self, this->generateType(decl.name, true), "self");
+    auto storeField = [&](int fieldIndex, llvm::Value* value) {
+        const auto& field = layout->fields[fieldIndex];
+        auto        ptr   = this->builder->CreateStructGEP(
+            structType,
+            typedSelf,
+            this->getFieldSlot(classType, fieldIndex),
+            Format("{0}_ptr", this->getParamName(field)));
+        llvm::Type* fieldType = this->getParamType(field);
+        if (value->getType() != fieldType) {
+            value = this->builder->CreateBitCast(value, fieldType, "bit_cast");
+        }
+        auto store = this->builder->CreateStore(value, ptr);
+        this->setFieldTBAA(store, classType, fieldIndex);
+    };
+
+    const ClassDeclaration* parent =
+        decl.baseClass.empty() ? nullptr : this->classTable.find(decl.baseClass);
+    size_t inherited =
+        parent ? this->classTable.getLayout(Type::classType(parent->name))->fields.size() : 0;
+    for (size_t i = inherited; i < layout->fields.size(); i++) {
+        if (const Expression* initExpr = this->getParamInitExpr(layout->fields[i])) {
+            storeField(i, generateExpression(*initExpr));
         }
-        offset++;
-    }
-    builder->CreateRetVoid();
-    this->valueTable.exitScope();
-}
-
-void IRGen::generateClassConstructor(const ClassDeclaration& decl)
-{
-    this->currFuncName = "constructor";
-    this->valueTable.enterScope(Format("{0}_{1}", decl.name, this->currFuncName));
-    llvm::Function* function = this->getCurrFunc();
-    auto            entryBB  = llvm::BasicBlock::Create(*this->context, "entry", function);
-    this->builder->SetInsertPoint(entryBB);
-
-    llvm::Type*  classType = this->generateType(decl.name, false);
-    llvm::Value* selfI8    = this->getCurrFunc()->getArg(0);
-    llvm::Value* self =
-        this->builder->CreateBitCast(selfI8, this->generateType(decl.name, true), "self");
-
-    auto builtinInitName = Format("{0}_builtin_init", decl.name);
-    if (this->methodMap.count(builtinInitName)) {
-        this->builder->CreateCall(this->module->getFunction(builtinInitName), {selfI8});
     }
 
-    if (!decl.baseClass.empty()) {
-        auto baseClass       = this->classTable.find(decl.baseClass);
-        auto baseClassName   = baseClass->name;
-        auto castToBaseClass = this->builder->CreateBitCast(
-            self, llvm::PointerType::get(this->generateType(baseClassName, false), 0), "bit_cast");
-
-        std::vector<llvm::Value*> constructorArgs = {selfI8};
-        for (const auto& param : decl.baseConstructorArgs) {
-            auto value = generateExpression(*param);
-            constructorArgs.push_back(value);
+    if (parent) {
+        std::vector<llvm::Value*> baseArgs;
+        for (const auto* arg : decl.baseConstructorArgs) {
+            baseArgs.push_back(generateExpression(*arg));
         }
-
-        auto diff = baseClass->constructorParameters.size() - (constructorArgs.size() - 1);
-        if (diff > 0) {
-            for (int i = 0; i < diff; i++) {
-                auto value = generateExpression(
-                    *baseClass->constructorParameters[i + (constructorArgs.size() - 1)]
-                         .defaultValue);
-                constructorArgs.push_back(value);
-            }
+        for (size_t i = baseArgs.size(); i < parent->constructorParameters.size(); i++) {
+            baseArgs.push_back(generateExpression(*parent->constructorParameters[i].defaultValue));
         }
-        auto callBaseConstructor = this->builder->CreateCall(
-            this->module->getFunction(Format("{0}_constructor", baseClassName)),
-            constructorArgs,
-            "call_constructor");
-        self = this->builder->CreateBitCast(
-            callBaseConstructor, llvm::PointerType::get(classType, 0), "bit_cast");
+        this->generateClassInit(*parent, self, baseArgs);
     }
 
-    int paramOffset = 1;
-    for (const auto& param : decl.constructorParameters) {
-        auto         ptr      = this->builder->CreateStructGEP(this->generateType(decl.name, false),
-                                                  self,
-                                                  this->valueTable.find(param.name)->getOffset(),
-                                                  Format("{0}_ptr", param.name));
-        llvm::Value* argValue = function->getArg(paramOffset);
-        this->builder->CreateStore(argValue, ptr);
-        paramOffset++;
+    for (size_t i = 0; i < decl.constructorParameters.size(); i++) {
+        storeField(layout->fieldIndex.at(decl.constructorParameters[i].name), args[i]);
     }
 
-    auto selfDefinedInitName = Format("{0}_self_defined_init", decl.name);
-    if (this->methodMap.count(selfDefinedInitName)) {
-        this->builder->CreateCall(this->module->getFunction(selfDefinedInitName), {selfI8});
+    auto selfDefinedInit = this->methodMap.find(Format("{0}_self_defined_init", decl.name));
+    if (selfDefinedInit != this->methodMap.end()) {
+        this->builder->CreateCall(selfDefinedInit->second, {self});
     }
 
-
-    this->builder->CreateRet(self);
-    this->valueTable.exitScope();
+    this->currClass         = outerClass;
+    this->constructedObject = outerObject;
+    this->selfPtr           = outerSelfPtr;
+    this->constructing      = outerConstructing;
 }
 
+// 分配和整条构造链合成一个函数，父类的初始化直接展开在其中
 void IRGen::generateClassMallocInit(const ClassDeclaration& decl)
 {
     this->currFuncName = "malloc_init";
-    this->valueTable.enterScope(Format("{0}_{1}", decl.name, this->currFuncName));
     llvm::Function* function = this->getCurrFunc();
     auto            entryBB  = llvm::BasicBlock::Create(*this->context, "entry", function);
     this->builder->SetInsertPoint(entryBB);
 
-    llvm::Type* classType    = this->generateType(decl.name, false);
-    uint64_t    typeSize     = this->dataLayout->getTypeAllocSize(classType);
-    auto        sizeValue    = llvm::ConstantInt::get(llvm::Type::getInt64Ty(*context), typeSize);
-    auto        sizeValuei32 = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), typeSize);
+    llvm::Type* classType = this->generateType(decl.name, false);
+    uint64_t    typeSize  = this->dataLayout->getTypeAllocSize(classType);
+    auto        sizeValue = llvm::ConstantInt::get(llvm::Type::getInt64Ty(*context), typeSize);
     auto        mallocCall =
         this->builder->CreateCall(this->methodMap["malloc"], {sizeValue}, "call_gc_alloc");
     auto mallocResult = builder->CreateBitCast(mallocCall, llvm::PointerType::get(classType, 0));
+    this->generateObjectHeader(decl, mallocResult);
 
-    auto sizePtr = this->builder->CreateStructGEP(
-        classType, mallocResult, OBJECT_LAYOUT::SIZE_OFFSET, "size_ptr");
-    this->builder->CreateStore(sizeValuei32, sizePtr);
+    std::vector<llvm::Value*> args;
+    for (auto& arg : function->args()) {
+        args.push_back(&arg);
+    }
+    this->generateClassInit(decl, mallocCall, args);
 
-    std::string vTableName = Format("vTable_{0}", decl.name);
-    auto        ptr        = this->builder->CreateStructGEP(
-        classType, mallocResult, OBJECT_LAYOUT::VTABLE_OFFSET, "vtable_ptr");
-    this->builder->CreateStore(this->vTableVars[vTableName], ptr);
+    this->builder->CreateRet(mallocResult);
+    if (this->initializesAllFields(mallocCall, mallocCall, classType)) {
+        mallocCall->setCalledFunction(this->methodMap["malloc_uninit"]);
+    }
+}
 
-    std::vector<llvm::Value*> constructorArgs;
-    constructorArgs.push_back(mallocCall);
+// 从 start 之后沿基本块向下，判断 object 的虚表指针和每个字段是否在可能被读到之前都已写入；
+// 遇到读取未写入的字段、把对象指针存到别处、调用函数（可能触发回收或读取对象）
+// 或者基本块结束时停止。成立时分配出的内存不需要先清零
+bool IRGen::initializesAllFields(llvm::Instruction* start, llvm::Value* object,
+                                 llvm::Type* classType)
+{
+    std::unordered_set<llvm::Value*>           objectPtrs = {object};
+    std::unordered_map<llvm::Value*, uint64_t> fieldPtrs;   // 指向字段的指针及其偏移
+    std::unordered_set<uint64_t>               written;
+
+    auto usesObject = [&](llvm::Value* value) {
+        return objectPtrs.count(value) || fieldPtrs.count(value);
+    };
+
+    for (auto it = std::next(start->getIterator()); it != start->getParent()->end(); ++it) {
+        llvm::Instruction* inst = &*it;
+        if (auto* cast = llvm::dyn_cast<llvm::BitCastInst>(inst)) {
+            if (objectPtrs.count(cast->getOperand(0))) objectPtrs.insert(cast);
+            continue;
+        }
+        if (auto* gep = llvm::dyn_cast<llvm::GetElementPtrInst>(inst)) {
+            if (!objectPtrs.count(gep->getPointerOperand())) continue;
+            llvm::APInt offset(64, 0);
+            if (!gep->accumulateConstantOffset(*this->dataLayout, offset)) break;
+            fieldPtrs[gep] = offset.getZExtValue();
+            continue;
+        }
+        if (auto* store = llvm::dyn_cast<llvm::StoreInst>(inst)) {
+            if (usesObject(store->getValueOperand())) break;
+            auto field = fieldPtrs.find(store->getPointerOperand());
+            if (field != fieldPtrs.end()) written.insert(field->second);
+            continue;
+        }
+        if (auto* load = llvm::dyn_cast<llvm::LoadInst>(inst)) {
+            auto field = fieldPtrs.find(load->getPointerOperand());
+            if (field != fieldPtrs.end() && !written.count(field->second)) break;
+            continue;
+        }
+        if (inst->mayReadOrWriteMemory() || inst->isTerminator() ||
+            std::any_of(inst->op_begin(), inst->op_end(), [&](const llvm::Use& use) {
+                return usesObject(use.get());
+            })) {
+            break;
+        }
+    }
 
-    for (unsigned i = 0; i < function->arg_size(); ++i) {
-        constructorArgs.push_back(function->getArg(i));
+    const auto* layout = this->dataLayout->getStructLayout(llvm::cast<llvm::StructType>(classType));
+    for (unsigned i = 0; i < classType->getStructNumElements(); i++) {
+        if (!written.count(layout->getElementOffset(i))) return false;
     }
+    return true;
+}
 
-    auto constructorFunc = this->module->getFunction(Format("{0}_constructor", decl.name));
-    auto self = this->builder->CreateCall(constructorFunc, constructorArgs, "call_construtor");
+void IRGen::generateObjectHeader(const ClassDeclaration& decl, llvm::Value* object)
+{
+    llvm::Type* classType  = this->generateType(decl.name, false);
+    std::string vTableName = Format("vTable_{0}", decl.name);
+    auto        ptr        = this->builder->CreateStructGEP(
+        classType, object, OBJECT_LAYOUT::VTABLE_OFFSET, "vtable_ptr");
+    auto store = this->builder->CreateStore(this->vTableVars[vTableName], ptr);
+    this->setVTableTBAA(store, Type::classType(decl.name));
+}
 
-    this->builder->CreateRet(self);
-    this->valueTable.exitScope();
+// 逃逸分析确认不会逃出当前函数的对象：在栈上分配，像 gc_alloc 一样清零后写入对象头，
+// 构造链直接展开在当前函数中，所有字段都被写入时去掉清零；
+// 对象不登记到 GC 中，其中的指针字段仍会被 GC 扫描栈时看到
+llvm::Value* IRGen::generateStackObject(const ClassDeclaration&          decl,
+                                        const std::vector<llvm::Value*>& constructorArgs)
+{
+    this->seesStackObject = true;
+    llvm::Type* classType = this->generateType(decl.name, false);
+    auto        object    = this->allocateStackVariable(Format("{0}_stack", decl.name), classType);
+    auto        memset    = this->builder->CreateMemSet(object,
+                                                this->builder->getInt8(0),
+                                                this->dataLayout->getTypeAllocSize(classType),
+                                                object->getAlign());
+    this->generateObjectHeader(decl, object);
+    auto self = this->builder->CreateBitCast(object, this->int8PtrTy, "stack_object");
+    this->generateClassInit(decl, self, constructorArgs);
+    if (this->initializesAllFields(memset, object, classType)) {
+        memset->eraseFromParent();
+    }
+    return object;
 }
 
 void IRGen::generateClassSelfDefinedInit(const InitBlockMember& init, const std::string& className)
 {
     this->currFuncName = "self_defined_init";
-    this->valueTable.enterScope(Format("{0}_{1}", className, this->currFuncName));
     llvm::Function* function = this->getCurrFunc();
     auto            entryBB  = llvm::BasicBlock::Create(*this->context, "entry", function);
     this->builder->SetInsertPoint(entryBB);
 
-    auto selfVal = this->builder->CreateBitCast(
-        function->getArg(0), this->generateType(className, true), "self");
-    this->valueTable.add("self", IRValue(selfVal));
+    llvm::Value* undef = llvm::UndefValue::get(this->int32Ty);
+    this->allocaInsertPoint =
+        new llvm::BitCastInst(undef, undef->getType(), "alloca.point", entryBB);
+    this->locals.assign(init.localCount, nullptr);
+    this->seesStackObject = this->selfMayBeOnStack(*this->currClass);
+
+    llvm::Type*  selfType = this->generateType(className, true);
+    llvm::Value* selfVar  = allocateStackVariable("self", selfType);
+    llvm::Value* selfVal  = this->builder->CreateBitCast(function->getArg(0), selfType, "self");
+    this->builder->CreateStore(selfVal, selfVar, false);
+    this->selfPtr = selfVar;
 
     generateBlockStatement(*init.block);
 
     this->builder->CreateRetVoid();
-    this->valueTable.exitScope();
+    this->dropInvariantLoads(function);
+    this->allocaInsertPoint->eraseFromParent();
+    this->allocaInsertPoint = nullptr;
+    this->selfPtr           = nullptr;
 }
 
 
-void IRGen::generateEnumDeclaration(const EnumDeclaration& decl)
-{
-    throw "Not yet implemented generateEnumDeclaration";
-}
+// 枚举值在使用处生成为整数常量，声明本身不产生代码
+void IRGen::generateEnumDeclaration(const EnumDeclaration& decl) {}
 
 void IRGen::generateFunctionDeclaration(const FunctionDeclaration& decl)
 {
     this->currFuncName = decl.name == "main" ? "builtin_main" : decl.name;
-    this->valueTable.enterScope(decl.name);
 
     llvm::Function* function = this->getCurrFunc();
     auto            entryBB  = llvm::BasicBlock::Create(*this->context, "entry", function);
@@ -218,6 +266,8 @@ void IRGen::generateFunctionDeclaration(const FunctionDeclaration& decl)
     llvm::Value* undef = llvm::UndefValue::get(this->int32Ty);
     this->allocaInsertPoint =
         new llvm::BitCastInst(undef, undef->getType(), "alloca.point", entryBB);
+    this->locals.assign(decl.localCount, nullptr);
+    this->seesStackObject = this->currClass && this->selfMayBeOnStack(*this->currClass);
 
     bool isVoid = decl.returnType->isVoid();
     if (!isVoid) {
@@ -234,14 +284,15 @@ void IRGen::generateFunctionDeclaration(const FunctionDeclaration& decl)
         llvm::Value* selfArg =
             this->builder->CreateBitCast(function->getArg(paramOffset++), selfType, "self");
         this->builder->CreateStore(selfArg, selfVar, false);
-        this->valueTable.add("self", IRValue(selfVar));
+        this->selfPtr = selfVar;
     }
-    for (const auto& param : decl.parameters) {
+    for (size_t i = 0; i < decl.parameters.size(); i++) {
+        const auto&  param     = decl.parameters[i];
         llvm::Type*  paramType = this->generateType(*param.type, true);
         llvm::Value* paramVar  = allocateStackVariable(param.name, paramType);
         llvm::Value* argValue  = function->getArg(paramOffset++);
         this->builder->CreateStore(argValue, paramVar, false);
-        this->valueTable.add(param.name, IRValue(paramVar));
+        this->locals[i] = paramVar;
     }
 
     this->generateStatement(*decl.body);
@@ -260,6 +311,6 @@ void IRGen::generateFunctionDeclaration(const FunctionDeclaration& decl)
         llvm::Value* returnValue = builder->CreateLoad(returnType, retVal, "return_value");
         builder->CreateRet(returnValue);
     }
-
-    this->valueTable.exitScope();
+    this->dropInvariantLoads(function);
+    this->selfPtr = nullptr;
 }
@@ -3,33 +3,20 @@
 
 llvm::Value* IRGen::generateExpression(const Expression& expr)
 {
-
-    if (const auto* arrayExpr = dynamic_cast<const ArrayExpression*>(&expr)) {
-        return generateArrayExpression(*arrayExpr);
-    }
-    else if (const auto* binaryExpr = dynamic_cast<const BinaryExpression*>(&expr)) {
-        return generateBinaryExpression(*binaryExpr);
-    }
-    else if (const auto* callExpr = dynamic_cast<const CallExpression*>(&expr)) {
-        return generateCallExpression(*callExpr);
-    }
-    else if (const auto* idExpr = dynamic_cast<const IdentifierExpression*>(&expr)) {
-        return generateIdentifierExpression(*idExpr);
-    }
-    else if (const auto* lambdaExpr = dynamic_cast<const LambdaExpression*>(&expr)) {
-        return generateLambdaExpression(*lambdaExpr);
-    }
-    else if (const auto* literalExpr = dynamic_cast<const LiteralExpression*>(&expr)) {
-        return generateLiteralExpression(*literalExpr);
-    }
-    else if (const auto* memberExpr = dynamic_cast<const MemberExpression*>(&expr)) {
-        return generateMemberExpression(*memberExpr);
-    }
-    else if (const auto* typeCheckExpr = dynamic_cast<const TypeCheckExpression*>(&expr)) {
-        return generateTypeCheckExpression(*typeCheckExpr);
-    }
-    else if (const auto* unaryExpr = dynamic_cast<const UnaryExpression*>(&expr)) {
-        return generateUnaryExpression(*unaryExpr);
+    switch (expr.getNodeKind()) {
+        case NodeKind::ARRAY_EXPR: return generateArrayExpression(*cast<ArrayExpression>(&expr));
+        case NodeKind::BINARY_EXPR: return generateBinaryExpression(*cast<BinaryExpression>(&expr));
+        case NodeKind::CALL_EXPR: return generateCallExpression(*cast<CallExpression>(&expr));
+        case NodeKind::IDENTIFIER_EXPR:
+            return generateIdentifierExpression(*cast<IdentifierExpression>(&expr));
+        case NodeKind::LAMBDA_EXPR: return generateLambdaExpression(*cast<LambdaExpression>(&expr));
+        case NodeKind::LITERAL_EXPR:
+            return generateLiteralExpression(*cast<LiteralExpression>(&expr));
+        case NodeKind::MEMBER_EXPR: return generateMemberExpression(*cast<MemberExpression>(&expr));
+        case NodeKind::TYPE_CHECK_EXPR:
+            return generateTypeCheckExpression(*cast<TypeCheckExpression>(&expr));
+        case NodeKind::UNARY_EXPR: return generateUnaryExpression(*cast<UnaryExpression>(&expr));
+        default: break;
     }
     return nullptr;
 }
@@ -41,27 +28,34 @@ llvm::Value* IRGen::generateArrayExpression(const ArrayExpression& expr)
 
 llvm::Value* IRGen::generateBinaryExpression(const BinaryExpression& expr)
 {
+    if (expr.op == BinaryExpression::Operator::AND || expr.op == BinaryExpression::Operator::OR) {
+        return generateLogicalExpression(expr);
+    }
     auto rightValue = generateExpression(*expr.right);
     if (expr.op == BinaryExpression::Operator::ASSIGN) {
         auto         leftType  = expr.left->getType();
         auto         rightType = expr.right->getType();
         llvm::Value* leftPtr;
-        if (auto* identExpr = dynamic_cast<IdentifierExpression*>(expr.left.get())) {
+        // 写字段时记下字段所属的类和下标，用于 TBAA
+        std::optional<std::pair<Type, int>> field;
+        if (auto* identExpr = dyn_cast<IdentifierExpression>(expr.left)) {
             leftPtr = generateIdentifierExpressionPtr(*identExpr);
+            if (identExpr->binding.kind == Binding::Kind::FIELD) {
+                field = {Type::classType(this->currClass->name), identExpr->binding.index};
+            }
         }
-        else if (auto* memberExpr = dynamic_cast<MemberExpression*>(expr.left.get())) {
+        else if (auto* memberExpr = dyn_cast<MemberExpression>(expr.left)) {
             leftPtr = generateMemberExpressionPtr(*memberExpr);
+            field   = {memberExpr->object->getType(), memberExpr->binding.index};
         }
+        llvm::Value* value = rightValue;
         if (leftType != rightType) {
-            auto s = this->builder->CreateBitCast(
+            value = this->builder->CreateBitCast(
                 rightValue, this->generateType(leftType, true), "bit_cast");
-            this->builder->CreateStore(s, leftPtr);
-            return s;
-        }
-        else {
-            this->builder->CreateStore(rightValue, leftPtr);
-            return rightValue;
         }
+        auto store = this->builder->CreateStore(value, leftPtr);
+        if (field) this->setFieldTBAA(store, field->first, field->second);
+        return value;
     }
     auto leftValue = generateExpression(*expr.left);
 
@@ -119,20 +113,110 @@ llvm::Value* IRGen::generateBinaryExpression(const BinaryExpression& expr)
 
 
         case BinaryExpression::Operator::AND:
-            return this->builder->CreateAnd(leftValue, rightValue, "and");
         case BinaryExpression::Operator::OR:
-            return this->builder->CreateOr(leftValue, rightValue, "or");
         case BinaryExpression::Operator::ASSIGN: break;
     }
     return nullptr;
 }
 
+// 没有副作用、不会出错且代价很小的表达式，直接求值比多一次分支更便宜
+static bool isTrivialOperand(const Expression& expr)
+{
+    switch (expr.getNodeKind()) {
+        case NodeKind::LITERAL_EXPR: return true;
+        case NodeKind::IDENTIFIER_EXPR:
+        {
+            auto kind = cast<IdentifierExpression>(&expr)->binding.kind;
+            return kind == Binding::Kind::LOCAL || kind == Binding::Kind::SELF ||
+                   kind == Binding::Kind::FIELD;
+        }
+        case NodeKind::UNARY_EXPR: return isTrivialOperand(*cast<UnaryExpression>(&expr)->operand);
+        case NodeKind::BINARY_EXPR:
+        {
+            const auto* binary = cast<BinaryExpression>(&expr);
+            switch (binary->op) {
+                case BinaryExpression::Operator::DIV:
+                case BinaryExpression::Operator::MOD:
+                case BinaryExpression::Operator::AND:
+                case BinaryExpression::Operator::OR:
+                case BinaryExpression::Operator::ASSIGN: return false;
+                default: break;
+            }
+            // 字符串拼接会调用 _concat_strs
+            return !binary->getType().isStr() && isTrivialOperand(*binary->left) &&
+                   isTrivialOperand(*binary->right);
+        }
+        default: break;
+    }
+    return false;
+}
+
+// 推断条件多半成立还是多半不成立：== 比较多半不成立，!= 比较多半成立，
+// 与 LLVM 分支概率分析中比较指令的启发式一致；无法推断时不标注
+static std::optional<bool> likelyCondition(const Expression& expr)
+{
+    const auto* binary = dyn_cast<BinaryExpression>(&expr);
+    if (binary && binary->op == BinaryExpression::Operator::EQ) return false;
+    if (binary && binary->op == BinaryExpression::Operator::NEQ) return true;
+    const auto* unary = dyn_cast<UnaryExpression>(&expr);
+    if (unary && unary->op == UnaryExpression::Operator::NOT) {
+        auto likely = likelyCondition(*unary->operand);
+        if (likely) return !*likely;
+    }
+    return std::nullopt;
+}
+
+// && 和 || 短路求值：右侧只在左侧不能决定结果时求值，结果由 phi 合并
+llvm::Value* IRGen::generateLogicalExpression(const BinaryExpression& expr)
+{
+    bool isAnd     = expr.op == BinaryExpression::Operator::AND;
+    auto leftValue = generateExpression(*expr.left);
+    if (isTrivialOperand(*expr.right)) {
+        auto rightValue = generateExpression(*expr.right);
+        return isAnd ? this->builder->CreateAnd(leftValue, rightValue, "and")
+                     : this->builder->CreateOr(leftValue, rightValue, "or");
+    }
+
+    auto              currFunc = this->builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* leftBB   = this->builder->GetInsertBlock();
+    llvm::BasicBlock* rightBB  = llvm::BasicBlock::Create(*context, isAnd ? "and.rhs" : "or.rhs");
+    llvm::BasicBlock* endBB    = llvm::BasicBlock::Create(*context, isAnd ? "and.end" : "or.end");
+
+    auto branch = isAnd ? this->builder->CreateCondBr(leftValue, rightBB, endBB)
+                        : this->builder->CreateCondBr(leftValue, endBB, rightBB);
+    if (auto likely = likelyCondition(*expr.left)) {
+        llvm::MDBuilder mdBuilder(*context);
+        branch->setMetadata(llvm::LLVMContext::MD_prof,
+                            *likely ? mdBuilder.createBranchWeights(20, 12)
+                                    : mdBuilder.createBranchWeights(12, 20));
+    }
+
+    rightBB->insertInto(currFunc);
+    this->builder->SetInsertPoint(rightBB);
+    auto rightValue = generateExpression(*expr.right);
+    rightBB         = this->builder->GetInsertBlock();
+    this->builder->CreateBr(endBB);
+
+    endBB->insertInto(currFunc);
+    this->builder->SetInsertPoint(endBB);
+    auto phi = this->builder->CreatePHI(this->boolTy, 2, isAnd ? "and" : "or");
+    phi->addIncoming(this->builder->getInt1(!isAnd), leftBB);
+    phi->addIncoming(rightValue, rightBB);
+    return phi;
+}
+
 llvm::Value* IRGen::generateCallExpression(const CallExpression& expr)
 {
 
-    auto       idExpr = dynamic_cast<IdentifierExpression*>(expr.callee.get());
-    const auto cls    = this->classTable.find(idExpr->name);
-    const auto func   = this->functionTable.find(idExpr->name);
+    const auto&                binding = cast<IdentifierExpression>(expr.callee)->binding;
+    const ClassDeclaration*    cls     = nullptr;
+    const FunctionDeclaration* func    = nullptr;
+    if (binding.kind == Binding::Kind::CLASS) {
+        cls = this->classTable.getClassById(binding.index);
+    }
+    else if (binding.kind == Binding::Kind::FUNCTION) {
+        func = this->functionTable.get(binding.index);
+    }
 
     std::vector<llvm::Value*> callArgs;
 
@@ -161,16 +245,17 @@ llvm::Value* IRGen::generateCallExpression(const CallExpression& expr)
 
     if (cls) {
         processArguments(cls->constructorParameters, expr.arguments);
+        if (expr.stackAllocated) {
+            return this->generateStackObject(*cls, callArgs);
+        }
         return this->builder->CreateCall(
-            this->module->getFunction(Format("{0}_malloc_init", cls->name)),
-            callArgs,
-            "call_malloc_init");
+            this->classMallocInits[binding.index], callArgs, "call_malloc_init");
     }
 
     if (func) {
         processArguments(func->parameters, expr.arguments);
         return this->builder->CreateCall(
-            this->module->getFunction(func->name),
+            this->functionValues[binding.index],
             callArgs,
             *func->returnType == Type::builtinVoid() ? "" : Format("call_{0}", func->name));
     }
@@ -180,30 +265,37 @@ llvm::Value* IRGen::generateCallExpression(const CallExpression& expr)
 
 llvm::Value* IRGen::generateIdentifierExpression(const IdentifierExpression& expr)
 {
-    auto ptr = generateIdentifierExpressionPtr(expr);
-    return this->builder->CreateLoad(this->generateType(expr.getType(), true), ptr, "idVal");
+    auto ptr  = generateIdentifierExpressionPtr(expr);
+    auto type = this->generateType(expr.getType(), true);
+    if (expr.binding.kind == Binding::Kind::FIELD) {
+        const auto* layout = this->classTable.getLayout(Type::classType(this->currClass->name));
+        auto load = generateFieldLoad(layout->fields[expr.binding.index], type, ptr, "idVal");
+        this->setFieldTBAA(load, Type::classType(this->currClass->name), expr.binding.index);
+        return load;
+    }
+    return this->builder->CreateLoad(type, ptr, "idVal");
 }
 
 llvm::Value* IRGen::generateIdentifierExpressionPtr(const IdentifierExpression& expr)
 {
     // return ptr
-    auto value = this->valueTable.find(expr.name);
-    switch (value->getKind()) {
-        case IRValueKind::PROPERTY:
+    switch (expr.binding.kind) {
+        case Binding::Kind::LOCAL: return this->locals[expr.binding.index];
+        case Binding::Kind::SELF: return this->selfPtr;
+        case Binding::Kind::FIELD:
         {
-            auto self =
-                this->builder->CreateBitCast(this->getCurrFunc()->getArg(0),
-                                             this->generateType(this->currClass->name, true),
-                                             "self");
-            return this->builder->CreateStructGEP(this->generateType(this->currClass->name, false),
-                                                  self,
-                                                  value->getOffset(),
-                                                  Format("{0}_ptr", expr.name));
-        }
-        case IRValueKind::PARAM:
-        {
-            return this->valueTable.find(expr.name)->getValue();
+            // 构造链展开在 malloc_init 或调用者中，self 不是当前函数的第一个参数
+            auto function = this->builder->GetInsertBlock()->getParent();
+            auto selfI8   = this->constructedObject ? this->constructedObject : function->getArg(0);
+            auto self     = this->builder->CreateBitCast(
+                selfI8, this->generateType(this->currClass->name, true), "self");
+            return this->builder->CreateStructGEP(
+                this->generateType(this->currClass->name, false),
+                self,
+                this->getFieldSlot(Type::classType(this->currClass->name), expr.binding.index),
+                Format("{0}_ptr", expr.name));
         }
+        default: break;
     }
     return nullptr;
 }
@@ -215,7 +307,7 @@ llvm::Value* IRGen::generateLambdaExpression(const LambdaExpression& expr)
 
 llvm::Value* IRGen::generateLiteralExpression(const LiteralExpression& expr)
 {
-    switch (expr.getType().kind) {
+    switch (expr.getType().getKind()) {
         case Type::Kind::INT: return this->builder->getInt32(std::get<int>(expr.value));
         case Type::Kind::FLOAT:
             return llvm::ConstantFP::get(llvm::Type::getFloatTy(*this->context),
@@ -226,6 +318,7 @@ llvm::Value* IRGen::generateLiteralExpression(const LiteralExpression& expr)
         case Type::Kind::EMPTY:
         case Type::Kind::VOID:
         case Type::Kind::CLASS:
+        case Type::Kind::ENUM:
         case Type::Kind::FUNCTION: break;
     }
     return nullptr;
@@ -233,95 +326,147 @@ llvm::Value* IRGen::generateLiteralExpression(const LiteralExpression& expr)
 
 llvm::Value* IRGen::generateMemberExpression(const MemberExpression& expr)
 {
-    auto        objectVal   = generateExpression(*expr.object);
-    const auto* objectClass = this->classTable.find(expr.object->getType().getName());
+    if (expr.binding.kind == Binding::Kind::ENUM_VALUE) {
+        return llvm::ConstantInt::get(this->generateType(expr.getType(), false),
+                                      expr.binding.index);
+    }
+    auto        objectVal  = generateExpression(*expr.object);
+    const auto& objectType = expr.object->getType();
 
     if (expr.kind == MemberExpression::Kind::METHOD) {
-        auto className  = objectClass->name;
-        auto vTableName = Format("vTable_{0}", className);
+        const auto& className  = objectType.getName();
+        const auto& vTableInfo = this->vTables[objectType];
 
+        auto objectI8Ptr = this->builder->CreateBitCast(objectVal, int8PtrTy, "objectI8Ptr");
+        std::vector<llvm::Value*> callArgs = {objectI8Ptr};
+        for (const auto& argExpr : expr.arguments) {
+            callArgs.push_back(generateExpression(*argExpr));
+        }
 
-        auto vTablePtr = this->builder->CreateStructGEP(this->generateType(className, false),
+        llvm::FunctionType* methodFuncType = vTableInfo.methodTypes[expr.binding.index];
+        std::string         callName       = methodFuncType->getReturnType() == this->voidTy
+                                                 ? ""
+                                                 : Format("call_{0}", expr.methodName);
+
+        // 没有子类覆盖该方法，跳过虚表直接调用
+        if (expr.monomorphic) {
+            return this->builder->CreateCall(
+                vTableInfo.methods[expr.binding.index], callArgs, callName);
+        }
+
+        auto vTablePtr = this->builder->CreateStructGEP(this->generateType(objectType, false),
                                                         objectVal,
                                                         OBJECT_LAYOUT::VTABLE_OFFSET,
                                                         Format("{0}_vtable_ptr_ptr", className));
 
-        auto vTable =
-            this->builder->CreateLoad(llvm::PointerType::getUnqual(this->vTableTypes[vTableName]),
-                                      vTablePtr,
-                                      Format("{0}_vtable_ptr", className));
+        auto vTable = this->builder->CreateLoad(llvm::PointerType::getUnqual(vTableInfo.type),
+                                                vTablePtr,
+                                                Format("{0}_vtable_ptr", className));
+        this->setVTableTBAA(vTable, objectType);
 
 
         auto methodPtr = this->builder->CreateStructGEP(
-            this->vTableTypes[vTableName],
+            vTableInfo.type,
             vTable,
-            this->vTableOffsetMap[className + expr.methodName],
+            vTableInfo.methodSlots[expr.binding.index],
             Format("{0}_{1}_method_ptr_ptr", className, expr.methodName));
 
-        auto                fullMethodName = Format("{0}_{1}", className, expr.methodName);
-        llvm::FunctionType* methodFuncType = nullptr;
-        auto                it             = this->methodTypeMap.find(fullMethodName);
-        if (it != this->methodTypeMap.end()) {
-            methodFuncType = it->second;
-        }
-        else {
-            // 如果不是自己的 method，就要去 parents 找
-            const auto* inheritanceChain = this->classTable.getInheritMap(className);
-            for (auto cls = inheritanceChain->rbegin(); cls != inheritanceChain->rend(); ++cls) {
-                auto baseMethodName = Format("{0}_{1}", (*cls)->name, expr.methodName);
-                auto baseIt         = this->methodTypeMap.find(baseMethodName);
-                if (baseIt != this->methodTypeMap.end()) {
-                    methodFuncType = baseIt->second;
-                    break;
-                }
-            }
-        }
         llvm::Type* methodPtrType = llvm::PointerType::get(methodFuncType, 0);
 
         auto method = this->builder->CreateLoad(
             methodPtrType, methodPtr, Format("{0}_{1}_method_ptr", className, expr.methodName));
 
-        auto objectI8Ptr = this->builder->CreateBitCast(objectVal, int8PtrTy, "objectI8Ptr");
-        std::vector<llvm::Value*> callArgs = {objectI8Ptr};
-
-        for (const auto& argExpr : expr.arguments) {
-            callArgs.push_back(generateExpression(*argExpr));
+        // 间接调用看不到被调用函数的属性，按所有可能实现的副作用标在调用点上
+        auto call = this->builder->CreateCall(methodFuncType, method, callArgs, callName);
+        for (auto kind : this->effectAttributes(expr.effects)) {
+            call->addFnAttr(kind);
         }
-        return this->builder->CreateCall(
-            methodFuncType,
-            method,
-            callArgs,
-            methodFuncType->getReturnType() == this->voidTy ? ""
-                                                            : Format("call_{0}", expr.methodName)
-        );
+        return call;
     }
 
     if (expr.kind == MemberExpression::Kind::PROPERTY) {
-        auto property = Format("{0}_{1}", objectClass->name, expr.property);
+        auto property = Format("{0}_{1}", objectType.getName(), expr.property);
         auto ptr      = generateMemberExpressionPtr(expr);
-        return this->builder->CreateLoad(this->generateType(expr.getType(), true), ptr, property);
+        auto layout   = this->classTable.getLayout(objectType);
+        auto load     = generateFieldLoad(layout->fields[expr.binding.index],
+                                      this->generateType(expr.getType(), true),
+                                      ptr,
+                                      property);
+        this->setFieldTBAA(load, objectType, expr.binding.index);
+        return load;
     }
     return nullptr;
 }
 
 llvm::Value* IRGen::generateMemberExpressionPtr(const MemberExpression& expr)
 {
-    auto        objectVal   = generateExpression(*expr.object);
-    const auto* objectClass = this->classTable.find(expr.object->getType().getName());
+    auto        objectVal  = generateExpression(*expr.object);
+    const auto& objectType = expr.object->getType();
 
     if (expr.kind == MemberExpression::Kind::PROPERTY) {
-        auto        property   = Format("{0}_{1}", objectClass->name, expr.property);
-        auto        value      = this->valueTable.find(property);
-        llvm::Type* structType = this->generateType(objectClass->name, false);
-        return this->builder->CreateStructGEP(
-            structType, objectVal, value->getOffset(), Format("{0}_ptr", property));
+        auto        property   = Format("{0}_{1}", objectType.getName(), expr.property);
+        llvm::Type* structType = this->generateType(objectType, false);
+        return this->builder->CreateStructGEP(structType,
+                                              objectVal,
+                                              this->getFieldSlot(objectType, expr.binding.index),
+                                              Format("{0}_ptr", property));
     }
     return nullptr;
 }
 
+// 先序编号下 T 的子类编号都落在 [id, lastDescendant] 内，从虚表取出对象的类编号后
+// 用一次无符号比较判断 (classId - id) <= (lastDescendant - id)；
+// null 不是任何类的实例，非 null 时才读取虚表，结果由 phi 合并
 llvm::Value* IRGen::generateTypeCheckExpression(const TypeCheckExpression& expr)
 {
-    throw "Not yet implemented IRGen::generateTypeCheckExpression";
+    auto        objectVal  = generateExpression(*expr.expression);
+    const auto& objectType = expr.expression->getType();
+    auto        notNull    = this->builder->CreateICmpNE(
+        objectVal, llvm::Constant::getNullValue(objectVal->getType()), "not_null");
+    if (this->classTable.checkInherit(objectType, *expr.type)) return notNull;
+
+    auto              currFunc = this->builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* nullBB   = this->builder->GetInsertBlock();
+    llvm::BasicBlock* checkBB  = llvm::BasicBlock::Create(*context, "is.check", currFunc);
+    llvm::BasicBlock* endBB    = llvm::BasicBlock::Create(*context, "is.end");
+    this->builder->CreateCondBr(notNull, checkBB, endBB);
+    this->builder->SetInsertPoint(checkBB);
+
+    const auto& vTableInfo = this->vTables[objectType];
+    auto        structType = this->generateType(objectType, false);
+    auto        vTablePtr  = this->builder->CreateStructGEP(
+        structType, objectVal, OBJECT_LAYOUT::VTABLE_OFFSET, "vtable_ptr_ptr");
+    auto vTable     = this->builder->CreateLoad(
+        llvm::PointerType::getUnqual(vTableInfo.type), vTablePtr, "vtable_ptr");
+    auto classIdPtr = this->builder->CreateStructGEP(
+        vTableInfo.type, vTable, OBJECT_LAYOUT::VTABLE_CLASS_ID, "class_id_ptr");
+    auto classId    = this->builder->CreateLoad(int32Ty, classIdPtr, "class_id");
+    // 堆上对象的虚表指针只在 malloc_init 中写入，虚表本身不会改变；
+    // 栈上对象会在同一地址重写对象头，能看到它们的函数由 dropInvariantLoads 去掉标记
+    auto invariant = llvm::MDNode::get(*this->context, {});
+    vTable->setMetadata(llvm::LLVMContext::MD_invariant_load, invariant);
+    classId->setMetadata(llvm::LLVMContext::MD_invariant_load, invariant);
+    this->setVTableTBAA(vTable, objectType);
+
+    const auto*  range = this->classTable.getClassIdRange(*expr.type);
+    llvm::Value* isInstance;
+    if (range->lastDescendant == range->id) {
+        isInstance = this->builder->CreateICmpEQ(classId, builder->getInt32(range->id), "is");
+    }
+    else {
+        auto offset =
+            this->builder->CreateSub(classId, builder->getInt32(range->id), "class_offset");
+        isInstance = this->builder->CreateICmpULE(
+            offset, builder->getInt32(range->lastDescendant - range->id), "is");
+    }
+    this->builder->CreateBr(endBB);
+
+    endBB->insertInto(currFunc);
+    this->builder->SetInsertPoint(endBB);
+    auto phi = this->builder->CreatePHI(builder->getInt1Ty(), 2, "is");
+    phi->addIncoming(builder->getInt1(false), nullBB);
+    phi->addIncoming(isInstance, checkBB);
+    return phi;
 }
 
 llvm::Value* IRGen::generateUnaryExpression(const UnaryExpression& expr)
@@ -1,39 +1,31 @@
 #include "ir/ir.hpp"
 #include "utils/format.hpp"
 
+#include <unordered_set>
+
 void IRGen::generateStatement(const Statement& stmt)
 {
-
-    if (auto* blockStmt = dynamic_cast<const BlockStatement*>(&stmt)) {
-        generateBlockStatement(*blockStmt);
-    }
-    else if (auto* exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
-        generateExpressionStatement(*exprStmt);
-    }
-    else if (auto* forStmt = dynamic_cast<const ForStatement*>(&stmt)) {
-        generateForStatement(*forStmt);
-    }
-    else if (auto* ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
-        generateIfStatement(*ifStmt);
-    }
-    else if (auto* returnStmt = dynamic_cast<const ReturnStatement*>(&stmt)) {
-        generateReturnStatement(*returnStmt);
-    }
-    else if (auto* varStmt = dynamic_cast<const VariableStatement*>(&stmt)) {
-        generateVariableStatement(*varStmt);
-    }
-    else if (auto* whenStmt = dynamic_cast<const WhenStatement*>(&stmt)) {
-        generateWhenStatement(*whenStmt);
+    switch (stmt.getNodeKind()) {
+        case NodeKind::BLOCK_STMT: generateBlockStatement(*cast<BlockStatement>(&stmt)); break;
+        case NodeKind::EXPRESSION_STMT:
+            generateExpressionStatement(*cast<ExpressionStatement>(&stmt));
+            break;
+        case NodeKind::FOR_STMT: generateForStatement(*cast<ForStatement>(&stmt)); break;
+        case NodeKind::IF_STMT: generateIfStatement(*cast<IfStatement>(&stmt)); break;
+        case NodeKind::RETURN_STMT: generateReturnStatement(*cast<ReturnStatement>(&stmt)); break;
+        case NodeKind::VARIABLE_STMT:
+            generateVariableStatement(*cast<VariableStatement>(&stmt));
+            break;
+        case NodeKind::WHEN_STMT: generateWhenStatement(*cast<WhenStatement>(&stmt)); break;
+        default: break;
     }
 }
 
 void IRGen::generateBlockStatement(const BlockStatement& blockStmt)
 {
-    this->valueTable.enterScope("block");
     for (const auto& stmt : blockStmt.statements) {
         generateStatement(*stmt);
     }
-    this->valueTable.exitScope();
 }
 
 void IRGen::generateExpressionStatement(const ExpressionStatement& exprStmt)
@@ -43,6 +35,10 @@ void IRGen::generateExpressionStatement(const ExpressionStatement& exprStmt)
 
 void IRGen::generateForStatement(const ForStatement& stmt)
 {
+    if (stmt.countEnd) {
+        generateCountedLoop(stmt);
+        return;
+    }
     auto iterable = generateExpression(*stmt.iterable);
     auto iterType = stmt.iterable->getType();
 
@@ -73,7 +69,7 @@ void IRGen::generateForStatement(const ForStatement& stmt)
         {iterableI8Ptr},
         "call_current");
     this->builder->CreateStore(current, variable);
-    this->valueTable.add(stmt.variable, IRValue(variable));
+    this->locals[stmt.slot] = variable;
 
     generateStatement(*stmt.body);
 
@@ -84,6 +80,49 @@ void IRGen::generateForStatement(const ForStatement& stmt)
     this->builder->SetInsertPoint(endBB);
 }
 
+// 不构造计数迭代器，计数器放在栈上由 mem2reg 提升为归纳变量；循环变量不可赋值，直接使用计数器
+void IRGen::generateCountedLoop(const ForStatement& stmt)
+{
+    // 与构造调用相同，按顺序求值所有实参和缺省值
+    const auto*  call      = cast<CallExpression>(stmt.iterable);
+    const auto*  callee    = cast<IdentifierExpression>(call->callee);
+    const auto*  classDecl = this->classTable.getClassById(callee->binding.index);
+    const auto&  params    = classDecl->constructorParameters;
+    llvm::Value* end       = nullptr;
+    for (size_t i = 0; i < params.size(); i++) {
+        const auto* arg =
+            i < call->arguments.size() ? call->arguments[i] : params[i].defaultValue;
+        auto value = generateExpression(*arg);
+        if (arg == stmt.countEnd) end = value;
+    }
+
+    auto counter = this->allocateStackVariable(stmt.variable, this->int32Ty);
+    this->builder->CreateStore(this->builder->getInt32(stmt.countStart), counter);
+    this->locals[stmt.slot] = counter;
+
+    auto              currFunc = this->getCurrFunc();
+    llvm::BasicBlock* condBB   = llvm::BasicBlock::Create(*context, "for.cond", currFunc);
+    llvm::BasicBlock* bodyBB   = llvm::BasicBlock::Create(*context, "for.body", currFunc);
+    llvm::BasicBlock* endBB    = llvm::BasicBlock::Create(*context, "for.end", currFunc);
+
+    this->builder->CreateBr(condBB);
+    this->builder->SetInsertPoint(condBB);
+    auto index = this->builder->CreateLoad(this->int32Ty, counter, "for.index");
+    this->builder->CreateCondBr(
+        this->builder->CreateICmpSLT(index, end, "for.cmp"), bodyBB, endBB);
+
+    this->builder->SetInsertPoint(bodyBB);
+    generateStatement(*stmt.body);
+    auto next = this->builder->CreateAdd(
+        this->builder->CreateLoad(this->int32Ty, counter, "for.index"),
+        this->builder->getInt32(stmt.countStep),
+        "for.next");
+    this->builder->CreateStore(next, counter);
+    this->builder->CreateBr(condBB);
+
+    this->builder->SetInsertPoint(endBB);
+}
+
 void IRGen::generateIfStatement(const IfStatement& stmt)
 {
     auto currFunc = this->getCurrFunc();
@@ -123,7 +162,7 @@ void IRGen::generateVariableStatement(const VariableStatement& stmt)
 {
     auto         declType = this->generateType(*stmt.declType, true);
     llvm::Value* value    = this->allocateStackVariable(stmt.name, declType);
-    this->valueTable.add(stmt.name, IRValue(value));
+    this->locals[stmt.slot] = value;
     if (stmt.initializer == nullptr) return;
     llvm::Value* init = generateExpression(*stmt.initializer);
     if (stmt.declType && stmt.initType && *stmt.declType != *stmt.initType) {
@@ -132,4 +171,172 @@ void IRGen::generateVariableStatement(const VariableStatement& stmt)
     this->builder->CreateStore(init, value);
 }
 
-void IRGen::generateWhenStatement(const WhenStatement& stmt) {}
+// 编译期可知的分支值：字面量及其取负、取反，以及枚举值
+static bool isConstantCase(const Expression& expr)
+{
+    if (const auto* unary = dyn_cast<UnaryExpression>(&expr)) {
+        return isConstantCase(*unary->operand);
+    }
+    if (const auto* member = dyn_cast<MemberExpression>(&expr)) {
+        return member->binding.kind == Binding::Kind::ENUM_VALUE;
+    }
+    return isa<LiteralExpression>(&expr);
+}
+
+// 与运行时 _str_hash 相同的 FNV-1a
+static uint32_t hashString(const std::string& str, uint32_t seed)
+{
+    uint32_t hash = seed;
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 找到种子和 2 的幂的表大小，使各字面量哈希值的高位落在不同的槽中；
+// 乘法只向高位扩散，低位的区分度差
+static std::optional<std::pair<uint32_t, int>> findPerfectHash(const std::vector<std::string>& keys)
+{
+    int bits = 1;
+    while ((size_t(1) << bits) < keys.size()) bits++;
+    for (; (size_t(1) << bits) <= (keys.size() << 6) && bits < 32; bits++) {
+        uint32_t seed = 2166136261u;
+        for (int attempt = 0; attempt < 256; attempt++, seed += 0x9e3779b9u) {
+            std::unordered_set<uint32_t> slots;
+            for (const auto& key : keys) {
+                if (!slots.insert(hashString(key, seed) >> (32 - bits)).second) break;
+            }
+            if (slots.size() == keys.size()) return std::make_pair(seed, 32 - bits);
+        }
+    }
+    return std::nullopt;
+}
+
+// 主体只求值一次；连续的常量分支合为一条 switch，其余分支依次比较，
+// 先出现的分支优先
+void IRGen::generateWhenStatement(const WhenStatement& stmt)
+{
+    auto        currFunc = this->getCurrFunc();
+    const auto& type     = stmt.subject->getType();
+    auto        subject  = generateExpression(*stmt.subject);
+    auto        endBB    = llvm::BasicBlock::Create(*context, "when.end");
+    bool        switchable = type.getKind() == Type::Kind::INT ||
+                             type.getKind() == Type::Kind::BOOL || type.isEnum() || type.isStr();
+
+    std::vector<llvm::BasicBlock*> caseBBs;
+    for (size_t i = 0; i < stmt.cases.size(); i++) {
+        caseBBs.push_back(llvm::BasicBlock::Create(*context, "when.case"));
+    }
+
+    for (size_t i = 0; i < stmt.cases.size();) {
+        size_t end = i;
+        while (switchable && end < stmt.cases.size() && isConstantCase(*stmt.cases[end].value)) {
+            end++;
+        }
+        auto nextBB = llvm::BasicBlock::Create(*context, "when.next", currFunc);
+        if (end > i) {
+            SwitchCases cases;
+            for (; i < end; i++) cases.emplace_back(stmt.cases[i].value, caseBBs[i]);
+            if (type.isStr()) {
+                generateStringSwitch(subject, cases, nextBB);
+            }
+            else {
+                generateSwitch(subject, cases, nextBB);
+            }
+        }
+        else {
+            auto value = generateExpression(*stmt.cases[i].value);
+            builder->CreateCondBr(generateWhenMatch(subject, value, type), caseBBs[i], nextBB);
+            i++;
+        }
+        builder->SetInsertPoint(nextBB);
+    }
+    builder->CreateBr(endBB);
+
+    for (size_t i = 0; i < stmt.cases.size(); i++) {
+        // 被前面相同常量遮蔽的分支没有前驱，不生成它的代码
+        if (caseBBs[i]->hasNPredecessors(0)) {
+            delete caseBBs[i];
+            continue;
+        }
+        caseBBs[i]->insertInto(currFunc);
+        builder->SetInsertPoint(caseBBs[i]);
+        generateStatement(*stmt.cases[i].body);
+        builder->CreateBr(endBB);
+    }
+    endBB->insertInto(currFunc);
+    builder->SetInsertPoint(endBB);
+}
+
+void IRGen::generateSwitch(llvm::Value* subject, const SwitchCases& cases,
+                           llvm::BasicBlock* defaultBB)
+{
+    auto switchInst = builder->CreateSwitch(subject, defaultBB, cases.size());
+    std::unordered_set<int64_t> seen;
+    for (const auto& [value, caseBB] : cases) {
+        auto constant = llvm::cast<llvm::ConstantInt>(generateExpression(*value));
+        // 重复的值只保留第一个分支
+        if (seen.insert(constant->getSExtValue()).second) switchInst->addCase(constant, caseBB);
+    }
+}
+
+// 字符串按编译期选定种子的完美哈希分派到唯一的候选，再做一次比较
+void IRGen::generateStringSwitch(llvm::Value* subject, const SwitchCases& cases,
+                                 llvm::BasicBlock* defaultBB)
+{
+    std::vector<std::string>       keys;
+    std::vector<llvm::BasicBlock*> keyBBs;
+    for (const auto& [value, caseBB] : cases) {
+        const auto& key = std::get<std::string>(cast<LiteralExpression>(value)->value);
+        if (std::find(keys.begin(), keys.end(), key) != keys.end()) continue;
+        keys.push_back(key);
+        keyBBs.push_back(caseBB);
+    }
+
+    auto perfectHash = keys.size() > 1 ? findPerfectHash(keys) : std::nullopt;
+    if (!perfectHash) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto nextBB = i + 1 == keys.size()
+                              ? defaultBB
+                              : llvm::BasicBlock::Create(*context, "when.next", getCurrFunc());
+            auto equals = builder->CreateCall(this->methodMap["_str_equals"],
+                                              {subject, builder->CreateGlobalStringPtr(keys[i])},
+                                              "call_str_equals");
+            builder->CreateCondBr(equals, keyBBs[i], nextBB);
+            builder->SetInsertPoint(nextBB);
+        }
+        return;
+    }
+
+    auto [seed, shift] = *perfectHash;
+    auto hash          = builder->CreateCall(
+        this->methodMap["_str_hash"], {subject, builder->getInt32(seed)}, "call_str_hash");
+    auto slot          = builder->CreateLShr(hash, builder->getInt32(shift), "hash_slot");
+    auto switchInst    = builder->CreateSwitch(slot, defaultBB, keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto checkBB = llvm::BasicBlock::Create(*context, "when.str.check", getCurrFunc());
+        switchInst->addCase(builder->getInt32(hashString(keys[i], seed) >> shift), checkBB);
+        builder->SetInsertPoint(checkBB);
+        auto equals = builder->CreateCall(this->methodMap["_str_equals"],
+                                          {subject, builder->CreateGlobalStringPtr(keys[i])},
+                                          "call_str_equals");
+        builder->CreateCondBr(equals, keyBBs[i], defaultBB);
+    }
+}
+
+// 字符串比较内容，类的实例比较地址
+llvm::Value* IRGen::generateWhenMatch(llvm::Value* subject, llvm::Value* value, const Type& type)
+{
+    switch (type.getKind()) {
+        case Type::Kind::FLOAT: return builder->CreateFCmpOEQ(subject, value, "when_eq");
+        case Type::Kind::STR:
+            return builder->CreateCall(
+                this->methodMap["_str_equals"], {subject, value}, "call_str_equals");
+        case Type::Kind::CLASS:
+            value = builder->CreateBitCast(value, subject->getType(), "bit_cast");
+            break;
+        default: break;
+    }
+    return builder->CreateICmpEQ(subject, value, "when_eq");
+}
@@ -3,80 +3,39 @@
 #include "utils/builtin.hpp"
 #include "utils/format.hpp"
 
-void IRValueScope::add(const std::string& key, IRValue value)
-{
-    map.insert_or_assign(key, value);
-}
-const IRValue* IRValueScope::find(const std::string& key)
-{
-    auto it = map.find(key);
-    if (it != map.end()) return &it->second;
-
-    return nullptr;
-}
-
-void IRValueTable::enterScope(const std::string& name)
-{
-    scopes.emplace_back(IRValueScope(name));
-}
-
-void IRValueTable::exitScope()
-{
-    if (!scopes.empty()) scopes.pop_back();
-}
-
-void IRValueTable::add(const std::string& key, IRValue value)
-{
-    if (!scopes.empty()) scopes.back().add(key, value);
-}
-
-const IRValue* IRValueTable::find(const std::string& key)
-{
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        const auto* info = it->find(key);
-        if (info) return info;
-    }
-    return nullptr;
-}
-
-void IRValueTable::debug() const
-{
-    std::cout << "IRValueTable Debug Information:\n";
-    for (size_t i = 0; i < scopes.size(); ++i) {
-        const auto& scope = scopes[i];
-        std::cout << "Scope " << i << " " << scope.getName() << ":\n";
-        for (const auto& [key, value] : scope.getMap()) {
-            const bool             isProperty = (value.getKind() == IRValueKind::PROPERTY);
-            const std::string_view kind       = isProperty ? "property" : "function param";
-            std::cout << "  Key: " << key << ", Symbol kind: " << kind;
-            if (isProperty) {
-                std::cout << ", Symbol offset: " << value.getOffset();
-            }
-            std::cout << '\n';
-        }
-    }
-    std::cout << '\n';
-}
-
+#include <iostream>
+#include <numeric>
 
 std::unique_ptr<llvm::Module> IRGen::generateIR()
 {
-    this->valueTable.enterScope("global");
     this->setupClasses();
     this->setupFunctions();
     for (const auto& decl : program->declarations) {
         this->generateDeclaration(*decl);
     }
-    this->valueTable.exitScope();
     return std::move(this->module);
 }
 
+// 枚举不生成对象，值的个数不超过 256 时用 i8，否则用 i32
+void IRGen::declareEnums()
+{
+    for (const auto& decl : program->declarations) {
+        if (const EnumDeclaration* enumDecl = dyn_cast<EnumDeclaration>(decl)) {
+            this->typeMap[Type::enumType(enumDecl->name)] =
+                enumDecl->values.size() <= 256 ? builder->getInt8Ty() : builder->getInt32Ty();
+        }
+    }
+}
+
 void IRGen::declareClasses()
 {
     for (const auto& decl : program->declarations) {
-        if (const ClassDeclaration* classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
+        if (const ClassDeclaration* classDecl = dyn_cast<ClassDeclaration>(decl)) {
             llvm::StructType* classType = llvm::StructType::create(*this->context, classDecl->name);
             this->typeMap[Type::classType(classDecl->name)] = classType;
+            // 虚表类型先声明，类型体在 buildVTables 中补全
+            std::string vTableName        = Format("vTable_{0}", classDecl->name);
+            this->vTableTypes[vTableName] = llvm::StructType::create(*this->context, vTableName);
         }
     }
 }
@@ -84,89 +43,74 @@ void IRGen::declareClasses()
 void IRGen::buildVTables()
 {
     for (const auto& decl : program->declarations) {
-        const ClassDeclaration* classDecl = dynamic_cast<const ClassDeclaration*>(decl.get());
+        const ClassDeclaration* classDecl = dyn_cast<ClassDeclaration>(decl);
         if (!classDecl) continue;
         std::string                  className  = classDecl->name;
         std::string                  vTableName = Format("vTable_{0}", className);
         std::vector<llvm::Type*>     vTableMethods;
         std::vector<llvm::Constant*> vTableInitializers;
-        bool                         hasSelfDefinedInit = false;
 
-        this->addVTableMethod(vTableMethods,
-                              vTableInitializers,
-                              Format("{0}_builtin_init", className),
-                              llvm::FunctionType::get(voidTy, {int8PtrTy}, false));
-
-        std::vector<llvm::Type*> constructParamTypes = {int8PtrTy};
+        const auto* idRange  = this->classTable.getClassIdRange(Type::classType(className));
+        uint64_t    typeSize = this->dataLayout->getTypeAllocSize(
+            this->typeMap[Type::classType(className)]);
+        vTableMethods.insert(vTableMethods.end(), {int32Ty, int32Ty, int32Ty});
+        vTableInitializers.insert(vTableInitializers.end(),
+                                  {builder->getInt32(idRange->id),
+                                   builder->getInt32(idRange->lastDescendant),
+                                   builder->getInt32(typeSize)});
+
+        // 构造过程不经虚表调用：malloc_init 合并了分配和整条构造链，只在本模块内调用；
+        // init 块由 malloc_init 和栈上对象的构造直接调用
+        std::vector<llvm::Type*> constructParamTypes;
         for (const auto& constructParam : classDecl->constructorParameters) {
             constructParamTypes.emplace_back(this->generateType(*constructParam.type, true));
         }
-        this->addVTableMethod(vTableMethods,
-                              vTableInitializers,
-                              Format("{0}_constructor", className),
-                              llvm::FunctionType::get(
-                                  this->generateType(className, true), constructParamTypes, false));
-        constructParamTypes.erase(constructParamTypes.begin());
-        this->addVTableMethod(vTableMethods,
-                              vTableInitializers,
-                              Format("{0}_malloc_init", className),
-                              llvm::FunctionType::get(
-                                  this->generateType(className, true), constructParamTypes, false));
-
-
-        std::map<std::string, std::pair<std::string, llvm::FunctionType*>> inheritMethodMap;
-
-        const auto* inheritanceChain = this->classTable.getInheritMap(classDecl->name);
-        for (auto cls = inheritanceChain->rbegin(); cls != inheritanceChain->rend(); ++cls) {
-            for (const auto& member : (*cls)->members) {
-                if (const auto* method = dynamic_cast<const MethodMember*>(member.get())) {
-                    std::string methodKey      = method->getName();
-                    std::string fullMethodName = Format("{0}_{1}", (*cls)->name, method->getName());
-
-                    std::vector<llvm::Type*> paramTypes = {int8PtrTy};
-
-                    for (const auto& param : method->function->parameters) {
-                        paramTypes.push_back(this->generateType(*param.type, true));
-                    }
-
-                    llvm::FunctionType* funcType = llvm::FunctionType::get(
-                        this->generateType(*method->function->returnType, true), paramTypes, false);
-                    inheritMethodMap[methodKey] = {fullMethodName, funcType};
-                }
-            }
+        auto mallocInit = this->getOrCreateMethod(
+            Format("{0}_malloc_init", className),
+            llvm::FunctionType::get(
+                this->generateType(className, true), constructParamTypes, false));
+        mallocInit->setLinkage(llvm::GlobalValue::InternalLinkage);
+        mallocInit->addRetAttr(llvm::Attribute::NoAlias);
+        if (classDecl->containInitMember()) {
+            auto selfDefinedInit =
+                this->getOrCreateMethod(Format("{0}_self_defined_init", className),
+                                        llvm::FunctionType::get(voidTy, {int8PtrTy}, false));
+            selfDefinedInit->setLinkage(llvm::GlobalValue::InternalLinkage);
+            this->addSelfAttributes(selfDefinedInit, className);
         }
-        for (const auto& member : classDecl->members) {
-            if (const auto* method = dynamic_cast<const MethodMember*>(member.get())) {
-                std::string methodKey      = method->getName();
-                std::string fullMethodName = Format("{0}_{1}", className, method->getName());
 
-                std::vector<llvm::Type*> paramTypes = {int8PtrTy};
+        // 方法顺序由 ClassLayout 决定，与语义分析给出的 METHOD 绑定下标一致；
+        // 父类的方法在子类虚表中槽位不变，新引入的 final 方法不占槽位
+        VTableInfo& vTableInfo = this->vTables[Type::classType(className)];
+        const auto* layout     = this->classTable.getLayout(Type::classType(className));
+        for (size_t i = 0; i < layout->methods.size(); i++) {
+            const auto& [owner, method] = layout->methods[i];
+            std::string fullMethodName  = Format("{0}_{1}", owner->name, method->getName());
+
+            std::vector<llvm::Type*> paramTypes = {int8PtrTy};
 
-                for (const auto& param : method->function->parameters) {
-                    paramTypes.push_back(this->generateType(*param.type, true));
-                }
+            for (const auto& param : method->function->parameters) {
+                paramTypes.push_back(this->generateType(*param.type, true));
+            }
 
-                llvm::FunctionType* funcType = llvm::FunctionType::get(
-                    this->generateType(*method->function->returnType, true), paramTypes, false);
-                inheritMethodMap[methodKey] = {fullMethodName, funcType};
+            llvm::FunctionType* funcType = llvm::FunctionType::get(
+                this->generateType(*method->function->returnType, true), paramTypes, false);
+            vTableInfo.methodTypes.push_back(funcType);
+            vTableInfo.methods.push_back(this->getOrCreateMethod(fullMethodName, funcType));
+            for (auto kind : this->effectAttributes(method->function->effects)) {
+                vTableInfo.methods.back()->addFnAttr(kind);
             }
-            else if (const auto* init = dynamic_cast<const InitBlockMember*>(member.get())) {
-                hasSelfDefinedInit                 = true;
-                std::string         initMethodName = Format("{0}_self_defined_init", className);
-                llvm::FunctionType* funcType = llvm::FunctionType::get(voidTy, {int8PtrTy}, false);
-                this->addVTableMethod(vTableMethods, vTableInitializers, initMethodName, funcType);
+            this->addSelfAttributes(vTableInfo.methods.back(), owner->name);
+            if (layout->vtableSlots[i] < 0) {
+                vTableInfo.methodSlots.push_back(-1);
+                continue;
             }
-        }
-        size_t vTableOffset = hasSelfDefinedInit ? OBJECT_LAYOUT::BUILTIN_METHOD_NUM + 1
-                                                 : OBJECT_LAYOUT::BUILTIN_METHOD_NUM;
-        for (const auto& [methodKey, methodInfo] : inheritMethodMap) {
-            const auto& [fullMethodName, funcType]             = methodInfo;
-            this->vTableOffsetMap[classDecl->name + methodKey] = vTableOffset;
+            vTableInfo.methodSlots.push_back(vTableMethods.size());
             this->addVTableMethod(vTableMethods, vTableInitializers, fullMethodName, funcType);
-            vTableOffset++;
         }
 
-        auto vTableType     = llvm::StructType::create(*this->context, vTableMethods, vTableName);
+        auto vTableType = static_cast<llvm::StructType*>(this->vTableTypes[vTableName]);
+        vTableType->setBody(vTableMethods);
         auto vTableConstant = llvm::ConstantStruct::get(vTableType, vTableInitializers);
 
         this->vTableVars[vTableName]  = new llvm::GlobalVariable(*this->module,
@@ -175,75 +119,200 @@ void IRGen::buildVTables()
                                                                 llvm::GlobalValue::ExternalLinkage,
                                                                 vTableConstant,
                                                                 vTableName);
-        this->vTableTypes[vTableName] = vTableType;
+        vTableInfo.type = vTableType;
     }
 }
+
 void IRGen::addVTableMethod(std::vector<llvm::Type*>&     vTableMethods,
                             std::vector<llvm::Constant*>& vTableInitializers,
                             const std::string& methodName, llvm::FunctionType* funcType)
 {
-    llvm::Function* function;
     vTableMethods.push_back(llvm::PointerType::getUnqual(funcType));
-    if (!this->methodMap.count(methodName)) {
-        function = llvm::Function::Create(
-            funcType, llvm::Function::ExternalLinkage, methodName, this->module.get());
-        this->methodMap[methodName]     = function;
-        this->methodTypeMap[methodName] = funcType;
-    }
-    else {
-        function = this->methodMap[methodName];
+    vTableInitializers.push_back(this->getOrCreateMethod(methodName, funcType));
+}
+
+llvm::Function* IRGen::getOrCreateMethod(const std::string& methodName, llvm::FunctionType* funcType)
+{
+    auto it = this->methodMap.find(methodName);
+    if (it != this->methodMap.end()) {
+        return it->second;
     }
-    vTableInitializers.push_back(function);
+    auto function = llvm::Function::Create(
+        funcType, llvm::Function::ExternalLinkage, methodName, this->module.get());
+    this->methodMap[methodName] = function;
+    return function;
 }
 
+// 字段重排：继承来的字段保持父类中的位置，使子类布局以父类布局为前缀，向上转型不用调整；
+// 本类新增的字段按对齐从大到小稳定排序，减少填充，bool 等单字节字段集中放在末尾
 void IRGen::defineClasses()
 {
-    for (const auto& decl : program->declarations) {
-        if (const ClassDeclaration* classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
-            auto it = this->typeMap.find(Type::classType(classDecl->name));
-            if (it != this->typeMap.end()) {
-                const auto* inheritanceChain = this->classTable.getInheritMap(classDecl->name);
-                std::string vTableName       = Format("vTable_{0}", classDecl->name);
-                llvm::StructType*        structType = static_cast<llvm::StructType*>(it->second);
-                std::vector<llvm::Type*> fieldTypes = {
-                    llvm::PointerType::getUnqual(this->vTableTypes[vTableName]),
-                    int32Ty,   // object size
-                };
-                std::vector<std::variant<const FunctionParameter*, const PropertyMember*>>
-                    allParams;
-
-                for (auto cls = inheritanceChain->rbegin(); cls != inheritanceChain->rend();
-                     ++cls) {
-                    for (const auto& param : (*cls)->constructorParameters) {
-                        allParams.push_back(&param);
-                    }
-                    for (const auto& member : (*cls)->members) {
-                        if (const auto property =
-                                dynamic_cast<const PropertyMember*>(member.get())) {
-                            allParams.push_back(property);
-                        }
-                    }
-                }
-                for (const auto& constructorParam : classDecl->constructorParameters) {
-                    allParams.push_back(&constructorParam);
-                }
-                for (const auto& member : classDecl->members) {
-                    if (const auto property = dynamic_cast<const PropertyMember*>(member.get())) {
-                        allParams.push_back(property);
-                    }
-                }
-                for (const auto& param : allParams) {
-                    fieldTypes.emplace_back(this->getParamType(param));
-                }
-                if (!fieldTypes.empty() && structType->isOpaque()) {
-                    structType->setBody(fieldTypes);
-                }
-                this->classAllParams[classDecl->name] = std::move(allParams);
-            }
+    // 先序编号保证父类先于子类
+    for (size_t id = 0; id < this->classTable.size(); id++) {
+        const auto* classDecl  = this->classTable.getClassById(id);
+        Type        classType  = Type::classType(classDecl->name);
+        const auto* layout     = this->classTable.getLayout(classType);
+        std::string vTableName = Format("vTable_{0}", classDecl->name);
+        auto*       structType = static_cast<llvm::StructType*>(this->typeMap.at(classType));
+
+        std::vector<int> inherited;
+        const auto*      parents = this->classTable.getInheritMap(classDecl->name);
+        if (parents != nullptr && !parents->empty()) {
+            inherited = this->fieldSlots.at(Type::classType(parents->front()->name));
+        }
+        std::vector<llvm::Type*> paramTypes;
+        for (const auto& param : layout->fields) {
+            paramTypes.push_back(this->getParamType(param));
+        }
+        std::vector<int> order(layout->fields.size() - inherited.size());
+        std::iota(order.begin(), order.end(), inherited.size());
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return this->dataLayout->getABITypeAlignment(paramTypes[a]) >
+                   this->dataLayout->getABITypeAlignment(paramTypes[b]);
+        });
+
+        std::vector<int>& slots = this->fieldSlots[classType];
+        slots                   = std::move(inherited);
+        slots.resize(layout->fields.size());
+        std::vector<llvm::Type*> fieldTypes(OBJECT_LAYOUT::BUILTIN_FIELD_NUM + slots.size());
+        // 对象头只有虚表指针，类编号和对象大小都从虚表中取得
+        fieldTypes[OBJECT_LAYOUT::VTABLE_OFFSET] =
+            llvm::PointerType::getUnqual(this->vTableTypes[vTableName]);
+        for (size_t i = 0; i < order.size(); i++) {
+            slots[order[i]] = OBJECT_LAYOUT::BUILTIN_FIELD_NUM + layout->fields.size() -
+                              order.size() + i;
+        }
+        for (size_t i = 0; i < slots.size(); i++) {
+            fieldTypes[slots[i]] = paramTypes[i];
+        }
+        if (structType->isOpaque()) {
+            structType->setBody(fieldTypes);
+        }
+    }
+}
+
+int IRGen::getFieldSlot(const Type& classType, int fieldIndex) const
+{
+    return this->fieldSlots.at(classType)[fieldIndex];
+}
+
+void IRGen::printLayouts(const std::vector<std::string>& files)
+{
+    for (size_t id = 0; id < this->classTable.size(); id++) {
+        const auto* classDecl = this->classTable.getClassById(id);
+        auto        filename  = classDecl->getLocation().filename;
+        if (std::find(files.begin(), files.end(), filename) == files.end()) continue;
+
+        Type        classType  = Type::classType(classDecl->name);
+        const auto* layout     = this->classTable.getLayout(classType);
+        auto*       structType = static_cast<llvm::StructType*>(this->typeMap.at(classType));
+        const auto& slots      = this->fieldSlots.at(classType);
+
+        // 按声明顺序排列时的大小，用于对比重排节省的空间
+        std::vector<llvm::Type*> declaredTypes = {structType->getElementType(0)};
+        for (int slot : slots) {
+            declaredTypes.push_back(structType->getElementType(slot));
+        }
+        auto*    declaredType = llvm::StructType::get(*this->context, declaredTypes);
+        uint64_t declaredSize = this->dataLayout->getTypeAllocSize(declaredType);
+        uint64_t size         = this->dataLayout->getTypeAllocSize(structType);
+        std::cout << Format("{0}: {1} bytes (declaration order {2} bytes, {3} saved)\n",
+                            classDecl->name,
+                            size,
+                            declaredSize,
+                            declaredSize - size);
+
+        const auto* structLayout = this->dataLayout->getStructLayout(structType);
+        std::vector<int> fieldsBySlot(structType->getNumElements(), -1);
+        for (size_t i = 0; i < slots.size(); i++) {
+            fieldsBySlot[slots[i]] = i;
+        }
+        for (size_t slot = 0; slot < fieldsBySlot.size(); slot++) {
+            std::string name = fieldsBySlot[slot] < 0
+                                   ? std::string("<vtable>")
+                                   : this->getParamName(layout->fields[fieldsBySlot[slot]]);
+            std::cout << Format("  {0,4}  {1}\n", structLayout->getElementOffset(slot), name);
         }
     }
 }
 
+// TBAA 类型树：int、str 等内置类型和每个枚举各有一个标量节点，对象引用共用一个节点；
+// 每个类一个结构体类型节点，父类作为偏移 0 处的成员，之后是本类新增的字段，
+// 经父类类型和子类类型访问同一个继承来的字段时能得到相同的路径
+void IRGen::buildTBAA()
+{
+    llvm::MDBuilder mdBuilder(*this->context);
+    this->tbaaRoot = mdBuilder.createTBAARoot("watermelon TBAA");
+    for (size_t id = 0; id < this->classTable.size(); id++) {
+        const auto* classDecl    = this->classTable.getClassById(id);
+        Type        classType    = Type::classType(classDecl->name);
+        const auto* layout       = this->classTable.getLayout(classType);
+        const auto& slots        = this->fieldSlots.at(classType);
+        const auto* structLayout = this->dataLayout->getStructLayout(
+            static_cast<llvm::StructType*>(this->typeMap.at(classType)));
+
+        std::vector<std::pair<llvm::MDNode*, uint64_t>> members;
+        int                                             inherited = 0;
+        const auto* parents = this->classTable.getInheritMap(classDecl->name);
+        if (parents != nullptr && !parents->empty()) {
+            Type parentType = Type::classType(parents->front()->name);
+            members.emplace_back(this->tbaaStructs.at(parentType), 0);
+            inherited = this->classTable.getLayout(parentType)->fields.size();
+        }
+        else {
+            members.emplace_back(this->getTBAAScalar("vtable pointer"), 0);
+        }
+        // 本类新增的字段按在结构体中的偏移排列
+        std::vector<int> order(layout->fields.size() - inherited);
+        std::iota(order.begin(), order.end(), inherited);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return slots[a] < slots[b]; });
+        for (int i : order) {
+            members.emplace_back(this->getTBAAScalar(this->getParamTypeName(layout->fields[i])),
+                                 structLayout->getElementOffset(slots[i]));
+        }
+        this->tbaaStructs[classType] = mdBuilder.createTBAAStructTypeNode(classDecl->name, members);
+    }
+}
+
+llvm::MDNode* IRGen::getTBAAScalar(const std::string& name)
+{
+    auto it = this->tbaaScalars.find(name);
+    if (it != this->tbaaScalars.end()) return it->second;
+    llvm::MDBuilder mdBuilder(*this->context);
+    return this->tbaaScalars[name] = mdBuilder.createTBAAScalarTypeNode(name, this->tbaaRoot);
+}
+
+void IRGen::setFieldTBAA(llvm::Instruction* inst, const Type& classType, int fieldIndex)
+{
+    const auto* layout       = this->classTable.getLayout(classType);
+    auto*       structType   = static_cast<llvm::StructType*>(this->typeMap.at(classType));
+    const auto* structLayout = this->dataLayout->getStructLayout(structType);
+    uint64_t    offset = structLayout->getElementOffset(this->getFieldSlot(classType, fieldIndex));
+    auto* accessType   = this->getTBAAScalar(this->getParamTypeName(layout->fields[fieldIndex]));
+
+    llvm::MDBuilder mdBuilder(*this->context);
+    inst->setMetadata(
+        llvm::LLVMContext::MD_tbaa,
+        mdBuilder.createTBAAStructTagNode(this->tbaaStructs.at(classType), accessType, offset));
+}
+
+void IRGen::setVTableTBAA(llvm::Instruction* inst, const Type& classType)
+{
+    llvm::MDBuilder mdBuilder(*this->context);
+    inst->setMetadata(llvm::LLVMContext::MD_tbaa,
+                      mdBuilder.createTBAAStructTagNode(this->tbaaStructs.at(classType),
+                                                        this->getTBAAScalar("vtable pointer"),
+                                                        0));
+}
+
+// self 总是指向一个完整的对象，至少有声明它的类那么大
+void IRGen::addSelfAttributes(llvm::Function* function, const std::string& className)
+{
+    llvm::Type* classType = this->typeMap.at(Type::classType(className));
+    function->addParamAttr(0, llvm::Attribute::NonNull);
+    function->addDereferenceableParamAttr(0, this->dataLayout->getTypeAllocSize(classType));
+}
+
 // void IRGen::declareBuiltInClasses()
 // {
 //     auto size = BUILTIN::BUILTIN_CLASS.size();
@@ -266,45 +335,49 @@ void IRGen::defineClasses()
 
 void IRGen::setupClasses()
 {
+    this->declareEnums();
     this->declareClasses();
-    this->buildVTables();
     this->defineClasses();
-    for (const auto& decl : program->declarations) {
-        if (const auto* classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
-            int offset = OBJECT_LAYOUT::BUILTIN_FIELD_NUM;
-            for (const auto& param : this->classAllParams[classDecl->name]) {
-                std::string paramName = this->getParamName(param);
-                this->valueTable.add(Format("{0}_{1}", classDecl->name, paramName),
-                                     IRValue(offset));
-                offset++;
-            }
-        }
+    this->buildTBAA();
+    this->buildVTables();
+    this->classMallocInits.assign(this->classTable.size(), nullptr);
+    for (size_t id = 0; id < this->classTable.size(); id++) {
+        this->classMallocInits[id] =
+            this->methodMap[Format("{0}_malloc_init", this->classTable.getClassById(id)->name)];
     }
 }
 
 void IRGen::setupFunctions()
 {
-    for (const auto& decl : program->declarations) {
-        if (const auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
-            auto funcName = funcDecl->name == "main" ? "builtin_main" : funcDecl->name;
-            std::vector<llvm::Type*> paramTypes = {};
-            for (const auto& param : funcDecl->parameters) {
-                paramTypes.emplace_back(this->generateType(param.type->getName(), true));
-            }
-            auto m = llvm::FunctionType::get(
-                this->generateType(funcDecl->returnType->getName(), true), paramTypes, false);
-            this->methodMap[funcName] = llvm::Function::Create(
-                m, llvm::Function::ExternalLinkage, funcName, this->module.get());
+    this->functionValues.assign(this->functionTable.size(), nullptr);
+    for (size_t id = 0; id < this->functionTable.size(); id++) {
+        const auto* funcDecl = this->functionTable.get(id);
+        auto        funcName = funcDecl->name == "main" ? "builtin_main" : funcDecl->name;
+        std::vector<llvm::Type*> paramTypes = {};
+        for (const auto& param : funcDecl->parameters) {
+            paramTypes.emplace_back(this->generateType(param.type->getName(), true));
+        }
+        auto m = llvm::FunctionType::get(
+            this->generateType(funcDecl->returnType->getName(), true), paramTypes, false);
+        this->methodMap[funcName] = llvm::Function::Create(
+            m, llvm::Function::ExternalLinkage, funcName, this->module.get());
+        this->functionValues[id] = this->methodMap[funcName];
+        for (auto kind : this->effectAttributes(funcDecl->effects)) {
+            this->functionValues[id]->addFnAttr(kind);
         }
     }
     auto m = llvm::FunctionType::get(int8PtrTy, {int64Ty}, false);
     this->methodMap["malloc"] =
         llvm::Function::Create(m, llvm::Function::ExternalLinkage, "gc_alloc", *this->module);
+    this->methodMap["malloc"]->addRetAttr(llvm::Attribute::NoAlias);
+    this->methodMap["malloc_uninit"] = llvm::Function::Create(
+        m, llvm::Function::ExternalLinkage, "gc_alloc_uninit", *this->module);
+    this->methodMap["malloc_uninit"]->addRetAttr(llvm::Attribute::NoAlias);
 }
 
 llvm::Type* IRGen::generateType(const Type& type, bool ptr)
 {
-    switch (type.kind) {
+    switch (type.getKind()) {
         case Type::Kind::INT: return builder->getInt32Ty();
         case Type::Kind::STR: return builder->getInt8PtrTy();
         case Type::Kind::BOOL: return builder->getInt1Ty();
@@ -319,11 +392,65 @@ llvm::Type* IRGen::generateType(const Type& type, bool ptr)
             return ptr ? llvm::PointerType::getUnqual(it->second) : it->second;
             // return llvm::PointerType::getUnqual(it->second);
         }
+        case Type::Kind::ENUM:
+        {
+            auto it = this->typeMap.find(type);
+            return it == this->typeMap.end() ? nullptr : it->second;
+        }
         default: break;
     }
     return nullptr;
 }
 
+// 语义分析推断的副作用对应的函数属性；语言没有异常，所有函数都是 nounwind
+std::vector<llvm::Attribute::AttrKind> IRGen::effectAttributes(uint8_t effects)
+{
+    std::vector<llvm::Attribute::AttrKind> kinds = {llvm::Attribute::NoUnwind};
+    if (!(effects & Effects::MAY_DIVERGE)) kinds.push_back(llvm::Attribute::WillReturn);
+    // gc_alloc 和 I/O 会修改调用者不可见的状态，没有对应的内存属性
+    if (effects & (Effects::ALLOCATES | Effects::IO)) return kinds;
+    if (!(effects & (Effects::READS_MEMORY | Effects::WRITES_MEMORY))) {
+        kinds.push_back(llvm::Attribute::ReadNone);
+        return kinds;
+    }
+    if (!(effects & Effects::WRITES_MEMORY)) kinds.push_back(llvm::Attribute::ReadOnly);
+    if (!(effects & Effects::NON_ARG_MEMORY)) kinds.push_back(llvm::Attribute::ArgMemOnly);
+    return kinds;
+}
+
+// 堆上对象构造完成后 val 属性不再改变，读取标记为 !invariant.load，可以跨过写内存的指令合并；
+// 栈上对象在循环中每次构造都会重写同一块内存，能看到它们的函数由 dropInvariantLoads 去掉标记
+llvm::LoadInst* IRGen::generateFieldLoad(const ClassField& field, llvm::Type* type,
+                                         llvm::Value* ptr, const std::string& name)
+{
+    auto*       load     = this->builder->CreateLoad(type, ptr, name);
+    const auto* property = std::get_if<const PropertyMember*>(&field);
+    if (property && (*property)->immutable && !this->constructing) {
+        load->setMetadata(llvm::LLVMContext::MD_invariant_load,
+                          llvm::MDNode::get(*this->context, {}));
+    }
+    return load;
+}
+
+// 方法和 init 块中的 self 是否可能是栈上对象：decl 或其子类有对象分配在栈上
+bool IRGen::selfMayBeOnStack(const ClassDeclaration& decl) const
+{
+    const auto* range = this->classTable.getClassIdRange(Type::classType(decl.name));
+    for (int id = range->id; id <= range->lastDescendant; id++) {
+        if (this->classTable.getClassById(id)->stackAllocated) return true;
+    }
+    return false;
+}
+
+void IRGen::dropInvariantLoads(llvm::Function* function)
+{
+    if (!this->seesStackObject) return;
+    for (auto& inst : llvm::instructions(function)) {
+        inst.setMetadata(llvm::LLVMContext::MD_invariant_load, nullptr);
+    }
+    this->seesStackObject = false;
+}
+
 llvm::Type* IRGen::generateType(const std::string& type, bool ptr)
 {
     if (type == "int")
@@ -336,6 +463,10 @@ llvm::Type* IRGen::generateType(const std::string& type, bool ptr)
         return builder->getDoubleTy();
     else if (type == "void")
         return builder->getVoidTy();
+    else if (auto enumIt = this->typeMap.find(Type::enumType(type));
+             enumIt != this->typeMap.end()) {
+        return enumIt->second;
+    }
     else {
         Type classType = Type::classType(type);
         auto it        = this->typeMap.find(classType);
@@ -354,8 +485,7 @@ llvm::AllocaInst* IRGen::allocateStackVariable(const std::string_view identifier
     return tmpBuilder.CreateAlloca(type, nullptr, identifier);
 }
 
-llvm::Type* IRGen::getParamType(
-    const std::variant<const FunctionParameter*, const PropertyMember*>& param)
+llvm::Type* IRGen::getParamType(const ClassField& param)
 {
     if (auto funcParamPtr = std::get_if<const FunctionParameter*>(&param)) {
         return this->generateType(*(*funcParamPtr)->type, true);
@@ -366,8 +496,20 @@ llvm::Type* IRGen::getParamType(
     return nullptr;
 }
 
-std::string IRGen::getParamName(
-    const std::variant<const FunctionParameter*, const PropertyMember*>& param)
+// 字段类型在 TBAA 中的名字，对象引用不区分类
+std::string IRGen::getParamTypeName(const ClassField& param)
+{
+    Type type;
+    if (auto funcParamPtr = std::get_if<const FunctionParameter*>(&param)) {
+        type = *(*funcParamPtr)->type;
+    }
+    else if (auto propertyPtr = std::get_if<const PropertyMember*>(&param)) {
+        type = (*propertyPtr)->getType();
+    }
+    return type.getKind() == Type::Kind::CLASS ? "object" : type.getName();
+}
+
+std::string IRGen::getParamName(const ClassField& param)
 {
     if (auto funcParamPtr = std::get_if<const FunctionParameter*>(&param)) {
         return (*funcParamPtr)->name;
@@ -378,14 +520,13 @@ std::string IRGen::getParamName(
     return "";
 }
 
-const Expression* IRGen::getParamInitExpr(
-    const std::variant<const FunctionParameter*, const PropertyMember*>& param)
+const Expression* IRGen::getParamInitExpr(const ClassField& param)
 {
     if (auto funcParamPtr = std::get_if<const FunctionParameter*>(&param)) {
-        return (*funcParamPtr)->defaultValue.get();
+        return (*funcParamPtr)->defaultValue;
     }
     else if (auto propertyPtr = std::get_if<const PropertyMember*>(&param)) {
-        return (*propertyPtr)->initializer.get();
+        return (*propertyPtr)->initializer;
     }
     return nullptr;
 }
\ No newline at end of file
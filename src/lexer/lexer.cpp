@@ -24,6 +24,7 @@ const std::map<std::string, TokenType> Lexer::keywords = {{"enum", TokenType::EN
                                                           {"is", TokenType::IS},
                                                           {"self", TokenType::SELF},
                                                           {"operator", TokenType::OPERATOR},
+                                                          {"final", TokenType::FINAL},
                                                           //   {"print", TokenType::PRINT},
                                                           //   {"println", TokenType::PRINTLN},
                                                           {"void", TokenType::VOID},
@@ -36,7 +37,7 @@ const std::map<std::string, TokenType> Lexer::keywords = {{"enum", TokenType::EN
                                                           {"false", TokenType::BOOL_LITERAL}};
 
 Lexer::Lexer(std::ifstream& file, const std::string& filename)
-    : filename(filename)
+    : filename(Location::internFilename(filename))
 {
     std::stringstream buffer;
     buffer << file.rdbuf();
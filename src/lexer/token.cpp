@@ -26,6 +26,7 @@ std::string Token::toString() const
         {TokenType::IS, "IS"},
         {TokenType::SELF, "SELF"},
         {TokenType::OPERATOR, "OPERATOR"},
+        {TokenType::FINAL, "FINAL"},
         // {TokenType::PRINT, "PRINT"},
         // {TokenType::PRINTLN, "PRINTLN"},
         {TokenType::VOID, "VOID"},
@@ -0,0 +1,45 @@
+#include "lexer/token_stream.hpp"
+
+TokenStream::TokenStream(std::vector<Lexer> sources)
+    : sources(std::move(sources))
+{
+    fill(1);
+}
+
+TokenStream::TokenStream(Lexer source)
+{
+    sources.push_back(std::move(source));
+    fill(1);
+}
+
+Token TokenStream::pull()
+{
+    if (sources.empty()) {
+        return Token(TokenType::END_OF_FILE, 1, 1);
+    }
+    while (true) {
+        Token token = sources[currSource].nextToken();
+        if (token.type == TokenType::END_OF_FILE && currSource + 1 < sources.size()) {
+            currSource++;
+            continue;
+        }
+        return token;
+    }
+}
+
+void TokenStream::fill(size_t count)
+{
+    while (tail < head + count) {
+        ring[tail & RING_MASK] = pull();
+        tail++;
+    }
+}
+
+void TokenStream::advance()
+{
+    if (isAtEnd()) {
+        return;
+    }
+    head++;
+    fill(1);
+}
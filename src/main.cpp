@@ -3,6 +3,8 @@
 #include "parser/parser.hpp"
 #include "utils/process.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -14,11 +16,34 @@ int main(int argc, char* argv[])
 {
     cout_pink("🎉Welcome to watermelon compiler!!\n");
     printLogo();
-    if (argc < 2) {
+    // 先取出编译选项，剩余参数按原有方式解析输入文件
+    CompileOptions           options;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--const-eval-budget") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: No step count specified after --const-eval-budget\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.constEvalBudget = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--perf-lint") {
+            options.perfLint = true;
+        }
+        else if (arg == "--print-layouts") {
+            options.printLayouts = true;
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
         printUsage(argv[0]);
         return 1;
     }
-    std::string              firstArg  = argv[1];
+    std::string              firstArg  = args[0];
     std::string              extension = ".wm";
     std::vector<std::string> stdLibFiles;
     std::vector<std::string> userFiles;
@@ -26,29 +51,29 @@ int main(int argc, char* argv[])
     collectLibFiles(stdLibPath, extension, stdLibFiles);
 
     if (firstArg == "--dir") {
-        if (argc < 3) {
+        if (args.size() < 2) {
             std::cerr << "Error: No directory specified after --dir\n";
             printUsage(argv[0]);
             return 1;
         }
-        std::string dirPath = argv[2];
+        std::string dirPath = args[1];
         collectDirectoryFiles(dirPath, extension, userFiles);
-        processFiles(stdLibFiles, userFiles);
+        processFiles(stdLibFiles, userFiles, options);
     }
     else if (firstArg == "--files") {
-        if (argc < 3) {
+        if (args.size() < 2) {
             std::cerr << "Error: No files specified after --files\n";
             printUsage(argv[0]);
             return 1;
         }
-        for (int i = 2; i < argc; i++) {
-            userFiles.push_back(argv[i]);
+        for (size_t i = 1; i < args.size(); i++) {
+            userFiles.push_back(args[i]);
         }
-        processFiles(stdLibFiles, userFiles);
+        processFiles(stdLibFiles, userFiles, options);
     }
     else {
         userFiles.push_back(firstArg);
-        processFiles(stdLibFiles, userFiles);
+        processFiles(stdLibFiles, userFiles, options);
     }
     return 0;
-}
\ No newline at end of file
+}
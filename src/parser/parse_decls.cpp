@@ -2,7 +2,7 @@
 
 #include <iostream>
 
-std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::declaration()
+std::pair<Declaration*, std::optional<Error>> Parser::declaration()
 {
     if (match(TokenType::FN) || (match(TokenType::OPERATOR) && match(TokenType::FUN))) {
         return functionDeclaration();
@@ -13,11 +13,17 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::declaratio
     if (match({TokenType::CLASS, TokenType::DATA, TokenType::BASE})) {
         return classDeclaration();
     }
+    if (match(TokenType::FINAL)) {
+        if (!match({TokenType::CLASS, TokenType::DATA, TokenType::BASE})) {
+            return {nullptr, createError(peek(), "Expect class declaration after 'final'.")};
+        }
+        return classDeclaration(true);
+    }
 
     return {nullptr, createError(peek(), "Expect declaration.")};
 }
 
-std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::functionDeclaration()
+std::pair<Declaration*, std::optional<Error>> Parser::functionDeclaration()
 {
     bool isOperator = false;
     if (previous().type == TokenType::OPERATOR) {
@@ -38,37 +44,36 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::functionDe
             if (paramErr) return {nullptr, paramErr};
 
 
-            std::unique_ptr<Type> paramType = nullptr;
+            Type* paramType = nullptr;
             if (match(TokenType::COLON)) {
                 auto [typeVal, typeErr] = type();
                 if (typeErr) return {nullptr, typeErr};
-                paramType = std::move(typeVal);
+                paramType = typeVal;
             }
 
-            std::unique_ptr<Expression> defaultValue = nullptr;
+            Expression* defaultValue = nullptr;
             if (match(TokenType::ASSIGN)) {
                 auto [defaultVal, defaultErr] = expression();
                 if (defaultErr) return {nullptr, defaultErr};
-                defaultValue = std::move(defaultVal);
+                defaultValue = defaultVal;
             }
 
-            parameters.push_back(FunctionParameter(std::get<std::string>(paramName.value),
-                                                   std::move(paramType),
-                                                   std::move(defaultValue)));
+            parameters.push_back(
+                FunctionParameter(std::get<std::string>(paramName.value), paramType, defaultValue));
         } while (match(TokenType::COMMA));
     }
 
     auto [__, rparenErr] = consume(TokenType::RPAREN, "Expect ')' after parameters.");
     if (rparenErr) return {nullptr, rparenErr};
 
-    std::unique_ptr<Type> returnType = std::make_unique<Type>(Type::builtinVoid());
+    Type* returnType = make<Type>(Type::builtinVoid());
     if (match(TokenType::ARROW)) {
         auto [returnTypeVal, returnTypeErr] = type();
         if (returnTypeErr) return {nullptr, returnTypeErr};
-        returnType = std::move(returnTypeVal);
+        returnType = returnTypeVal;
     }
 
-    std::unique_ptr<Statement> body = nullptr;
+    Statement* body = nullptr;
     if (match(TokenType::ASSIGN)) {
         auto [expr, exprErr] = expression();
         if (exprErr) return {nullptr, exprErr};
@@ -78,35 +83,35 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::functionDe
             consume(TokenType::SEMICOLON, "Expect ';' after function expression.");
         if (semicolonErr) return {nullptr, semicolonErr};
 
-        auto returnStmt = std::make_unique<ReturnStatement>(l, std::move(expr));
-        std::vector<std::unique_ptr<Statement>> statements;
-        statements.push_back(std::move(returnStmt));
-        body = std::make_unique<BlockStatement>(l, std::move(statements));
+        auto returnStmt = make<ReturnStatement>(l, expr);
+        std::vector<Statement*> statements;
+        statements.push_back(returnStmt);
+        body = make<BlockStatement>(l, span(std::move(statements)));
     }
     else if (match(TokenType::LBRACE)) {
-        std::vector<std::unique_ptr<Statement>> statements;
+        std::vector<Statement*> statements;
         while (!check(TokenType::RBRACE) && !isAtEnd()) {
             auto [stmt, stmtErr] = statement();
             if (stmtErr) return {nullptr, stmtErr};
-            statements.push_back(std::move(stmt));
+            statements.push_back(stmt);
         }
 
         auto [rbrace, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after block.");
         if (rbraceErr) return {nullptr, rbraceErr};
 
-        body = std::make_unique<BlockStatement>(rbrace.location, std::move(statements));
+        body = make<BlockStatement>(rbrace.location, span(std::move(statements)));
     }
 
-    return {std::make_unique<FunctionDeclaration>(l,
-                                                  std::get<std::string>(name.value),
-                                                  std::move(parameters),
-                                                  std::move(returnType),
-                                                  std::move(body),
-                                                  isOperator),
+    return {make<FunctionDeclaration>(l,
+                                      std::get<std::string>(name.value),
+                                      span(std::move(parameters)),
+                                      returnType,
+                                      body,
+                                      isOperator),
             std::nullopt};
 }
 
-std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::enumDeclaration()
+std::pair<Declaration*, std::optional<Error>> Parser::enumDeclaration()
 {
     auto [name, nameErr] = consume(TokenType::IDENTIFIER, "Expect enum name.");
     if (nameErr) return {nullptr, nameErr};
@@ -128,12 +133,12 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::enumDeclar
     auto [__, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after enum values.");
     if (rbraceErr) return {nullptr, rbraceErr};
 
-    return {std::make_unique<EnumDeclaration>(
-                name.location, std::get<std::string>(name.value), std::move(values)),
+    return {make<EnumDeclaration>(
+                name.location, std::get<std::string>(name.value), span(std::move(values))),
             std::nullopt};
 }
 
-std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::classDeclaration()
+std::pair<Declaration*, std::optional<Error>> Parser::classDeclaration(bool isFinal)
 {
     ClassDeclaration::Kind kind;
     Location               l = previous().location;
@@ -164,33 +169,32 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::classDecla
             auto [paramName, paramErr] = consume(TokenType::IDENTIFIER, "Expect parameter name.");
             if (paramErr) return {nullptr, paramErr};
 
-            std::unique_ptr<Type> paramType = nullptr;
-            auto [_, colonErr]              = consume(TokenType::COLON, "Expect parameter type.");
+            Type* paramType    = nullptr;
+            auto [_, colonErr] = consume(TokenType::COLON, "Expect parameter type.");
             if (colonErr) return {nullptr, colonErr};
 
             auto [typeVal, typeErr] = type();
             if (typeErr) return {nullptr, typeErr};
-            paramType = std::move(typeVal);
+            paramType = typeVal;
 
 
-            std::unique_ptr<Expression> defaultValue = nullptr;
+            Expression* defaultValue = nullptr;
             if (match(TokenType::ASSIGN)) {
                 auto [defaultVal, defaultErr] = expression();
                 if (defaultErr) return {nullptr, defaultErr};
-                defaultValue = std::move(defaultVal);
+                defaultValue = defaultVal;
             }
 
-            constructorParameters.emplace_back(std::get<std::string>(paramName.value),
-                                               std::move(paramType),
-                                               std::move(defaultValue));
+            constructorParameters.emplace_back(
+                std::get<std::string>(paramName.value), paramType, defaultValue);
         } while (match(TokenType::COMMA));
     }
 
     auto [___, rparenErr] = consume(TokenType::RPAREN, "Expect ')' after constructor parameters.");
     if (rparenErr) return {nullptr, rparenErr};
 
-    std::string                              baseClass;
-    std::vector<std::unique_ptr<Expression>> baseConstructorArgs;
+    std::string              baseClass;
+    std::vector<Expression*> baseConstructorArgs;
 
     if (match(TokenType::INHERITS)) {
         auto [baseClassName, baseClassErr] =
@@ -206,7 +210,7 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::classDecla
             do {
                 auto [expr, exprErr] = expression();
                 if (exprErr) return {nullptr, exprErr};
-                baseConstructorArgs.push_back(std::move(expr));
+                baseConstructorArgs.push_back(expr);
             } while (match(TokenType::COMMA));
         }
 
@@ -218,30 +222,31 @@ std::pair<std::unique_ptr<Declaration>, std::optional<Error>> Parser::classDecla
     auto [_______, lbraceErr] = consume(TokenType::LBRACE, "Expect '{' before class body.");
     if (lbraceErr) return {nullptr, lbraceErr};
 
-    std::vector<std::unique_ptr<ClassMember>> members;
+    std::vector<ClassMember*> members;
     while (!check(TokenType::RBRACE) && !isAtEnd()) {
         auto [member, memberErr] = classMember();
         if (memberErr) return {nullptr, memberErr};
 
         if (member) {
-            members.push_back(std::move(member));
+            members.push_back(member);
         }
     }
 
     auto [________, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after class body.");
     if (rbraceErr) return {nullptr, rbraceErr};
 
-    return {std::make_unique<ClassDeclaration>(l,
-                                               kind,
-                                               std::get<std::string>(name.value),
-                                               std::move(constructorParameters),
-                                               std::move(baseClass),
-                                               std::move(baseConstructorArgs),
-                                               std::move(members)),
+    return {make<ClassDeclaration>(l,
+                                   kind,
+                                   std::get<std::string>(name.value),
+                                   span(std::move(constructorParameters)),
+                                   std::move(baseClass),
+                                   span(std::move(baseConstructorArgs)),
+                                   span(std::move(members)),
+                                   isFinal),
             std::nullopt};
 }
 
-std::pair<std::unique_ptr<ClassMember>, std::optional<Error>> Parser::classMember()
+std::pair<ClassMember*, std::optional<Error>> Parser::classMember()
 {
 
     if (match({TokenType::VAR, TokenType::VAL})) {
@@ -249,48 +254,59 @@ std::pair<std::unique_ptr<ClassMember>, std::optional<Error>> Parser::classMembe
         auto [name, nameErr] = consume(TokenType::IDENTIFIER, "Expect property name.");
         if (nameErr) return {nullptr, nameErr};
 
-        std::unique_ptr<Type> propType = nullptr;
+        Type* propType = nullptr;
         if (match(TokenType::COLON)) {
             auto [typeVal, typeErr] = type();
             if (typeErr) return {nullptr, typeErr};
-            propType = std::move(typeVal);
+            propType = typeVal;
         }
 
-        std::unique_ptr<Expression> initializer = nullptr;
+        Expression* initializer = nullptr;
         if (match(TokenType::ASSIGN)) {
             auto [initExpr, initErr] = expression();
             if (initErr) return {nullptr, initErr};
-            initializer = std::move(initExpr);
+            initializer = initExpr;
         }
         auto [_, semicolonErr] =
             consume(TokenType::SEMICOLON, "Expect ';' after property declaration.");
         if (semicolonErr) return {nullptr, semicolonErr};
 
-        return {std::make_unique<PropertyMember>(name.location,
-                                                 immutable,
-                                                 std::get<std::string>(name.value),
-                                                 std::move(propType),
-                                                 std::move(initializer)),
+        return {make<PropertyMember>(name.location,
+                                     immutable,
+                                     std::get<std::string>(name.value),
+                                     propType,
+                                     initializer),
                 std::nullopt};
     }
     else if (match(TokenType::INIT)) {
         auto [initToken, lbraceErr] = consume(TokenType::LBRACE, "Expect '{' after 'init'.");
         if (lbraceErr) return {nullptr, lbraceErr};
 
-        std::vector<std::unique_ptr<Statement>> statements;
+        std::vector<Statement*> statements;
         while (!check(TokenType::RBRACE) && !isAtEnd()) {
             auto [stmt, stmtErr] = statement();
             if (stmtErr) return {nullptr, stmtErr};
 
-            statements.push_back(std::move(stmt));
+            statements.push_back(stmt);
         }
 
         auto [__, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after init block.");
         if (rbraceErr) return {nullptr, rbraceErr};
 
-        return {std::make_unique<InitBlockMember>(
+        return {make<InitBlockMember>(
                     initToken.location,
-                    std::make_unique<BlockStatement>(Location(), std::move(statements))),
+                    make<BlockStatement>(Location(), span(std::move(statements)))),
+                std::nullopt};
+    }
+    else if (match(TokenType::FINAL)) {
+        if (!match(TokenType::FN) && !match(TokenType::OPERATOR) && !match(TokenType::FUN)) {
+            return {nullptr, createError(peek(), "Expect method declaration after 'final'.")};
+        }
+        auto [functionDecl, funcErr] = functionDeclaration();
+        if (funcErr) return {nullptr, funcErr};
+        Location l = functionDecl->getLocation();
+
+        return {make<MethodMember>(l, cast<FunctionDeclaration>(functionDecl), true),
                 std::nullopt};
     }
     else if (match(TokenType::FN) || match(TokenType::OPERATOR) || match(TokenType::FUN)) {
@@ -298,36 +314,33 @@ std::pair<std::unique_ptr<ClassMember>, std::optional<Error>> Parser::classMembe
         if (funcErr) return {nullptr, funcErr};
         Location l = functionDecl->getLocation();
 
-        return {std::make_unique<MethodMember>(
-                    l,
-                    std::unique_ptr<FunctionDeclaration>(
-                        dynamic_cast<FunctionDeclaration*>(functionDecl.release()))),
+        return {make<MethodMember>(l, cast<FunctionDeclaration>(functionDecl)),
                 std::nullopt};
     }
 
     return {nullptr, createError(peek(), "Expect class member.")};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> Parser::type()
+std::pair<Type*, std::optional<Error>> Parser::type()
 {
     if (match(TokenType::VOID)) {
-        return {std::make_unique<Type>(Type::builtinVoid()), std::nullopt};
+        return {make<Type>(Type::builtinVoid()), std::nullopt};
     }
     else if (match(TokenType::INT_TYPE)) {
-        return {std::make_unique<Type>(Type::builtinInt()), std::nullopt};
+        return {make<Type>(Type::builtinInt()), std::nullopt};
     }
     else if (match(TokenType::FLOAT_TYPE)) {
-        return {std::make_unique<Type>(Type::builtinFloat()), std::nullopt};
+        return {make<Type>(Type::builtinFloat()), std::nullopt};
     }
     else if (match(TokenType::BOOL_TYPE)) {
-        return {std::make_unique<Type>(Type::builtinBool()), std::nullopt};
+        return {make<Type>(Type::builtinBool()), std::nullopt};
     }
     else if (match(TokenType::STR_TYPE)) {
-        return {std::make_unique<Type>(Type::builtinStr()), std::nullopt};
+        return {make<Type>(Type::builtinStr()), std::nullopt};
     }
     else if (match(TokenType::IDENTIFIER)) {
         std::string typeName = std::get<std::string>(previous().value);
-        return {std::make_unique<Type>(Type::classType(typeName)), std::nullopt};
+        return {make<Type>(Type::classType(typeName)), std::nullopt};
     }
 
     return {nullptr, createError(peek(), "Expect type.")};
@@ -1,172 +1,98 @@
 #include "parser/parser.hpp"
 
+#include <array>
 #include <iostream>
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::expression()
+const Parser::InfixRule& Parser::infixRule(TokenType type)
 {
-    return assignment();
+    using Op = BinaryExpression::Operator;
+    static const auto rules = [] {
+        std::array<InfixRule, static_cast<size_t>(TokenType::ERROR) + 1> table;
+        table.fill({Precedence::NONE, Op::ADD});
+        auto set = [&](TokenType type, Precedence precedence, Op op) {
+            table[static_cast<size_t>(type)] = {precedence, op};
+        };
+        set(TokenType::ASSIGN, Precedence::ASSIGNMENT, Op::ASSIGN);
+        set(TokenType::OR, Precedence::OR, Op::OR);
+        set(TokenType::AND, Precedence::AND, Op::AND);
+        set(TokenType::EQ, Precedence::EQUALITY, Op::EQ);
+        set(TokenType::NEQ, Precedence::EQUALITY, Op::NEQ);
+        set(TokenType::LT, Precedence::COMPARISON, Op::LT);
+        set(TokenType::LE, Precedence::COMPARISON, Op::LE);
+        set(TokenType::GT, Precedence::COMPARISON, Op::GT);
+        set(TokenType::GE, Precedence::COMPARISON, Op::GE);
+        set(TokenType::PLUS, Precedence::TERM, Op::ADD);
+        set(TokenType::MINUS, Precedence::TERM, Op::SUB);
+        set(TokenType::MULT, Precedence::FACTOR, Op::MUL);
+        set(TokenType::DIV, Precedence::FACTOR, Op::DIV);
+        set(TokenType::MOD, Precedence::FACTOR, Op::MOD);
+        return table;
+    }();
+    return rules[static_cast<size_t>(type)];
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::assignment()
+std::pair<Expression*, std::optional<Error>> Parser::expression()
 {
-    auto [expr, exprErr] = logicalOr();
-    if (exprErr) return {nullptr, exprErr};
-
-    Location l = expr->getLocation();
-
-
-    if (match(TokenType::ASSIGN)) {
-        auto [value, valueErr] = assignment();
-        if (valueErr) return {nullptr, valueErr};
-
-        if (auto* identExpr = dynamic_cast<IdentifierExpression*>(expr.get())) {
-            return {std::make_unique<BinaryExpression>(
-                        l, BinaryExpression::Operator::ASSIGN, std::move(expr), std::move(value)),
-                    std::nullopt};
-        }
-        else if (auto* memberExpr = dynamic_cast<MemberExpression*>(expr.get())) {
-            if (memberExpr->kind == MemberExpression::Kind::METHOD) {
-                return {nullptr, createError(previous(), "Cannot assign method.")};
-            }
-            return {std::make_unique<BinaryExpression>(
-                        l, BinaryExpression::Operator::ASSIGN, std::move(expr), std::move(value)),
-                    std::nullopt};
-        }
-
-        return {nullptr, createError(previous(), "Invalid assignment target.")};
-    }
-    return {std::move(expr), std::nullopt};
+    return parsePrecedence(Precedence::ASSIGNMENT);
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::logicalOr()
+// Pratt 解析：先解析前缀（一元运算/调用），再按查表得到的优先级循环吃掉二元运算符。
+// 除赋值外的二元运算都是左结合，右操作数以更高一级的优先级解析。
+std::pair<Expression*, std::optional<Error>> Parser::parsePrecedence(Precedence minPrecedence)
 {
-    auto [expr, exprErr] = logicalAnd();
-    if (exprErr) return {nullptr, exprErr};
-
-    Location l = expr->getLocation();
-
-    while (match(TokenType::OR)) {
-        auto op                = BinaryExpression::Operator::OR;
-        auto [right, rightErr] = logicalAnd();
-        if (rightErr) return {nullptr, rightErr};
-
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
-    }
-
-    return {std::move(expr), std::nullopt};
-}
-
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::logicalAnd()
-{
-    auto [expr, exprErr] = equality();
-    if (exprErr) return {nullptr, exprErr};
-
-    Location l = expr->getLocation();
-
-    while (match(TokenType::AND)) {
-        auto op                = BinaryExpression::Operator::AND;
-        auto [right, rightErr] = equality();
-        if (rightErr) return {nullptr, rightErr};
-
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
-    }
-
-    return {std::move(expr), std::nullopt};
-}
-
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::equality()
-{
-    auto [expr, exprErr] = comparison();
-    if (exprErr) return {nullptr, exprErr};
-
-    Location l = expr->getLocation();
-
-    while (match({TokenType::EQ, TokenType::NEQ})) {
-        auto op                = previous().type == TokenType::EQ ? BinaryExpression::Operator::EQ
-                                                                  : BinaryExpression::Operator::NEQ;
-        auto [right, rightErr] = comparison();
-        if (rightErr) return {nullptr, rightErr};
-
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
-    }
-
-    return {std::move(expr), std::nullopt};
-}
-
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::comparison()
-{
-    auto [expr, exprErr] = addition();
+    auto [expr, exprErr] = unary();
     if (exprErr) return {nullptr, exprErr};
 
     Location l = expr->getLocation();
 
-    while (match({TokenType::LT, TokenType::LE, TokenType::GT, TokenType::GE})) {
-        BinaryExpression::Operator op;
-
-        switch (previous().type) {
-            case TokenType::LT: op = BinaryExpression::Operator::LT; break;
-            case TokenType::LE: op = BinaryExpression::Operator::LE; break;
-            case TokenType::GT: op = BinaryExpression::Operator::GT; break;
-            case TokenType::GE: op = BinaryExpression::Operator::GE; break;
-            default: break;
+    while (true) {
+        // "expr is T" 的右侧是类型，与比较运算同级
+        if (check(TokenType::IS) && Precedence::COMPARISON >= minPrecedence) {
+            advance();
+            auto [type, typeErr] = this->type();
+            if (typeErr) return {nullptr, typeErr};
+            expr = make<TypeCheckExpression>(l, expr, type);
+            continue;
         }
 
-        auto [right, rightErr] = addition();
-        if (rightErr) return {nullptr, rightErr};
+        const InfixRule& rule = infixRule(peek().type);
+        if (rule.precedence == Precedence::NONE || rule.precedence < minPrecedence) break;
+        advance();
 
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
-    }
-
-    return {std::move(expr), std::nullopt};
-}
-
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::addition()
-{
-    auto [expr, exprErr] = multiplication();
-    if (exprErr) return {nullptr, exprErr};
-
-    Location l = expr->getLocation();
-
-    while (match({TokenType::PLUS, TokenType::MINUS})) {
-        auto op = previous().type == TokenType::PLUS ? BinaryExpression::Operator::ADD
-                                                     : BinaryExpression::Operator::SUB;
+        if (rule.op == BinaryExpression::Operator::ASSIGN) {
+            return assignment(expr);
+        }
 
-        auto [right, rightErr] = multiplication();
+        auto [right, rightErr] =
+            parsePrecedence(static_cast<Precedence>(static_cast<int>(rule.precedence) + 1));
         if (rightErr) return {nullptr, rightErr};
 
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
+        expr = make<BinaryExpression>(l, rule.op, expr, right);
     }
 
-    return {std::move(expr), std::nullopt};
+    return {expr, std::nullopt};
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::multiplication()
+std::pair<Expression*, std::optional<Error>> Parser::assignment(Expression* target)
 {
-    auto [expr, exprErr] = unary();
-    if (exprErr) return {nullptr, exprErr};
+    Location l = target->getLocation();
 
-    Location l = expr->getLocation();
+    auto [value, valueErr] = parsePrecedence(Precedence::ASSIGNMENT);
+    if (valueErr) return {nullptr, valueErr};
 
-    while (match({TokenType::MULT, TokenType::DIV, TokenType::MOD})) {
-        BinaryExpression::Operator op;
-
-        switch (previous().type) {
-            case TokenType::MULT: op = BinaryExpression::Operator::MUL; break;
-            case TokenType::DIV: op = BinaryExpression::Operator::DIV; break;
-            case TokenType::MOD: op = BinaryExpression::Operator::MOD; break;
-            default: break;
+    if (auto* memberExpr = dyn_cast<MemberExpression>(target)) {
+        if (memberExpr->kind == MemberExpression::Kind::METHOD) {
+            return {nullptr, createError(previous(), "Cannot assign method.")};
         }
-
-        auto [right, rightErr] = unary();
-        if (rightErr) return {nullptr, rightErr};
-
-        expr = std::make_unique<BinaryExpression>(l, op, std::move(expr), std::move(right));
     }
-
-    return {std::move(expr), std::nullopt};
+    else if (!isa<IdentifierExpression>(target)) {
+        return {nullptr, createError(previous(), "Invalid assignment target.")};
+    }
+    return {make<BinaryExpression>(l, BinaryExpression::Operator::ASSIGN, target, value),
+            std::nullopt};
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::unary()
+std::pair<Expression*, std::optional<Error>> Parser::unary()
 {
     if (match({TokenType::MINUS, TokenType::NOT})) {
         auto op = previous().type == TokenType::MINUS ? UnaryExpression::Operator::NEG
@@ -175,14 +101,13 @@ std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::unary()
         auto [right, rightErr] = unary();
         if (rightErr) return {nullptr, rightErr};
 
-        return {std::make_unique<UnaryExpression>(right->getLocation(), op, std::move(right)),
-                std::nullopt};
+        return {make<UnaryExpression>(right->getLocation(), op, right), std::nullopt};
     }
 
     return call();
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::call()
+std::pair<Expression*, std::optional<Error>> Parser::call()
 {
     auto [expr, exprErr] = primary();
     if (exprErr) return {nullptr, exprErr};
@@ -191,30 +116,29 @@ std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::call()
 
     while (true) {
         if (match(TokenType::LPAREN)) {
-            return finishCall(std::move(expr));
+            return finishCall(expr);
         }
         else if (match(TokenType::DOT)) {
             auto [name, nameErr] =
                 consume(TokenType::IDENTIFIER, "Expect property/method name after '.'.");
             if (nameErr) return {nullptr, nameErr};
             if (match(TokenType::LPAREN)) {
-                std::vector<std::unique_ptr<Expression>> arguments;
+                std::vector<Expression*> arguments;
                 if (!check(TokenType::RPAREN)) {
                     do {
                         auto [expr, exprErr] = expression();
                         if (exprErr) return {nullptr, exprErr};
 
-                        arguments.push_back(std::move(expr));
+                        arguments.push_back(expr);
                     } while (match(TokenType::COMMA));
                 }
                 auto [_, rparenErr] = consume(TokenType::RPAREN, "Expect ')' after arguments.");
                 if (rparenErr) return {nullptr, rparenErr};
-                expr = std::make_unique<MemberExpression>(
-                    l, std::move(expr), std::get<std::string>(name.value), std::move(arguments));
+                expr = make<MemberExpression>(
+                    l, expr, std::get<std::string>(name.value), span(std::move(arguments)));
             }
             else {
-                expr = std::make_unique<MemberExpression>(
-                    l, std::move(expr), std::get<std::string>(name.value));
+                expr = make<MemberExpression>(l, expr, std::get<std::string>(name.value));
             }
         }
         else {
@@ -222,14 +146,13 @@ std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::call()
         }
     }
 
-    return {std::move(expr), std::nullopt};
+    return {expr, std::nullopt};
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::finishCall(
-    std::unique_ptr<Expression> callee)
+std::pair<Expression*, std::optional<Error>> Parser::finishCall(Expression* callee)
 {
-    std::vector<std::unique_ptr<Expression>> arguments;
-    Location                                 l = callee->getLocation();
+    std::vector<Expression*> arguments;
+    Location                 l = callee->getLocation();
 
     if (!check(TokenType::RPAREN)) {
         do {
@@ -237,7 +160,7 @@ std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::finishCall(
             if (exprErr) return {nullptr, exprErr};
 
             l = expr->getLocation();
-            arguments.push_back(std::move(expr));
+            arguments.push_back(expr);
         } while (match(TokenType::COMMA));
     }
 
@@ -245,81 +168,75 @@ std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::finishCall(
     if (rparenErr) return {nullptr, rparenErr};
 
 
-    return {std::make_unique<CallExpression>(l, std::move(callee), std::move(arguments)),
-            std::nullopt};
+    return {make<CallExpression>(l, callee, span(std::move(arguments))), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Expression>, std::optional<Error>> Parser::primary()
+std::pair<Expression*, std::optional<Error>> Parser::primary()
 {
     Location l = peek().location;
-    if (match(TokenType::BOOL_LITERAL)) {
-        return {std::make_unique<LiteralExpression>(
-                    l, Type::builtinBool(), std::get<bool>(previous().value)),
-                std::nullopt};
-    }
-
-    if (match(TokenType::INT_LITERAL)) {
-        return {std::make_unique<LiteralExpression>(
-                    l, Type::builtinInt(), std::get<int>(previous().value)),
-                std::nullopt};
-    }
-    if (match(TokenType::FLOAT_LITERAL)) {
-        return {std::make_unique<LiteralExpression>(
-                    l, Type::builtinFloat(), std::get<float>(previous().value)),
+    switch (peek().type) {
+        case TokenType::BOOL_LITERAL:
+            return {
+                make<LiteralExpression>(l, Type::builtinBool(), std::get<bool>(advance().value)),
                 std::nullopt};
-    }
-    if (match(TokenType::STRING_LITERAL)) {
-        return {std::make_unique<LiteralExpression>(
-                    l, Type::builtinStr(), std::get<std::string>(previous().value)),
-                std::nullopt};
-    }
-
-    if (match(TokenType::IDENTIFIER)) {
-        return {std::make_unique<IdentifierExpression>(l, std::get<std::string>(previous().value)),
+        case TokenType::INT_LITERAL:
+            return {make<LiteralExpression>(l, Type::builtinInt(), std::get<int>(advance().value)),
+                    std::nullopt};
+        case TokenType::FLOAT_LITERAL:
+            return {
+                make<LiteralExpression>(l, Type::builtinFloat(), std::get<float>(advance().value)),
                 std::nullopt};
-    }
-
-    if (match(TokenType::SELF)) {
-        return {std::make_unique<IdentifierExpression>(l, "self"), std::nullopt};
-    }
-
-    if (match(TokenType::LPAREN)) {
-        auto [expr, exprErr] = expression();
-        if (exprErr) return {nullptr, exprErr};
-
-        auto [_, rparenErr] = consume(TokenType::RPAREN, "Expect ')' after expression.");
-        if (rparenErr) return {nullptr, rparenErr};
-
-        return {std::move(expr), std::nullopt};
-    }
+        case TokenType::STRING_LITERAL:
+            return {make<LiteralExpression>(
+                        l, Type::builtinStr(), std::get<std::string>(advance().value)),
+                    std::nullopt};
+        case TokenType::IDENTIFIER:
+            return {make<IdentifierExpression>(l, std::get<std::string>(advance().value)),
+                    std::nullopt};
+        case TokenType::SELF:
+            advance();
+            return {make<IdentifierExpression>(l, "self"), std::nullopt};
+        case TokenType::LPAREN: {
+            advance();
+            auto [expr, exprErr] = expression();
+            if (exprErr) return {nullptr, exprErr};
 
-    if (match(TokenType::LBRACKET)) {
-        std::vector<std::unique_ptr<Expression>> elements;
+            auto [_, rparenErr] = consume(TokenType::RPAREN, "Expect ')' after expression.");
+            if (rparenErr) return {nullptr, rparenErr};
 
-        if (!check(TokenType::RBRACKET)) {
-            do {
-                auto [expr, exprErr] = expression();
-                if (exprErr) return {nullptr, exprErr};
-                elements.push_back(std::move(expr));
-            } while (match(TokenType::COMMA));
+            return {expr, std::nullopt};
         }
+        case TokenType::LBRACKET: {
+            advance();
+            std::vector<Expression*> elements;
+
+            if (!check(TokenType::RBRACKET)) {
+                do {
+                    auto [expr, exprErr] = expression();
+                    if (exprErr) return {nullptr, exprErr};
+                    elements.push_back(expr);
+                } while (match(TokenType::COMMA));
+            }
 
-        auto [_, rbracketErr] = consume(TokenType::RBRACKET, "Expect ']' after array elements.");
-        if (rbracketErr) return {nullptr, rbracketErr};
-
-        return {std::make_unique<ArrayExpression>(Location(), std::move(elements)), std::nullopt};
-    }
+            auto [_, rbracketErr] =
+                consume(TokenType::RBRACKET, "Expect ']' after array elements.");
+            if (rbracketErr) return {nullptr, rbracketErr};
 
-    if (match(TokenType::LBRACE)) {
-        auto [body, bodyErr] = expression();
-        if (bodyErr) return {nullptr, bodyErr};
+            return {make<ArrayExpression>(Location(), span(std::move(elements))), std::nullopt};
+        }
+        case TokenType::LBRACE: {
+            advance();
+            auto [body, bodyErr] = expression();
+            if (bodyErr) return {nullptr, bodyErr};
 
-        auto [_, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after lambda body.");
-        if (rbraceErr) return {nullptr, rbraceErr};
+            auto [_, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after lambda body.");
+            if (rbraceErr) return {nullptr, rbraceErr};
 
-        return {std::make_unique<LambdaExpression>(
-                    Location(), std::vector<LambdaExpression::Parameter>(), std::move(body)),
+            return {
+                make<LambdaExpression>(Location(), ArenaSpan<LambdaExpression::Parameter>(), body),
                 std::nullopt};
+        }
+        default: break;
     }
     return {nullptr, createError(peek(), "Expect expression.")};
 }
@@ -2,7 +2,7 @@
 
 #include <iostream>
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::statement()
+std::pair<Statement*, std::optional<Error>> Parser::statement()
 {
     if (match(TokenType::IF)) {
         return ifStatement();
@@ -26,7 +26,7 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::statement()
     return expressionStatement();
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::expressionStatement()
+std::pair<Statement*, std::optional<Error>> Parser::expressionStatement()
 {
     auto [expr, exprErr] = expression();
     if (exprErr) return {nullptr, exprErr};
@@ -34,29 +34,28 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::expressionSt
     auto [_, semicolonErr] = consume(TokenType::SEMICOLON, "Expect ';' after expression.");
     if (semicolonErr) return {nullptr, semicolonErr};
 
-    return {std::make_unique<ExpressionStatement>(expr->getLocation(), std::move(expr)),
-            std::nullopt};
+    return {make<ExpressionStatement>(expr->getLocation(), expr), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::blockStatement()
+std::pair<Statement*, std::optional<Error>> Parser::blockStatement()
 {
-    std::vector<std::unique_ptr<Statement>> statements;
-    Location                                l;
+    std::vector<Statement*> statements;
+    Location                l;
 
     while (!check(TokenType::RBRACE) && !isAtEnd()) {
         auto [stmt, stmtErr] = statement();
         l                    = stmt->getLocation();
         if (stmtErr) return {nullptr, stmtErr};
-        statements.push_back(std::move(stmt));
+        statements.push_back(stmt);
     }
 
     auto [_, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after block.");
     if (rbraceErr) return {nullptr, rbraceErr};
 
-    return {std::make_unique<BlockStatement>(l, std::move(statements)), std::nullopt};
+    return {make<BlockStatement>(l, span(std::move(statements))), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::ifStatement()
+std::pair<Statement*, std::optional<Error>> Parser::ifStatement()
 {
     auto [ifToken, lparenErr] = consume(TokenType::LPAREN, "Expect '(' after 'if'.");
     if (lparenErr) return {nullptr, lparenErr};
@@ -70,21 +69,18 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::ifStatement(
     auto [thenBranch, thenErr] = statement();
     if (thenErr) return {nullptr, thenErr};
 
-    std::unique_ptr<Statement> elseBranch = nullptr;
+    Statement* elseBranch = nullptr;
 
     if (match(TokenType::ELSE)) {
         auto [elseStmt, elseErr] = statement();
         if (elseErr) return {nullptr, elseErr};
-        elseBranch = std::move(elseStmt);
+        elseBranch = elseStmt;
     }
 
-    return {
-        std::make_unique<IfStatement>(
-            ifToken.location, std::move(condition), std::move(thenBranch), std::move(elseBranch)),
-        std::nullopt};
+    return {make<IfStatement>(ifToken.location, condition, thenBranch, elseBranch), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::whenStatement()
+std::pair<Statement*, std::optional<Error>> Parser::whenStatement()
 {
     auto [whenToken, lparenErr] = consume(TokenType::LPAREN, "Expect '(' after 'when'.");
     if (lparenErr) return {nullptr, lparenErr};
@@ -110,18 +106,17 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::whenStatemen
         auto [body, bodyErr] = statement();
         if (bodyErr) return {nullptr, bodyErr};
 
-        cases.push_back({std::move(value), std::move(body)});
+        cases.push_back({value, body});
     }
 
     auto [_____, rbraceErr] = consume(TokenType::RBRACE, "Expect '}' after when cases.");
     if (rbraceErr) return {nullptr, rbraceErr};
 
-    return {
-        std::make_unique<WhenStatement>(whenToken.location, std::move(subject), std::move(cases)),
-        std::nullopt};
+    return {make<WhenStatement>(whenToken.location, subject, span(std::move(cases))),
+            std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::forStatement()
+std::pair<Statement*, std::optional<Error>> Parser::forStatement()
 {
     auto [forToken, lparenErr] = consume(TokenType::LPAREN, "Expect '(' after 'for'.");
     if (lparenErr) return {nullptr, lparenErr};
@@ -146,48 +141,46 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::forStatement
     auto [body, bodyErr] = statement();
     if (bodyErr) return {nullptr, bodyErr};
 
-    return {std::make_unique<ForStatement>(
-                forToken.location, std::move(variable), std::move(iterable), std::move(body)),
+    return {make<ForStatement>(forToken.location, std::move(variable), iterable, body),
             std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::returnStatement()
+std::pair<Statement*, std::optional<Error>> Parser::returnStatement()
 {
-    Token                       returnToken = previous();
-    std::unique_ptr<Expression> value       = nullptr;
+    Token       returnToken = previous();
+    Expression* value       = nullptr;
 
     if (!check(TokenType::SEMICOLON)) {
         auto [expr, exprErr] = expression();
         if (exprErr) return {nullptr, exprErr};
-        value = std::move(expr);
+        value = expr;
     }
 
     auto [_, semicolonErr] = consume(TokenType::SEMICOLON, "Expect ';' after return statement.");
     if (semicolonErr) return {nullptr, semicolonErr};
 
-    return {std::make_unique<ReturnStatement>(returnToken.location, std::move(value)),
-            std::nullopt};
+    return {make<ReturnStatement>(returnToken.location, value), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::variableStatment()
+std::pair<Statement*, std::optional<Error>> Parser::variableStatment()
 {
     bool     immutable   = previous().type == TokenType::VAL;
     Location l           = previous().location;
     auto [name, nameErr] = consume(TokenType::IDENTIFIER, "Expect variable name.");
     if (nameErr) return {nullptr, nameErr};
 
-    std::unique_ptr<Type> declType = nullptr;
+    Type* declType = nullptr;
     if (match(TokenType::COLON)) {
         auto [typeVal, typeErr] = type();
         if (typeErr) return {nullptr, typeErr};
-        declType = std::move(typeVal);
+        declType = typeVal;
     }
 
-    std::unique_ptr<Expression> initializer = nullptr;
+    Expression* initializer = nullptr;
     if (match(TokenType::ASSIGN)) {
         auto [initExpr, initErr] = expression();
         if (initErr) return {nullptr, initErr};
-        initializer = std::move(initExpr);
+        initializer = initExpr;
     }
     if (declType == nullptr && initializer == nullptr) {
         return {nullptr,
@@ -198,11 +191,11 @@ std::pair<std::unique_ptr<Statement>, std::optional<Error>> Parser::variableStat
     auto [_, semicolonErr] =
         consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
     if (semicolonErr) return {nullptr, semicolonErr};
-    return {std::make_unique<VariableStatement>(l,
-                                                immutable,
-                                                std::get<std::string>(name.value),
-                                                std::move(declType),
-                                                nullptr,
-                                                std::move(initializer)),
+    return {make<VariableStatement>(l,
+                                    immutable,
+                                    std::get<std::string>(name.value),
+                                    declType,
+                                    nullptr,
+                                    initializer),
             std::nullopt};
 }
\ No newline at end of file
@@ -2,26 +2,24 @@
 
 #include <iostream>
 
-Token Parser::peek() const
+const Token& Parser::peek() const
 {
-    return tokens[current];
+    return tokens.peek();
 }
 
-Token Parser::previous() const
+const Token& Parser::previous() const
 {
-    return tokens[current - 1];
+    return tokens.previous();
 }
 
 bool Parser::isAtEnd() const
 {
-    return peek().type == TokenType::END_OF_FILE;
+    return tokens.isAtEnd();
 }
 
-Token Parser::advance()
+const Token& Parser::advance()
 {
-    if (!isAtEnd()) {
-        current++;
-    }
+    tokens.advance();
     return previous();
 }
 
@@ -63,14 +61,20 @@ std::pair<Token, std::optional<Error>> Parser::consume(TokenType type, const std
 
 Error Parser::createError(const Token& token, const std::string& message)
 {
+    // token 是边解析边读入的，遇到词法错误时优先报告词法错误
+    const Token& current = peek();
+    if (current.type == TokenType::ERROR) {
+        return Error(std::get<std::string>(current.value), current.location);
+    }
     return Error(message, token.location);
 }
 
 std::pair<std::unique_ptr<Program>, std::optional<Error>> Parser::parse()
 {
-    current = 0;
+    auto program = std::make_unique<Program>();
+    arena        = &program->arena;
 
-    std::vector<std::unique_ptr<Declaration>> declarations;
+    std::vector<Declaration*> declarations;
 
     while (!isAtEnd()) {
         auto [decl, declErr] = declaration();
@@ -80,7 +84,7 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> Parser::parse()
         }
 
         if (decl) {
-            declarations.push_back(std::move(decl));
+            declarations.push_back(decl);
         }
         else {
             if (isAtEnd()) break;
@@ -88,5 +92,6 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> Parser::parse()
         }
     }
 
-    return {std::make_unique<Program>(std::move(declarations)), std::nullopt};
+    program->declarations = span(std::move(declarations));
+    return {std::move(program), std::nullopt};
 }
\ No newline at end of file
@@ -3,14 +3,12 @@
 
 std::optional<Error> SemanticAnalyzer::analyzeDeclaration(Declaration& decl)
 {
-    if (auto* classDecl = dynamic_cast<ClassDeclaration*>(&decl)) {
-        return analyzeClassDeclaration(*classDecl);
-    }
-    else if (auto* enumDecl = dynamic_cast<EnumDeclaration*>(&decl)) {
-        return analyzeEnumDeclaration(*enumDecl);
-    }
-    else if (auto* funcDecl = dynamic_cast<FunctionDeclaration*>(&decl)) {
-        return analyzeFunctionDeclaration(*funcDecl);
+    switch (decl.getNodeKind()) {
+        case NodeKind::CLASS_DECL: return analyzeClassDeclaration(*cast<ClassDeclaration>(&decl));
+        case NodeKind::ENUM_DECL: return analyzeEnumDeclaration(*cast<EnumDeclaration>(&decl));
+        case NodeKind::FUNCTION_DECL:
+            return analyzeFunctionDeclaration(*cast<FunctionDeclaration>(&decl));
+        default: break;
     }
     return std::nullopt;
 }
@@ -18,20 +16,28 @@ std::optional<Error> SemanticAnalyzer::analyzeDeclaration(Declaration& decl)
 std::optional<Error> SemanticAnalyzer::analyzeClassDeclaration(ClassDeclaration& classDecl)
 {
     this->symbolTable.enterScope(Format("class {0}", classDecl.name));
-    this->symbolTable.add("self", Type::classType(classDecl.name), SymbolKind::VAL);
+    this->symbolTable.add(
+        "self", Type::classType(classDecl.name), SymbolKind::VAL, {Binding::Kind::SELF});
+    int savedEffectNode = this->effectAnalyzer.enterConstruction(
+        this->classTable.getClassIdRange(Type::classType(classDecl.name))->id);
 
-    // parents' all construtor param
-    if (!classDecl.baseClass.empty()) {
-        auto parents = this->classTable.getInheritMap(classDecl.name);
-        for (auto it = parents->rbegin(); it != parents->rend(); ++it) {
-            for (const auto& constructorParam : (*it)->constructorParameters) {
-                this->symbolTable.add(constructorParam.name, *constructorParam.type);
-                this->symbolTable.add(Format("self_{1}", constructorParam.name),
-                                      *constructorParam.type);
-            }
+    // 按对象布局把父类和自身的构造参数、属性加入作用域，同名时后出现的覆盖前面的
+    const auto* layout = this->classTable.getLayout(Type::classType(classDecl.name));
+    for (size_t i = 0; i < layout->fields.size(); i++) {
+        Binding binding = {Binding::Kind::FIELD, static_cast<int>(i)};
+        if (const auto* param = std::get_if<const FunctionParameter*>(&layout->fields[i])) {
+            this->symbolTable.add((*param)->name, *(*param)->type, SymbolKind::VAR, binding);
+            this->symbolTable.add(
+                Format("self_{0}", (*param)->name), *(*param)->type, SymbolKind::VAR, binding);
+        }
+        else {
+            const auto* property = std::get<const PropertyMember*>(layout->fields[i]);
+            this->symbolTable.add(property->name, *property->type, property->immutable, binding);
+            this->symbolTable.add(
+                Format("self_{0}", property->name), *property->type, property->immutable, binding);
         }
     }
-    // self's construtor param override
+
     bool hasDefaultParam = false;
     for (const auto& constructorParam : classDecl.constructorParameters) {
         if (hasDefaultParam && constructorParam.defaultValue == nullptr) {
@@ -44,12 +50,20 @@ std::optional<Error> SemanticAnalyzer::analyzeClassDeclaration(ClassDeclaration&
         if (constructorParam.defaultValue != nullptr) {
             hasDefaultParam = true;
         }
-        this->symbolTable.add(constructorParam.name, *constructorParam.type);
-        this->symbolTable.add(Format("self_{0}", constructorParam.name), *constructorParam.type);
     }
+    this->initializedProperties.clear();
+    const ClassLayout* parentLayout = nullptr;
     if (!classDecl.baseClass.empty()) {
-        auto parent             = this->classTable.find(classDecl.baseClass);
-        int  requiredParamCount = 0;
+        auto parent = this->classTable.find(classDecl.baseClass);
+        if (parent->isFinal) {
+            return Error(Format("Class '{0}' cannot inherit from final class '{1}'",
+                                classDecl.name,
+                                parent->name),
+                         classDecl.getLocation());
+        }
+        parentLayout = this->classTable.getLayout(Type::classType(parent->name));
+
+        int requiredParamCount = 0;
         for (const auto& param : parent->constructorParameters) {
             if (param.defaultValue == nullptr) requiredParamCount++;
         }
@@ -72,61 +86,106 @@ std::optional<Error> SemanticAnalyzer::analyzeClassDeclaration(ClassDeclaration&
                 classDecl.getLocation());
         }
         for (int i = 0; i < classDecl.baseConstructorArgs.size(); i++) {
-            const auto& baseArg         = classDecl.baseConstructorArgs[i];
+            auto&       baseArg         = classDecl.baseConstructorArgs[i];
             const auto& parentParam     = parent->constructorParameters[i];
-            auto [baseArgType, exprErr] = analyzeExpression(*baseArg);
+            auto [baseArgType, exprErr] = analyzeExpression(baseArg);
             if (exprErr) return exprErr;
-            if (!this->classTable.checkInherit(baseArgType->getName(),
-                                               parentParam.type->getName())) {
+            if (!this->classTable.checkInherit(baseArgType, *parentParam.type)) {
                 return Error(Format("Cannot convert argument {0} from '{1}' to '{2}' in base class "
                                     "'{3}' constructor",
                                     i + 1,
-                                    baseArgType->getName(),
+                                    baseArgType.getName(),
                                     parentParam.type->getName(),
                                     classDecl.baseClass),
                              baseArg->getLocation());
             }
         }
     }
-    auto parents = this->classTable.getInheritMap(classDecl.name);
-    for (const auto& parentClass : *parents) {
-        for (const auto& parentMember : parentClass->members) {
-            if (const auto property = dynamic_cast<const PropertyMember*>(parentMember.get())) {
-                this->symbolTable.add(property->getName(), *property->type, property->immutable);
-                this->symbolTable.add(
-                    Format("self_{0}", property->getName()), *property->type, property->immutable);
-            }
-        }
-    }
     for (const auto& member : classDecl.members) {
-        if (const auto property = dynamic_cast<const PropertyMember*>(member.get())) {
-            this->symbolTable.add(property->getName(), *property->type, property->immutable);
-            this->symbolTable.add(
-                Format("self_{0}", property->getName()), *property->type, property->immutable);
+        if (const auto property = dyn_cast<PropertyMember>(member)) {
+            if (property->initializer == nullptr) continue;
+            auto [initType, initErr] = analyzeExpression(property->initializer);
+            if (initErr) return initErr;
+            if (!this->classTable.checkInherit(initType, *property->type)) {
+                return Error(Format("Cannot initialize property '{0}' of type '{1}' with value of "
+                                    "type '{2}'",
+                                    property->name,
+                                    property->type->getName(),
+                                    initType.getName()),
+                             property->initializer->getLocation());
+            }
         }
-        else if (const auto method = dynamic_cast<const MethodMember*>(member.get())) {
+        else if (const auto method = dyn_cast<MethodMember>(member)) {
+            if (parentLayout != nullptr) {
+                auto it = parentLayout->methodIndex.find(method->getName());
+                if (it != parentLayout->methodIndex.end() &&
+                    parentLayout->methods[it->second].method->isFinal) {
+                    return Error(Format("Method '{0}' in class '{1}' cannot override final method "
+                                        "of class '{2}'",
+                                        method->getName(),
+                                        classDecl.name,
+                                        parentLayout->methods[it->second].owner->name),
+                                 method->getLocation());
+                }
+            }
             auto functionDeclErr = analyzeFunctionDeclaration(*method->function);
             if (functionDeclErr) return functionDeclErr;
         }
-        else if (const auto init = dynamic_cast<const InitBlockMember*>(member.get())) {
-            auto initBlockErr = analyzeBlockStatement(*init->block);
+        else if (const auto init = dyn_cast<InitBlockMember>(member)) {
+            int savedLocalCount      = this->localCount;
+            int savedAllocationSites = this->allocationSites;
+            this->localCount         = 0;
+            this->allocationSites    = 0;
+            this->constantEvaluator.clearLocals();
+            // 顶层语句在每次构造时至多执行一次
+            this->constructingClass = &classDecl;
+            for (const auto* stmt : init->block->statements) {
+                if (const auto* exprStmt = dyn_cast<ExpressionStatement>(stmt)) {
+                    this->initializingWrites.insert(exprStmt->expression);
+                }
+            }
+            auto initBlockErr       = analyzeBlockStatement(*init->block);
+            this->constructingClass = nullptr;
+            this->initializingWrites.clear();
             if (initBlockErr) return initBlockErr;
+            init->localCount      = this->localCount;
+            init->allocationSites = this->allocationSites;
+            this->localCount      = savedLocalCount;
+            this->allocationSites = savedAllocationSites;
+            this->constantEvaluator.clearLocals();
         }
     }
+    this->effectAnalyzer.exit(savedEffectNode);
     this->symbolTable.exitScope();
     return std::nullopt;
 }
 
+// 枚举值按声明顺序编号，IRGen 直接生成整数常量
 std::optional<Error> SemanticAnalyzer::analyzeEnumDeclaration(EnumDeclaration& decl)
 {
-    throw "Not yet implemented SemanticAnalyzer::analyzeEnumDeclaration";
+    for (size_t i = 0; i < decl.values.size(); i++) {
+        if (std::find(decl.values.begin(), decl.values.begin() + i, decl.values[i]) !=
+            decl.values.begin() + i) {
+            return Error(Format("Enum value '{0}' is already defined in enum '{1}'",
+                                decl.values[i],
+                                decl.name),
+                         decl.getLocation());
+        }
+    }
+    return std::nullopt;
 }
 
 std::optional<Error> SemanticAnalyzer::analyzeFunctionDeclaration(FunctionDeclaration& decl)
 {
     this->symbolTable.enterScope(Format("function {0}", decl.name));
-    bool hasDefaultParam = false;
-    for (const auto& param : decl.parameters) {
+    int savedLocalCount      = this->localCount;
+    int savedAllocationSites = this->allocationSites;
+    this->localCount         = 0;
+    this->allocationSites    = 0;
+    bool hasDefaultParam     = false;
+    int  savedEffectNode     = this->effectAnalyzer.enterFunction(decl);
+    this->constantEvaluator.clearLocals();
+    for (auto& param : decl.parameters) {
         if (hasDefaultParam && param.defaultValue == nullptr) {
             return Error(Format("Parameter '{0}' without default value follows parameter with "
                                 "default value in function '{1}'",
@@ -136,20 +195,21 @@ std::optional<Error> SemanticAnalyzer::analyzeFunctionDeclaration(FunctionDeclar
         }
         if (param.defaultValue != nullptr) {
             hasDefaultParam                    = true;
-            auto [defaultType, defaultTypeErr] = analyzeExpression(*param.defaultValue);
+            auto [defaultType, defaultTypeErr] = analyzeExpression(param.defaultValue);
             if (defaultTypeErr) return defaultTypeErr;
-            if (!this->classTable.checkInherit(defaultType->getName(), param.type->getName())) {
+            if (!this->classTable.checkInherit(defaultType, *param.type)) {
                 return Error(
                     Format("Cannot convert default value from '{0}' to '{1}' for parameter "
                            "'{2}' in function '{3}'",
-                           defaultType->getName(),
+                           defaultType.getName(),
                            param.type->getName(),
                            param.name,
                            decl.name),
                     param.defaultValue->getLocation());
             }
         }
-        this->symbolTable.add(param.name, *param.type);
+        this->symbolTable.add(
+            param.name, *param.type, SymbolKind::VAR, {Binding::Kind::LOCAL, this->localCount++});
     }
     if (decl.body) {
         auto error = analyzeStatement(*decl.body);
@@ -168,8 +228,7 @@ std::optional<Error> SemanticAnalyzer::analyzeFunctionDeclaration(FunctionDeclar
                 auto [type, returnLocation] = this->currentFunctionReturnTypes.top();
                 if (!decl.returnType) {}
                 else {
-                    if (!this->classTable.checkInherit(type.getName(),
-                                                       decl.returnType->getName())) {
+                    if (!this->classTable.checkInherit(type, *decl.returnType)) {
                         return Error(
                             Format(
                                 "Return type mismatch in function '{0}': expected '{1}', got '{2}'",
@@ -183,6 +242,12 @@ std::optional<Error> SemanticAnalyzer::analyzeFunctionDeclaration(FunctionDeclar
             }
         }
     }
+    decl.localCount       = this->localCount;
+    decl.allocationSites  = this->allocationSites;
+    this->localCount      = savedLocalCount;
+    this->allocationSites = savedAllocationSites;
+    this->constantEvaluator.clearLocals();
+    this->effectAnalyzer.exit(savedEffectNode);
     this->symbolTable.exitScope();
     return std::nullopt;
 }
\ No newline at end of file
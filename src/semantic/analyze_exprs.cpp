@@ -3,71 +3,79 @@
 
 #include <typeindex>
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeExpression(
-    Expression& expr)
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeExpression(Expression& expr)
 {
-    auto analyzeAndSetType =
-        [&](auto&& analyzeFunc,
-            auto&  specificExpr) -> std::pair<std::unique_ptr<Type>, std::optional<Error>> {
+    auto analyzeAndSetType = [&](auto&& analyzeFunc,
+                                 auto&  specificExpr) -> std::pair<Type, std::optional<Error>> {
         auto [type, err] = analyzeFunc(specificExpr);
-        if (err) return {nullptr, err};
+        if (err) return {Type(), err};
 
-        expr.setType(std::move(*type));
-        return {std::make_unique<Type>(expr.getType()), std::nullopt};
+        expr.setType(type);
+        return {type, std::nullopt};
     };
 
-    if (auto* arrayExpr = dynamic_cast<ArrayExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeArrayExpression(e); }, *arrayExpr);
-    }
-    else if (auto* binaryExpr = dynamic_cast<BinaryExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeBinaryExpression(e); },
-                                 *binaryExpr);
-    }
-    else if (auto* callExpr = dynamic_cast<CallExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeCallExpression(e); }, *callExpr);
-    }
-    else if (auto* idExpr = dynamic_cast<IdentifierExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeIdentifierExpression(e); },
-                                 *idExpr);
-    }
-    else if (auto* lambdaExpr = dynamic_cast<LambdaExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeLambdaExpression(e); },
-                                 *lambdaExpr);
-    }
-    else if (auto* literalExpr = dynamic_cast<LiteralExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeLiteralExpression(e); },
-                                 *literalExpr);
-    }
-    else if (auto* memberExpr = dynamic_cast<MemberExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeMemberExpression(e); },
-                                 *memberExpr);
-    }
-    else if (auto* typeCheckExpr = dynamic_cast<TypeCheckExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeTypeCheckExpression(e); },
-                                 *typeCheckExpr);
-    }
-    else if (auto* unaryExpr = dynamic_cast<UnaryExpression*>(&expr)) {
-        return analyzeAndSetType([this](auto& e) { return analyzeUnaryExpression(e); }, *unaryExpr);
+    switch (expr.getNodeKind()) {
+        case NodeKind::ARRAY_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeArrayExpression(e); },
+                                     *cast<ArrayExpression>(&expr));
+        case NodeKind::BINARY_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeBinaryExpression(e); },
+                                     *cast<BinaryExpression>(&expr));
+        case NodeKind::CALL_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeCallExpression(e); },
+                                     *cast<CallExpression>(&expr));
+        case NodeKind::IDENTIFIER_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeIdentifierExpression(e); },
+                                     *cast<IdentifierExpression>(&expr));
+        case NodeKind::LAMBDA_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeLambdaExpression(e); },
+                                     *cast<LambdaExpression>(&expr));
+        case NodeKind::LITERAL_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeLiteralExpression(e); },
+                                     *cast<LiteralExpression>(&expr));
+        case NodeKind::MEMBER_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeMemberExpression(e); },
+                                     *cast<MemberExpression>(&expr));
+        case NodeKind::TYPE_CHECK_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeTypeCheckExpression(e); },
+                                     *cast<TypeCheckExpression>(&expr));
+        case NodeKind::UNARY_EXPR:
+            return analyzeAndSetType([this](auto& e) { return analyzeUnaryExpression(e); },
+                                     *cast<UnaryExpression>(&expr));
+        default: break;
     }
 
-    return {nullptr, std::nullopt};
+    return {Type(), std::nullopt};
+}
+
+// 分析表达式，并在它的子表达式都已是常量时折叠为字面量
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeExpression(Expression*& expr)
+{
+    this->constantEvaluator.enterExpression(expr);
+    auto result = analyzeExpression(*expr);
+    if (!result.second) this->constantEvaluator.fold(expr);
+    this->constantEvaluator.exitExpression();
+    return result;
 }
 
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeArrayExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeArrayExpression(
     ArrayExpression& expr)
 {
     // TODO analyzeArrayExpression
-    return {nullptr, Error("Not yet implemented ArrayExpression Semantic Check")};
+    return {Type(), Error("Not yet implemented ArrayExpression Semantic Check")};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeBinaryExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeBinaryExpression(
     BinaryExpression& expr)
 {
-    auto [leftType, errorLeft] = analyzeExpression(*expr.left);
-    if (errorLeft) return {nullptr, errorLeft};
-    auto [rightType, errorRight] = analyzeExpression(*expr.right);
-    if (errorRight) return {nullptr, errorRight};
+    // 赋值的左侧是存储位置，不能折叠
+    auto [leftType, errorLeft] = expr.op == BinaryExpression::Operator::ASSIGN
+                                     ? analyzeExpression(*expr.left)
+                                     : analyzeExpression(expr.left);
+    if (errorLeft) return {Type(), errorLeft};
+    auto [rightType, errorRight] = analyzeExpression(expr.right);
+    if (errorRight) return {Type(), errorRight};
 
     switch (expr.op) {
         case BinaryExpression::Operator::ADD:
@@ -76,18 +84,20 @@ std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyze
         case BinaryExpression::Operator::DIV:
         case BinaryExpression::Operator::MOD:
             // TODO: 检查操作数类型是否兼容
-            if (leftType->isStr() && rightType->isStr() &&
+            if (leftType.isStr() && rightType.isStr() &&
                 expr.op == BinaryExpression::Operator::ADD) {
-                return {std::make_unique<Type>(Type::builtinStr()), std::nullopt};
+                // 拼接经 _concat_strs 分配新字符串
+                this->effectAnalyzer.addEffects(Effects::READS_MEMORY | Effects::ALLOCATES);
+                return {Type::builtinStr(), std::nullopt};
             }
-            if (leftType->canMathOp() && rightType->canMathOp() && *leftType == *rightType) {
-                return {std::make_unique<Type>(std::move(*leftType)), std::nullopt};
+            if (leftType.canMathOp() && rightType.canMathOp() && leftType == rightType) {
+                return {leftType, std::nullopt};
             }
             else {
-                return {nullptr,
+                return {Type(),
                         Error(Format("Incompatible types: '{0}' and '{1}' in arithmetic operation",
-                                     leftType->getName(),
-                                     rightType->getName()),
+                                     leftType.getName(),
+                                     rightType.getName()),
                               expr.getLocation())};
             }
             break;
@@ -98,85 +108,115 @@ std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyze
         case BinaryExpression::Operator::LE:
         case BinaryExpression::Operator::GT:
         case BinaryExpression::Operator::GE:
-            if (leftType->canCompare() && rightType->canCompare() && *leftType == *rightType) {
-                return {std::make_unique<Type>(Type::builtinBool()), std::nullopt};
+            // 枚举值只能判断相等
+            if ((leftType.canCompare() && rightType.canCompare() && leftType == rightType) ||
+                (leftType.isEnum() && leftType == rightType &&
+                 (expr.op == BinaryExpression::Operator::EQ ||
+                  expr.op == BinaryExpression::Operator::NEQ))) {
+                return {Type::builtinBool(), std::nullopt};
             }
             else {
-                return {nullptr,
+                return {Type(),
                         Error(Format("Incompatible types: '{0}' and '{1}' in comparison operation",
-                                     leftType->getName(),
-                                     rightType->getName()),
+                                     leftType.getName(),
+                                     rightType.getName()),
                               expr.getLocation())};
             }
             break;
 
         case BinaryExpression::Operator::AND:
         case BinaryExpression::Operator::OR:
-            if (leftType->isBool() && rightType->isBool()) {
-                return {std::make_unique<Type>(Type::builtinBool()), std::nullopt};
+            if (leftType.isBool() && rightType.isBool()) {
+                return {Type::builtinBool(), std::nullopt};
             }
             else {
-                return {nullptr,
+                return {Type(),
                         Error(Format("Incompatible types: '{0}' and '{1}' in logical operation",
-                                     leftType->getName(),
-                                     rightType->getName()),
+                                     leftType.getName(),
+                                     rightType.getName()),
                               expr.getLocation())};
             }
             break;
 
 
         case BinaryExpression::Operator::ASSIGN:
-            // TODO: 检查右侧类型是否可以赋值给左侧
-            // TODO: 左侧的变量是否可以可变
-            // directly cast
-            if (const auto* leftExpr = dynamic_cast<const IdentifierExpression*>(expr.left.get())) {
-                if (*(this->symbolTable.findKind(leftExpr->name)) == SymbolKind::VAL) {
-                    return {
-                        nullptr,
-                        Error(Format("Cannot assign to immutable variable '{0}'", leftExpr->name),
-                              expr.getLocation())};
-                }
-            }
-            else if (const auto* memberExpr =
-                         dynamic_cast<const MemberExpression*>(expr.left.get())) {
-                if (*(this->symbolTable.findKind(Format("self_{0}", memberExpr->property))) ==
-                    SymbolKind::VAL) {
-                    return {
-                        nullptr,
-                        Error(Format("Cannot assign to immutable variable '{0}'", leftExpr->name),
-                              expr.getLocation())};
-                }
-            }
-
-
-            if (!this->classTable.checkInherit(rightType->getName(), leftType->getName())) {
-                return {nullptr,
+            if (auto assignError = checkAssignment(expr)) return {Type(), assignError};
+            if (!this->classTable.checkInherit(rightType, leftType)) {
+                return {Type(),
                         Error(Format("Cannot assign value of type '{0}' to variable of type '{1}'",
-                                     rightType->getName(),
-                                     leftType->getName()),
+                                     rightType.getName(),
+                                     leftType.getName()),
                               expr.getLocation())};
             }
+            this->effectAnalyzer.addAssignment(*expr.left);
 
+            return {leftType, std::nullopt};
+    }
+    return {Type(), std::nullopt};
+}
 
-            return {std::make_unique<Type>(std::move(*leftType)), std::nullopt};
+// val 只写一次：局部变量只在声明时初始化；属性由初始值写入，没有初始值的属性
+// 可以在声明它的类的 init 块中由一条顶层赋值语句写入一次
+std::optional<Error> SemanticAnalyzer::checkAssignment(const BinaryExpression& expr)
+{
+    const ClassLayout* layout = nullptr;
+    int                index  = -1;
+    bool               onSelf = false;
+    if (const auto* identifier = dyn_cast<IdentifierExpression>(expr.left)) {
+        if (identifier->binding.kind != Binding::Kind::FIELD) {
+            if (*this->symbolTable.findKind(identifier->name) != SymbolKind::VAL) {
+                return std::nullopt;
+            }
+            return Error(Format("Cannot assign to immutable variable '{0}'", identifier->name),
+                         expr.getLocation());
+        }
+        layout = this->classTable.getLayout(this->symbolTable.find("self")->type);
+        index  = identifier->binding.index;
+        onSelf = true;
+    }
+    else if (const auto* member = dyn_cast<MemberExpression>(expr.left)) {
+        if (member->binding.kind == Binding::Kind::ENUM_VALUE) {
+            return Error(Format("Cannot assign to enum value '{0}'", member->property),
+                         expr.getLocation());
+        }
+        if (member->kind != MemberExpression::Kind::PROPERTY) return std::nullopt;
+        const auto* object = dyn_cast<IdentifierExpression>(member->object);
+        layout             = this->classTable.getLayout(member->object->getType());
+        index              = member->binding.index;
+        onSelf             = object && object->binding.kind == Binding::Kind::SELF;
     }
-    return {nullptr, std::nullopt};
+    if (!layout) return std::nullopt;
+
+    const auto* property = std::get_if<const PropertyMember*>(&layout->fields[index]);
+    if (!property || !(*property)->immutable) return std::nullopt;
+    bool declaredHere = this->constructingClass &&
+                        std::count(this->constructingClass->members.begin(),
+                                   this->constructingClass->members.end(),
+                                   *property);
+    if (onSelf && declaredHere && !(*property)->initializer &&
+        this->initializingWrites.count(&expr)) {
+        if (this->initializedProperties.insert(*property).second) return std::nullopt;
+        return Error(Format("Immutable property '{0}' is assigned more than once",
+                            (*property)->name),
+                     expr.getLocation());
+    }
+    return Error(Format("Cannot assign to immutable property '{0}'", (*property)->name),
+                 expr.getLocation());
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeCallExpression(
-    CallExpression& expr)
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeCallExpression(CallExpression& expr)
 {
-    if (dynamic_cast<IdentifierExpression*>(expr.callee.get()) == nullptr) {
-        return {nullptr,
+    if (!isa<IdentifierExpression>(expr.callee)) {
+        return {Type(),
                 Error("The callee in a call expression must be an identifier",
                       expr.callee->getLocation())};
     }
 
     auto [calleeType, errorCallee] = analyzeExpression(*expr.callee);
-    if (errorCallee) return {nullptr, errorCallee};
+    if (errorCallee) return {Type(), errorCallee};
 
-    auto validateArguments = [this, &expr](const std::vector<FunctionParameter>& params,
-                                           const std::string&                    callType,
+    auto validateArguments = [this, &expr](const ArenaSpan<FunctionParameter>& params,
+                                           const std::string&                  callType,
                                            const std::string& name) -> std::optional<Error> {
         int requiredParamCount = 0;
         for (const auto& param : params) {
@@ -201,15 +241,13 @@ std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyze
         }
         size_t i = 0;
         for (; i < expr.arguments.size(); i++) {
-            auto [argType, errorArg] = analyzeExpression(*(expr.arguments[i]));
+            auto [argType, errorArg] = analyzeExpression(expr.arguments[i]);
             if (errorArg) return errorArg;
-            const std::string& expectedType = params[i].type->getName();
-            const std::string& actualType   = argType->getName();
-            if (!this->classTable.checkInherit(actualType, expectedType)) {
+            if (!this->classTable.checkInherit(argType, *params[i].type)) {
                 return Error(Format("Argument {0}: cannot convert from '{1}' to '{2}' in {3} '{4}'",
                                     i + 1,
-                                    actualType,
-                                    expectedType,
+                                    argType.getName(),
+                                    params[i].type->getName(),
                                     callType,
                                     name),
                              expr.arguments[i]->getLocation());
@@ -218,12 +256,11 @@ std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyze
         while (i < params.size()) {
             auto [defaultType, errorDefault] = analyzeExpression(*(params[i].defaultValue));
             if (errorDefault) return errorDefault;
-            const std::string& declDefaultValType = params[i].type->getName();
-            if (!this->classTable.checkInherit(defaultType->getName(), declDefaultValType)) {
+            if (!this->classTable.checkInherit(defaultType, *params[i].type)) {
                 return Error(Format("Argument {0}: cannot convert from '{1}' to '{2}' in {3} '{4}'",
                                     i + 1,
-                                    defaultType->getName(),
-                                    declDefaultValType,
+                                    defaultType.getName(),
+                                    params[i].type->getName(),
                                     callType,
                                     name),
                              params[i].defaultValue->getLocation());
@@ -233,175 +270,213 @@ std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyze
         return std::nullopt;
     };
 
-    const auto* cls  = this->classTable.find(calleeType->getName());
-    const auto* func = this->functionTable.find(calleeType->getName());
+    const auto* cls  = this->classTable.find(calleeType.getName());
+    const auto* func = this->functionTable.find(calleeType.getName());
 
     if (cls) {
         if (auto error = validateArguments(cls->constructorParameters, "constructor", cls->name)) {
-            return {nullptr, error};
+            return {Type(), error};
         }
-        return {std::make_unique<Type>(Type::classType(cls->name)), std::nullopt};
+        this->allocationSites++;
+        this->effectAnalyzer.addConstruction(
+            cast<IdentifierExpression>(expr.callee)->binding.index);
+        return {Type::classType(cls->name), std::nullopt};
     }
 
     if (func) {
         if (auto error = validateArguments(func->parameters, "function", func->name)) {
-            return {nullptr, error};
+            return {Type(), error};
         }
-        return {std::make_unique<Type>(*func->returnType), std::nullopt};
+        this->effectAnalyzer.addCall(*func, expr.arguments);
+        return {*func->returnType, std::nullopt};
     }
 
-    return {nullptr, Error("Failed to process call", expr.getLocation())};
+    return {Type(), Error("Failed to process call", expr.getLocation())};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>>
-SemanticAnalyzer::analyzeIdentifierExpression(IdentifierExpression& expr)
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeIdentifierExpression(
+    IdentifierExpression& expr)
 {
-    auto symbol = this->symbolTable.findType(expr.name);
+    auto symbol = this->symbolTable.find(expr.name);
     if (symbol == nullptr)
-        return {nullptr,
+        return {Type(),
                 Error(Format("Undefined identifier '{0}'", expr.name), expr.getLocation())};
-    return {std::make_unique<Type>(*symbol), std::nullopt};
+    if (symbol->kind == SymbolKind::ENUM) {
+        return {Type(),
+                Error(Format("Enum '{0}' is not a value", expr.name), expr.getLocation())};
+    }
+    expr.binding = symbol->binding;
+    if (expr.binding.kind == Binding::Kind::FIELD) {
+        this->effectAnalyzer.addEffects(Effects::READS_MEMORY);
+    }
+    return {symbol->type, std::nullopt};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeLambdaExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeLambdaExpression(
     LambdaExpression& expr)
 {
     // TODO analyzeLambdaExpression
-    return {nullptr, Error("Not yet implemented LambdaExpression Semantic Check")};
+    return {Type(), Error("Not yet implemented LambdaExpression Semantic Check")};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeLiteralExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeLiteralExpression(
     LiteralExpression& expr)
 {
-    switch (expr.getType().kind) {
-        case Type::Kind::INT: return {std::make_unique<Type>(Type::builtinInt()), std::nullopt};
-        case Type::Kind::FLOAT: return {std::make_unique<Type>(Type::builtinFloat()), std::nullopt};
-        case Type::Kind::BOOL: return {std::make_unique<Type>(Type::builtinBool()), std::nullopt};
-        case Type::Kind::STR: return {std::make_unique<Type>(Type::builtinStr()), std::nullopt};
+    switch (expr.getType().getKind()) {
+        case Type::Kind::INT: return {Type::builtinInt(), std::nullopt};
+        case Type::Kind::FLOAT: return {Type::builtinFloat(), std::nullopt};
+        case Type::Kind::BOOL: return {Type::builtinBool(), std::nullopt};
+        case Type::Kind::STR: return {Type::builtinStr(), std::nullopt};
         case Type::Kind::EMPTY:
         case Type::Kind::VOID:
         case Type::Kind::CLASS:
+        case Type::Kind::ENUM:
         case Type::Kind::FUNCTION: break;
     }
-    return {nullptr, std::nullopt};
+    return {Type(), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeMemberExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeMemberExpression(
     MemberExpression& expr)
 {
-    auto [objectType, errorObject] = analyzeExpression(*expr.object);
-    if (errorObject) return {nullptr, errorObject};
-
-    if (const auto* objectClass = this->classTable.find(objectType->getName())) {
-        const Type*        paramTypePtr = nullptr;
-        const ClassMember* classMember  = nullptr;
-        const ClassMember* currMember   = nullptr;
-        for (const auto& param : objectClass->constructorParameters) {
-            if (expr.kind == MemberExpression::Kind::PROPERTY && param.name == expr.property) {
-                paramTypePtr = param.type.get();
-            }
-        }
-        const auto* inheritanceChain = this->classTable.getInheritMap(objectType->getName());
-        for (auto cls = inheritanceChain->rbegin(); cls != inheritanceChain->rend(); ++cls) {
-            for (const auto& param : (*cls)->constructorParameters) {
-                if (expr.kind == MemberExpression::Kind::PROPERTY && expr.property == param.name) {
-                    paramTypePtr = param.type.get();
-                }
-            }
-            currMember = (*cls)->containMember(
-                expr.kind == MemberExpression::Kind::PROPERTY ? expr.property : expr.methodName);
-            if (currMember != nullptr) classMember = currMember;
-        }
-        currMember = objectClass->containMember(
-            expr.kind == MemberExpression::Kind::PROPERTY ? expr.property : expr.methodName);
-        if (currMember != nullptr) classMember = currMember;
-        if (classMember == nullptr && paramTypePtr == nullptr) {
-            return {nullptr,
-                    Error(Format("This class {0} does not have a member named {1}",
-                                 objectClass->name,
+    // 枚举值是编译期常量，不对枚举名求值
+    auto* enumName = dyn_cast<IdentifierExpression>(expr.object);
+    auto* symbol   = enumName ? this->symbolTable.find(enumName->name) : nullptr;
+    if (symbol && symbol->kind == SymbolKind::ENUM &&
+        expr.kind == MemberExpression::Kind::PROPERTY) {
+        const auto* enumDecl = this->enumTable.get(symbol->binding.index);
+        auto        it = std::find(enumDecl->values.begin(), enumDecl->values.end(), expr.property);
+        if (it == enumDecl->values.end()) {
+            return {Type(),
+                    Error(Format("Enum {0} does not have a value named {1}",
+                                 enumDecl->name,
                                  expr.property),
                           expr.getLocation())};
         }
-        if (paramTypePtr != nullptr) {
-            return {std::make_unique<Type>(*paramTypePtr), std::nullopt};
-        }
-        if (expr.kind == MemberExpression::Kind::METHOD) {
-            const auto* classMethod = dynamic_cast<const MethodMember*>(classMember);
-            if (expr.arguments.size() != classMethod->function->parameters.size()) {
-                return {
-                    nullptr,
-                    Error(Format(
-                              "Method <{0}> in class <{1}> expects {2} arguments, but {3} provided",
-                              expr.methodName,
-                              objectClass->name,
-                              classMethod->function->parameters.size(),
-                              expr.arguments.size()),
+        enumName->binding = symbol->binding;
+        enumName->setType(symbol->type);
+        expr.binding = {Binding::Kind::ENUM_VALUE, int(it - enumDecl->values.begin())};
+        return {symbol->type, std::nullopt};
+    }
+
+    auto [objectType, errorObject] = analyzeExpression(expr.object);
+    if (errorObject) return {Type(), errorObject};
+
+    const auto* layout = this->classTable.getLayout(objectType);
+    if (layout == nullptr) {
+        return {Type(),
+                Error("This expr is not a class and cannot access members", expr.getLocation())};
+    }
+
+    if (expr.kind == MemberExpression::Kind::PROPERTY) {
+        auto it = layout->fieldIndex.find(expr.property);
+        if (it == layout->fieldIndex.end()) {
+            return {Type(),
+                    Error(Format("This class {0} does not have a member named {1}",
+                                 objectType.getName(),
+                                 expr.property),
                           expr.getLocation())};
-            };
-            for (int i = 0; i < expr.arguments.size(); i++) {
-                const auto& exprArg         = expr.arguments[i];
-                const auto& methodParam     = classMethod->function->parameters[i];
-                auto [exprArgType, exprErr] = analyzeExpression(*exprArg);
-                if (exprErr) return {nullptr, exprErr};
-                if (!this->classTable.checkInherit(exprArgType->getName(),
-                                                   methodParam.type->getName())) {
-                    return {
-                        nullptr,
-                        Error(Format(
-                                  "Cannot convert argument {0} from <{1}> to <{2}> in method <{3}> "
-                                  "of class <{4}>",
-                                  i + 1,
-                                  exprArgType->getName(),
-                                  methodParam.type->getName(),
-                                  expr.methodName,
-                                  objectClass->name),
-                              exprArg->getLocation())};
-                }
-            }
         }
+        expr.binding = {Binding::Kind::FIELD, it->second};
+        this->effectAnalyzer.addPropertyAccess(expr);
+        auto fieldType =
+            std::visit([](const auto* field) { return *field->type; }, layout->fields[it->second]);
+        return {fieldType, std::nullopt};
+    }
 
-        // property return directly
-        return {std::make_unique<Type>(classMember->getType()), std::nullopt};
+    auto it = layout->methodIndex.find(expr.methodName);
+    if (it == layout->methodIndex.end()) {
+        return {Type(),
+                Error(Format("This class {0} does not have a member named {1}",
+                             objectType.getName(),
+                             expr.methodName),
+                      expr.getLocation())};
     }
-    else {
-        return {nullptr,
-                Error("This expr is not a class and cannot access members", expr.getLocation())};
+    const auto* classMethod = layout->methods[it->second].method;
+    if (expr.arguments.size() != classMethod->function->parameters.size()) {
+        return {Type(),
+                Error(Format("Method <{0}> in class <{1}> expects {2} arguments, but {3} provided",
+                             expr.methodName,
+                             objectType.getName(),
+                             classMethod->function->parameters.size(),
+                             expr.arguments.size()),
+                      expr.getLocation())};
+    }
+    for (size_t i = 0; i < expr.arguments.size(); i++) {
+        auto&       exprArg         = expr.arguments[i];
+        const auto& methodParam     = classMethod->function->parameters[i];
+        auto [exprArgType, exprErr] = analyzeExpression(exprArg);
+        if (exprErr) return {Type(), exprErr};
+        if (!this->classTable.checkInherit(exprArgType, *methodParam.type)) {
+            return {Type(),
+                    Error(Format("Cannot convert argument {0} from <{1}> to <{2}> in method <{3}> "
+                                 "of class <{4}>",
+                                 i + 1,
+                                 exprArgType.getName(),
+                                 methodParam.type->getName(),
+                                 expr.methodName,
+                                 objectType.getName()),
+                          exprArg->getLocation())};
+        }
     }
+    // final 方法和 final 类的方法不会被覆盖，不依赖整程序的类层次分析也能直接调用
+    expr.binding     = {Binding::Kind::METHOD, it->second};
+    expr.monomorphic = classMethod->isFinal ||
+                       this->classTable.find(objectType.getName())->isFinal ||
+                       !layout->overridden[it->second];
+    this->effectAnalyzer.addMethodCall(expr);
+    return {classMethod->getType(), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeTypeCheckExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeTypeCheckExpression(
     TypeCheckExpression& expr)
 {
-    // TODO analyzeTypeCheckExpression
-    return {nullptr, Error("Not yet implemented TypeCheckExpression Semantic Check")};
+    auto [objectType, errorObject] = analyzeExpression(expr.expression);
+    if (errorObject) return {Type(), errorObject};
+    resolveType(expr.type);
+    if (!this->classTable.getClassIdRange(objectType)) {
+        return {Type(),
+                Error(Format("Type check requires an object, got '{0}'", objectType.getName()),
+                      expr.getLocation())};
+    }
+    if (!this->classTable.getClassIdRange(*expr.type)) {
+        return {Type(),
+                Error(Format("Type check requires a class, got '{0}'", expr.type->getName()),
+                      expr.getLocation())};
+    }
+    // 静态类型不能确定结果时，读取对象头中的虚表指针，再从全局的虚表读取类编号
+    if (!this->classTable.checkInherit(objectType, *expr.type)) {
+        this->effectAnalyzer.addEffects(Effects::READS_MEMORY | Effects::NON_ARG_MEMORY);
+    }
+    return {Type::builtinBool(), std::nullopt};
 }
 
-std::pair<std::unique_ptr<Type>, std::optional<Error>> SemanticAnalyzer::analyzeUnaryExpression(
+std::pair<Type, std::optional<Error>> SemanticAnalyzer::analyzeUnaryExpression(
     UnaryExpression& expr)
 {
-    auto [operandType, errorOp] = analyzeExpression(*expr.operand);
-    if (errorOp) return {nullptr, errorOp};
+    auto [operandType, errorOp] = analyzeExpression(expr.operand);
+    if (errorOp) return {Type(), errorOp};
 
     switch (expr.op) {
         case UnaryExpression::Operator::NEG:
-            if (!operandType->canMathOp()) {
-                return {nullptr,
+            if (!operandType.canMathOp()) {
+                return {Type(),
                         Error(Format("Unary operator '-' cannot be applied to type '{0}'",
-                                     operandType->getName()),
+                                     operandType.getName()),
                               expr.getLocation())};
             }
-            return {std::make_unique<Type>(std::move(*operandType)), std::nullopt};
+            return {operandType, std::nullopt};
 
         case UnaryExpression::Operator::NOT:
-            if (!operandType->isBool()) {
+            if (!operandType.isBool()) {
                 return {
-                    nullptr,
+                    Type(),
                     Error(Format("Logical negation operator '!' cannot be applied to type '{0}'",
-                                 operandType->getName()),
+                                 operandType.getName()),
                           expr.getLocation())};
             }
-            return {std::make_unique<Type>(std::move(*operandType)), std::nullopt};
+            return {operandType, std::nullopt};
     }
 
-    return {nullptr, std::nullopt};
+    return {Type(), std::nullopt};
 }
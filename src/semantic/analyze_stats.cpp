@@ -2,26 +2,17 @@
 #include "utils/format.hpp"
 std::optional<Error> SemanticAnalyzer::analyzeStatement(Statement& stmt)
 {
-    if (auto* blockStmt = dynamic_cast<BlockStatement*>(&stmt)) {
-        return analyzeBlockStatement(*blockStmt);
-    }
-    else if (auto* exprStmt = dynamic_cast<ExpressionStatement*>(&stmt)) {
-        return analyzeExpressionStatement(*exprStmt);
-    }
-    else if (auto* forStmt = dynamic_cast<ForStatement*>(&stmt)) {
-        return analyzeForStatement(*forStmt);
-    }
-    else if (auto* ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
-        return analyzeIfStatement(*ifStmt);
-    }
-    else if (auto* returnStmt = dynamic_cast<ReturnStatement*>(&stmt)) {
-        return analyzeReturnStatement(*returnStmt);
-    }
-    else if (auto* varStmt = dynamic_cast<VariableStatement*>(&stmt)) {
-        return analyzeVariableStatement(*varStmt);
-    }
-    else if (auto* whenStmt = dynamic_cast<WhenStatement*>(&stmt)) {
-        return analyzeWhenStatement(*whenStmt);
+    switch (stmt.getNodeKind()) {
+        case NodeKind::BLOCK_STMT: return analyzeBlockStatement(*cast<BlockStatement>(&stmt));
+        case NodeKind::EXPRESSION_STMT:
+            return analyzeExpressionStatement(*cast<ExpressionStatement>(&stmt));
+        case NodeKind::FOR_STMT: return analyzeForStatement(*cast<ForStatement>(&stmt));
+        case NodeKind::IF_STMT: return analyzeIfStatement(*cast<IfStatement>(&stmt));
+        case NodeKind::RETURN_STMT: return analyzeReturnStatement(*cast<ReturnStatement>(&stmt));
+        case NodeKind::VARIABLE_STMT:
+            return analyzeVariableStatement(*cast<VariableStatement>(&stmt));
+        case NodeKind::WHEN_STMT: return analyzeWhenStatement(*cast<WhenStatement>(&stmt));
+        default: break;
     }
     return std::nullopt;
 }
@@ -39,26 +30,66 @@ std::optional<Error> SemanticAnalyzer::analyzeBlockStatement(BlockStatement& stm
 
 std::optional<Error> SemanticAnalyzer::analyzeExpressionStatement(ExpressionStatement& stmt)
 {
-    auto [_, error] = analyzeExpression(*stmt.expression);
+    auto [_, error] = analyzeExpression(stmt.expression);
     return error;
 }
 
+// 无参数的迭代协议方法中唯一的语句，末尾的 "return;" 不计
+static const Statement* protocolStatement(const ClassLayout& layout, const std::string& name)
+{
+    auto it = layout.methodIndex.find(name);
+    if (it == layout.methodIndex.end()) return nullptr;
+    const auto* function = layout.methods[it->second].method->function;
+    const auto* block    = dyn_cast<BlockStatement>(function->body);
+    if (!function->parameters.empty() || !block) return nullptr;
+
+    const auto& statements = block->statements;
+    const auto* last = statements.empty() ? nullptr : dyn_cast<ReturnStatement>(statements.back());
+    if (statements.size() == 2 && last && !last->value) return statements[0];
+    return statements.size() == 1 ? statements[0] : nullptr;
+}
+
+// 形如 "name = value;" 的语句
+static const Expression* assignedValue(const Statement* stmt, const std::string& name)
+{
+    const auto* exprStmt = dyn_cast<ExpressionStatement>(stmt);
+    const auto* assign   = exprStmt ? dyn_cast<BinaryExpression>(exprStmt->expression) : nullptr;
+    if (!assign || assign->op != BinaryExpression::Operator::ASSIGN) return nullptr;
+    const auto* target = dyn_cast<IdentifierExpression>(assign->left);
+    return target && target->name == name ? assign->right : nullptr;
+}
+
+static const IdentifierExpression* identifier(const Expression* expr)
+{
+    return dyn_cast<IdentifierExpression>(expr);
+}
+
+static const LiteralExpression* intLiteral(const Expression* expr)
+{
+    const auto* literal = dyn_cast<LiteralExpression>(expr);
+    return literal && std::holds_alternative<int>(literal->value) ? literal : nullptr;
+}
+
 std::optional<Error> SemanticAnalyzer::analyzeForStatement(ForStatement& stmt)
 {
-    auto [iterableType, errorIterableExpr] = analyzeExpression(*stmt.iterable);
+    auto [iterableType, errorIterableExpr] = analyzeExpression(stmt.iterable);
     if (errorIterableExpr) return errorIterableExpr;
     // TODO: 检查iterableType是否可迭代
-    auto iterable = this->classTable.isClassIterable(iterableType->getName());
+    auto iterable = this->classTable.isClassIterable(iterableType.getName());
     if (iterable == nullptr) {
         return Error(Format("Type '{0}' is not iterable - must implement both '_first' and '_next' "
                             "operator methods with matching return types",
-                            iterableType->getName()),
+                            iterableType.getName()),
                      stmt.iterable->getLocation());
     }
+    this->effectAnalyzer.addIteration(*stmt.iterable);
+    detectCountedLoop(stmt);
 
     this->symbolTable.enterScope("for-loop");
     // TODO: get variable type from iterableType
-    this->symbolTable.add(stmt.variable, iterable->second, SymbolKind::VAL);
+    stmt.slot = this->localCount++;
+    this->symbolTable.add(
+        stmt.variable, iterable->second, SymbolKind::VAL, {Binding::Kind::LOCAL, stmt.slot});
 
     auto errorBody = analyzeStatement(*stmt.body);
     if (errorBody) return errorBody;
@@ -66,14 +97,84 @@ std::optional<Error> SemanticAnalyzer::analyzeForStatement(ForStatement& stmt)
     return std::nullopt;
 }
 
+// 计数迭代器：_first 把一个 int 属性置为常量，_next 给它加上正的常量步长，_current 返回它，
+// _end 判断它不小于某个 int 构造参数。迭代对象是这种类的构造调用时，对象只被迭代协议访问，
+// 而这些方法不会修改其他属性，可以不分配对象直接按计数循环生成
+void SemanticAnalyzer::detectCountedLoop(ForStatement& stmt)
+{
+    const auto* call   = dyn_cast<CallExpression>(stmt.iterable);
+    const auto* callee = call ? identifier(call->callee) : nullptr;
+    if (!callee || callee->binding.kind != Binding::Kind::CLASS) return;
+
+    // 包括各个父类在内，构造过程除保存参数和写入字面量外不能有其他副作用
+    const auto* classDecl = this->classTable.getClassById(callee->binding.index);
+    for (const auto* decl = classDecl; decl; decl = this->classTable.find(decl->baseClass)) {
+        for (const auto* arg : decl->baseConstructorArgs) {
+            if (!isa<LiteralExpression>(arg)) return;
+        }
+        for (const auto* member : decl->members) {
+            if (isa<InitBlockMember>(member)) return;
+            const auto* property = dyn_cast<PropertyMember>(member);
+            if (property && property->initializer &&
+                !isa<LiteralExpression>(property->initializer)) {
+                return;
+            }
+        }
+    }
+
+    const auto* layout  = this->classTable.getLayout(Type::classType(classDecl->name));
+    const auto* current = dyn_cast<ReturnStatement>(protocolStatement(*layout, "_current"));
+    const auto* counter = current ? identifier(current->value) : nullptr;
+    const auto* end     = dyn_cast<ReturnStatement>(protocolStatement(*layout, "_end"));
+    const auto* compare = end ? dyn_cast<BinaryExpression>(end->value) : nullptr;
+    if (!counter || !compare || compare->op != BinaryExpression::Operator::GE ||
+        !identifier(compare->left) || identifier(compare->left)->name != counter->name ||
+        !identifier(compare->right)) {
+        return;
+    }
+
+    auto counterField = layout->fieldIndex.find(counter->name);
+    auto boundField   = layout->fieldIndex.find(identifier(compare->right)->name);
+    if (counterField == layout->fieldIndex.end() || boundField == layout->fieldIndex.end()) return;
+    const auto& counterSlot = layout->fields[counterField->second];
+    const auto& boundSlot   = layout->fields[boundField->second];
+    const auto* property    = std::get_if<const PropertyMember*>(&counterSlot);
+    const auto* bound       = std::get_if<const FunctionParameter*>(&boundSlot);
+    if (!property || (*property)->type->getKind() != Type::Kind::INT || !bound ||
+        (*bound)->type->getKind() != Type::Kind::INT) {
+        return;
+    }
+
+    const auto* first = protocolStatement(*layout, "_first");
+    const auto* start = intLiteral(assignedValue(first, counter->name));
+    const auto* next  = dyn_cast<BinaryExpression>(
+        assignedValue(protocolStatement(*layout, "_next"), counter->name));
+    const auto* step = next ? intLiteral(next->right) : nullptr;
+    if (!start || !step || std::get<int>(step->value) <= 0 ||
+        next->op != BinaryExpression::Operator::ADD || !identifier(next->left) ||
+        identifier(next->left)->name != counter->name) {
+        return;
+    }
+
+    // 上界只能是本类的构造参数，父类的参数由基类构造实参给出
+    const auto& params     = classDecl->constructorParameters;
+    size_t      boundIndex = 0;
+    while (boundIndex < params.size() && &params[boundIndex] != *bound) boundIndex++;
+    if (boundIndex == params.size()) return;
+    stmt.countEnd   = boundIndex < call->arguments.size() ? call->arguments[boundIndex]
+                                                          : (*bound)->defaultValue;
+    stmt.countStart = std::get<int>(start->value);
+    stmt.countStep  = std::get<int>(step->value);
+}
+
 std::optional<Error> SemanticAnalyzer::analyzeIfStatement(IfStatement& stmt)
 {
-    auto [conditionType, errorCondition] = analyzeExpression(*stmt.condition);
+    auto [conditionType, errorCondition] = analyzeExpression(stmt.condition);
     if (errorCondition) return errorCondition;
 
-    if (!conditionType->isBool()) {
+    if (!conditionType.isBool()) {
         return Error(
-            Format("If condition must be of type 'bool', got '{0}'", conditionType->getName()),
+            Format("If condition must be of type 'bool', got '{0}'", conditionType.getName()),
             stmt.condition->getLocation());
     }
 
@@ -95,26 +196,30 @@ std::optional<Error> SemanticAnalyzer::analyzeIfStatement(IfStatement& stmt)
 std::optional<Error> SemanticAnalyzer::analyzeReturnStatement(ReturnStatement& stmt)
 {
     if (stmt.value) {
-        auto [actualReturnType, errorReturn] = analyzeExpression(*stmt.value);
+        auto [actualReturnType, errorReturn] = analyzeExpression(stmt.value);
         if (errorReturn) return errorReturn;
         this->currentFunctionReturnTypes.push(
-            std::make_pair(std::move(*actualReturnType), stmt.getLocation()));
+            std::make_pair(std::move(actualReturnType), stmt.getLocation()));
     }
     return std::nullopt;
 }
 
 std::optional<Error> SemanticAnalyzer::analyzeVariableStatement(VariableStatement& stmt)
 {
-    std::unique_ptr<Type> initType = nullptr;
+    if (stmt.immutable && !stmt.initializer) {
+        return Error(Format("Immutable variable '{0}' must be initialized", stmt.name),
+                     stmt.getLocation());
+    }
+    resolveType(stmt.declType);
+    std::optional<Type> initType;
     if (stmt.initializer) {
-        auto [analyzedType, initError] = analyzeExpression(*stmt.initializer);
+        auto [analyzedType, initError] = analyzeExpression(stmt.initializer);
         if (initError) return initError;
-        initType = std::move(analyzedType);
+        initType = analyzedType;
     }
 
     if (stmt.declType) {
-        if (initType != nullptr &&
-            !this->classTable.checkInherit(initType->getName(), stmt.declType->getName())) {
+        if (initType && !this->classTable.checkInherit(*initType, *stmt.declType)) {
             return Error(
                 Format("Cannot initialize variable '{0}' of type '{1}' with value of type '{2}'",
                        stmt.name,
@@ -122,30 +227,38 @@ std::optional<Error> SemanticAnalyzer::analyzeVariableStatement(VariableStatemen
                        initType->getName()),
                 stmt.getLocation());
         }
-        this->symbolTable.add(stmt.name, *stmt.declType, stmt.immutable);
+        stmt.slot = this->localCount++;
+        this->symbolTable.add(
+            stmt.name, *stmt.declType, stmt.immutable, {Binding::Kind::LOCAL, stmt.slot});
     }
     else if (initType) {
-        this->symbolTable.add(stmt.name, *initType, stmt.immutable);
+        stmt.slot = this->localCount++;
+        this->symbolTable.add(
+            stmt.name, *initType, stmt.immutable, {Binding::Kind::LOCAL, stmt.slot});
         // move init type to stmt
-        stmt.declType = std::move(initType);
+        stmt.declType = this->program->arena.create<Type>(*initType);
+        initType.reset();
+    }
+    stmt.initType = initType ? this->program->arena.create<Type>(*initType) : nullptr;
+    if (stmt.immutable && stmt.initializer) {
+        this->constantEvaluator.defineLocal(stmt.slot, *stmt.initializer);
     }
-    stmt.initType = std::move(initType);
     return std::nullopt;
 }
 
 std::optional<Error> SemanticAnalyzer::analyzeWhenStatement(WhenStatement& stmt)
 {
-    auto [subjectType, errorSubject] = analyzeExpression(*stmt.subject);
+    auto [subjectType, errorSubject] = analyzeExpression(stmt.subject);
     if (errorSubject) return errorSubject;
 
-    for (const auto& caseItem : stmt.cases) {
-        auto [caseValueType, errorCase] = analyzeExpression(*caseItem.value);
+    for (auto& caseItem : stmt.cases) {
+        auto [caseValueType, errorCase] = analyzeExpression(caseItem.value);
         if (errorCase) return errorCase;
 
-        if (!this->classTable.checkInherit(caseValueType->getName(), subjectType->getName())) {
+        if (!this->classTable.checkInherit(caseValueType, subjectType)) {
             return Error(Format("Type mismatch in when case: expected '{0}', got '{1}'",
-                                subjectType->getName(),
-                                caseValueType->getName()),
+                                subjectType.getName(),
+                                caseValueType.getName()),
                          caseItem.value->getLocation());
         }
         this->symbolTable.enterScope("when-case");
@@ -153,5 +266,6 @@ std::optional<Error> SemanticAnalyzer::analyzeWhenStatement(WhenStatement& stmt)
         if (errorBody) return errorBody;
         this->symbolTable.exitScope();
     }
+    if (subjectType.isStr()) this->effectAnalyzer.addStringMatch(stmt);
     return std::nullopt;
 }
@@ -0,0 +1,358 @@
+#include "semantic/semantic.hpp"
+#include "utils/builtin.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+// 与生成的 i32 运算保持一致：溢出时按补码回绕
+static int wrapInt(int64_t value)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(value));
+}
+
+// val 不能被重新赋值，之后对它的读取都可以直接替换为初始值
+void ConstantEvaluator::defineLocal(int slot, const Expression& initializer)
+{
+    if (auto value = literalValue(initializer)) constants[slot] = std::move(*value);
+}
+
+// 子表达式在分析时已经折叠过，这里只需检查直接子节点是否都是字面量
+void ConstantEvaluator::fold(Expression*& expr)
+{
+    switch (expr->getNodeKind()) {
+        case NodeKind::IDENTIFIER_EXPR:
+        {
+            const auto& binding = cast<IdentifierExpression>(expr)->binding;
+            if (binding.kind != Binding::Kind::LOCAL) break;
+            auto it = constants.find(binding.index);
+            if (it != constants.end()) replace(expr, it->second);
+            break;
+        }
+        case NodeKind::BINARY_EXPR:
+        {
+            const auto* binary = cast<BinaryExpression>(expr);
+            if (binary->op == BinaryExpression::Operator::ASSIGN) break;
+            auto left = literalValue(*binary->left);
+            if (!left) break;
+            auto right = literalValue(*binary->right);
+            if (!right) break;
+            if (auto value = evaluateBinary(binary->op, *left, *right)) replace(expr, *value);
+            break;
+        }
+        case NodeKind::UNARY_EXPR:
+        {
+            const auto* unary   = cast<UnaryExpression>(expr);
+            auto        operand = literalValue(*unary->operand);
+            if (!operand) break;
+            if (auto value = evaluateUnary(unary->op, *operand)) replace(expr, *value);
+            break;
+        }
+        case NodeKind::CALL_EXPR:
+        {
+            const auto* call    = cast<CallExpression>(expr);
+            const auto& binding = cast<IdentifierExpression>(call->callee)->binding;
+            if (binding.kind != Binding::Kind::FUNCTION) break;
+            std::vector<ConstantValue> args;
+            for (const auto* arg : call->arguments) {
+                auto value = literalValue(*arg);
+                if (!value) return;
+                args.push_back(std::move(*value));
+            }
+            const auto& name = this->functionTable.get(binding.index)->name;
+            if (std::find(BUILTIN::BUILTIN_FUNC.begin(), BUILTIN::BUILTIN_FUNC.end(), name) !=
+                BUILTIN::BUILTIN_FUNC.end()) {
+                if (auto value = evaluateBuiltin(name, args)) replace(expr, *value);
+            }
+            else if (this->budget == 0) {
+                break;
+            }
+            else if (this->deferCalls) {
+                // slots 的栈顶就是 expr 本身
+                PendingCall pending{&expr, {}};
+                pending.ancestors.assign(this->slots.rbegin() + 1, this->slots.rend());
+                this->pendingCalls.push_back(std::move(pending));
+            }
+            else {
+                this->steps = 0;
+                if (auto value = evaluateCall(*call, std::move(args))) replace(expr, *value);
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+int ConstantEvaluator::evaluatePendingCalls()
+{
+    this->deferCalls = false;
+    for (const auto& pending : this->pendingCalls) {
+        auto* folded = pending.slot;
+        fold(*folded);
+        for (auto* ancestor : pending.ancestors) {
+            if (!isa<LiteralExpression>(*folded)) break;
+            fold(*ancestor);
+            folded = ancestor;
+        }
+    }
+    this->pendingCalls.clear();
+    return this->folds;
+}
+
+void ConstantEvaluator::replace(Expression*& expr, const ConstantValue& value)
+{
+    std::variant<int, float, bool, std::string> literal;
+    Type                                        type;
+    if (const auto* i = std::get_if<int>(&value)) {
+        literal = *i;
+        type    = Type::builtinInt();
+    }
+    else if (const auto* b = std::get_if<bool>(&value)) {
+        literal = *b;
+        type    = Type::builtinBool();
+    }
+    else {
+        literal = std::get<std::string>(value);
+        type    = Type::builtinStr();
+    }
+    expr = this->arena.create<LiteralExpression>(expr->getLocation(), type, std::move(literal));
+    folds++;
+}
+
+std::optional<ConstantValue> ConstantEvaluator::literalValue(const Expression& expr) const
+{
+    const auto* literal = dyn_cast<LiteralExpression>(&expr);
+    if (!literal) return std::nullopt;
+    switch (literal->getType().getKind()) {
+        case Type::Kind::INT: return std::get<int>(literal->value);
+        case Type::Kind::BOOL: return std::get<bool>(literal->value);
+        case Type::Kind::STR: return std::get<std::string>(literal->value);
+        default: break;
+    }
+    return std::nullopt;
+}
+
+std::optional<ConstantValue> ConstantEvaluator::evaluateBinary(BinaryExpression::Operator op,
+                                                               const ConstantValue&       left,
+                                                               const ConstantValue&       right) const
+{
+    using Operator = BinaryExpression::Operator;
+
+    if (const auto* l = std::get_if<int>(&left)) {
+        const auto* r = std::get_if<int>(&right);
+        if (!r) return std::nullopt;
+        int64_t a = *l, b = *r;
+        switch (op) {
+            case Operator::ADD: return wrapInt(a + b);
+            case Operator::SUB: return wrapInt(a - b);
+            case Operator::MUL: return wrapInt(a * b);
+            case Operator::DIV:
+            case Operator::MOD:
+                // sdiv/srem 除零或 INT_MIN / -1 在运行时是未定义行为，留给运行时
+                if (b == 0 || (a == INT32_MIN && b == -1)) return std::nullopt;
+                return static_cast<int>(op == Operator::DIV ? a / b : a % b);
+            case Operator::EQ: return a == b;
+            case Operator::NEQ: return a != b;
+            case Operator::LT: return a < b;
+            case Operator::LE: return a <= b;
+            case Operator::GT: return a > b;
+            case Operator::GE: return a >= b;
+            default: break;
+        }
+    }
+    else if (const auto* l = std::get_if<bool>(&left)) {
+        const auto* r = std::get_if<bool>(&right);
+        if (!r) return std::nullopt;
+        switch (op) {
+            case Operator::AND: return *l && *r;
+            case Operator::OR: return *l || *r;
+            case Operator::EQ: return *l == *r;
+            case Operator::NEQ: return *l != *r;
+            default: break;
+        }
+    }
+    else {
+        // 字符串的比较在运行时是指针比较，只折叠拼接
+        const auto& s = std::get<std::string>(left);
+        const auto* t = std::get_if<std::string>(&right);
+        if (!t || op != Operator::ADD) return std::nullopt;
+        if (s.find('\0') != std::string::npos || t->find('\0') != std::string::npos) {
+            return std::nullopt;
+        }
+        return s + *t;
+    }
+    return std::nullopt;
+}
+
+std::optional<ConstantValue> ConstantEvaluator::evaluateUnary(UnaryExpression::Operator op,
+                                                              const ConstantValue& operand) const
+{
+    switch (op) {
+        case UnaryExpression::Operator::NEG:
+            if (const auto* i = std::get_if<int>(&operand)) return wrapInt(-int64_t(*i));
+            break;
+        case UnaryExpression::Operator::NOT:
+            if (const auto* b = std::get_if<bool>(&operand)) return !*b;
+            break;
+    }
+    return std::nullopt;
+}
+
+// 只求值没有副作用、结果与运行时实现一致的内建函数
+std::optional<ConstantValue> ConstantEvaluator::evaluateBuiltin(
+    const std::string& name, const std::vector<ConstantValue>& args) const
+{
+    if (args.size() != 1) return std::nullopt;
+    if (name == "len") {
+        const auto* s = std::get_if<std::string>(&args[0]);
+        if (s && s->find('\0') == std::string::npos) return static_cast<int>(s->size());
+    }
+    else if (name == "int_to_str") {
+        if (const auto* i = std::get_if<int>(&args[0])) return std::to_string(*i);
+    }
+    else if (name == "bool_to_str") {
+        if (const auto* b = std::get_if<bool>(&args[0])) return std::string(*b ? "true" : "false");
+    }
+    return std::nullopt;
+}
+
+std::optional<ConstantValue> ConstantEvaluator::evaluateCall(const CallExpression&      expr,
+                                                             std::vector<ConstantValue> args)
+{
+    const auto& binding = cast<IdentifierExpression>(expr.callee)->binding;
+    if (binding.kind != Binding::Kind::FUNCTION) return std::nullopt;
+
+    const auto* func = this->functionTable.get(binding.index);
+    if (std::find(BUILTIN::BUILTIN_FUNC.begin(), BUILTIN::BUILTIN_FUNC.end(), func->name) !=
+        BUILTIN::BUILTIN_FUNC.end()) {
+        return evaluateBuiltin(func->name, args);
+    }
+    if (!func->body || !func->returnType || depth >= MAX_CALL_DEPTH) return std::nullopt;
+    switch (func->returnType->getKind()) {
+        case Type::Kind::INT:
+        case Type::Kind::BOOL:
+        case Type::Kind::STR: break;
+        default: return std::nullopt;
+    }
+
+    // 默认参数在调用点求值，不能引用任何局部变量
+    Frame callee;
+    callee.locals.resize(func->localCount);
+    auto* saved = std::exchange(this->frame, &callee);
+    for (size_t i = args.size(); i < func->parameters.size(); i++) {
+        auto value = evaluateExpression(*func->parameters[i].defaultValue);
+        if (!value) {
+            this->frame = saved;
+            return std::nullopt;
+        }
+        args.push_back(std::move(*value));
+    }
+    for (size_t i = 0; i < args.size(); i++) {
+        callee.locals[i] = std::move(args[i]);
+    }
+
+    depth++;
+    bool completed = executeStatement(*func->body);
+    depth--;
+    this->frame = saved;
+    if (!completed) return std::nullopt;
+    return callee.returnValue;
+}
+
+std::optional<ConstantValue> ConstantEvaluator::evaluateExpression(const Expression& expr)
+{
+    if (++steps > budget) return std::nullopt;
+
+    switch (expr.getNodeKind()) {
+        case NodeKind::LITERAL_EXPR: return literalValue(expr);
+        case NodeKind::IDENTIFIER_EXPR:
+        {
+            const auto& binding = cast<IdentifierExpression>(&expr)->binding;
+            if (binding.kind != Binding::Kind::LOCAL || !this->frame ||
+                binding.index >= static_cast<int>(this->frame->locals.size())) {
+                return std::nullopt;
+            }
+            return this->frame->locals[binding.index];
+        }
+        case NodeKind::BINARY_EXPR:
+        {
+            const auto* binary = cast<BinaryExpression>(&expr);
+            if (binary->op == BinaryExpression::Operator::ASSIGN) {
+                const auto* target = dyn_cast<IdentifierExpression>(binary->left);
+                if (!target || target->binding.kind != Binding::Kind::LOCAL) return std::nullopt;
+                auto value = evaluateExpression(*binary->right);
+                if (value) this->frame->locals[target->binding.index] = *value;
+                return value;
+            }
+            auto left = evaluateExpression(*binary->left);
+            if (!left) return std::nullopt;
+            auto right = evaluateExpression(*binary->right);
+            if (!right) return std::nullopt;
+            return evaluateBinary(binary->op, *left, *right);
+        }
+        case NodeKind::UNARY_EXPR:
+        {
+            const auto* unary   = cast<UnaryExpression>(&expr);
+            auto        operand = evaluateExpression(*unary->operand);
+            if (!operand) return std::nullopt;
+            return evaluateUnary(unary->op, *operand);
+        }
+        case NodeKind::CALL_EXPR:
+        {
+            const auto*                call = cast<CallExpression>(&expr);
+            std::vector<ConstantValue> args;
+            for (const auto* arg : call->arguments) {
+                auto value = evaluateExpression(*arg);
+                if (!value) return std::nullopt;
+                args.push_back(std::move(*value));
+            }
+            return evaluateCall(*call, std::move(args));
+        }
+        default: break;
+    }
+    return std::nullopt;
+}
+
+// 执行用户函数体中的语句，遇到无法在编译期执行的语句返回 false
+bool ConstantEvaluator::executeStatement(const Statement& stmt)
+{
+    if (++steps > budget) return false;
+
+    switch (stmt.getNodeKind()) {
+        case NodeKind::EXPRESSION_STMT:
+            return evaluateExpression(*cast<ExpressionStatement>(&stmt)->expression).has_value();
+        case NodeKind::BLOCK_STMT:
+            for (const auto* child : cast<BlockStatement>(&stmt)->statements) {
+                if (!executeStatement(*child)) return false;
+                if (this->frame->returnValue) break;
+            }
+            return true;
+        case NodeKind::IF_STMT:
+        {
+            const auto* ifStmt    = cast<IfStatement>(&stmt);
+            auto        condition = evaluateExpression(*ifStmt->condition);
+            const auto* taken     = condition ? std::get_if<bool>(&*condition) : nullptr;
+            if (!taken) return false;
+            if (*taken) return executeStatement(*ifStmt->thenBranch);
+            return !ifStmt->elseBranch || executeStatement(*ifStmt->elseBranch);
+        }
+        case NodeKind::RETURN_STMT:
+        {
+            const auto* returnStmt = cast<ReturnStatement>(&stmt);
+            if (!returnStmt->value) return false;
+            this->frame->returnValue = evaluateExpression(*returnStmt->value);
+            return this->frame->returnValue.has_value();
+        }
+        case NodeKind::VARIABLE_STMT:
+        {
+            const auto* varStmt = cast<VariableStatement>(&stmt);
+            if (!varStmt->initializer) return true;
+            auto value = evaluateExpression(*varStmt->initializer);
+            if (!value) return false;
+            this->frame->locals[varStmt->slot] = std::move(*value);
+            return true;
+        }
+        default: break;
+    }
+    return false;
+}
@@ -0,0 +1,326 @@
+#include "semantic/semantic.hpp"
+
+#include "utils/builtin.hpp"
+
+#include <algorithm>
+
+// 内建函数的副作用，按 std 下 .ll 中的实现给出；没有运行时实现的按全部副作用处理
+static uint8_t builtinEffects(const std::string& name)
+{
+    static const std::unordered_map<std::string, uint8_t> effects = {
+        {"println", Effects::IO},
+        {"print_int", Effects::IO},
+        {"print_str", Effects::IO},
+        {"print_float", Effects::IO},
+        {"print_bool", Effects::IO},
+        {"input", Effects::IO | Effects::ALLOCATES},
+        {"len", Effects::READS_MEMORY},
+        {"int_to_str", Effects::ALLOCATES},
+        {"float_to_str", Effects::ALLOCATES},
+        {"bool_to_str", Effects::ALLOCATES},
+        {"str_to_int", Effects::READS_MEMORY},
+        {"str_to_float", Effects::READS_MEMORY},
+        // 与全局的 "true"/"false" 比较
+        {"str_to_bool", Effects::READS_MEMORY | Effects::NON_ARG_MEMORY},
+        {"_concat_strs", Effects::READS_MEMORY | Effects::ALLOCATES},
+        {"_str_equals", Effects::READS_MEMORY},
+        {"_str_hash", Effects::READS_MEMORY},
+        {"is_null", Effects::NONE},
+        {"_builtin_malloc", Effects::ALLOCATES},
+        // 经数组对象中的 _data 指针访问元素
+        {"_builtin_int_array_insert_impl",
+         Effects::READS_MEMORY | Effects::WRITES_MEMORY | Effects::NON_ARG_MEMORY},
+        {"_builtin_int_array_at_impl", Effects::READS_MEMORY | Effects::NON_ARG_MEMORY},
+    };
+    auto it = effects.find(name);
+    return it == effects.end() ? static_cast<uint8_t>(Effects::ALL) : it->second;
+}
+
+int EffectAnalyzer::functionNode(const FunctionDeclaration* function)
+{
+    auto [it, inserted] = functionNodes.try_emplace(function, nodes.size());
+    if (inserted) nodes.emplace_back();
+    return it->second;
+}
+
+int EffectAnalyzer::constructionNode(int classId)
+{
+    if (constructionNodes.empty()) constructionNodes.assign(classTable.size(), -1);
+    if (constructionNodes[classId] < 0) {
+        constructionNodes[classId] = nodes.size();
+        nodes.emplace_back();
+    }
+    return constructionNodes[classId];
+}
+
+// 静态类型为 classId 的对象上经虚表调用第 methodIndex 个方法：本类的实现，
+// 以及子树中有覆盖时各直接子类上同一调用的结点
+int EffectAnalyzer::dispatchNode(int classId, int methodIndex)
+{
+    auto [it, inserted] =
+        dispatchNodes.try_emplace((int64_t(classId) << 32) | methodIndex, nodes.size());
+    if (!inserted) return it->second;
+    int node = nodes.size();
+    nodes.emplace_back();
+
+    const auto* classDecl = classTable.getClassById(classId);
+    const auto  classType = Type::classType(classDecl->name);
+    const auto* layout    = classTable.getLayout(classType);
+    int         target    = functionNode(layout->methods[methodIndex].method->function);
+    nodes[node].callees.push_back({target, false});
+    if (!layout->overridden[methodIndex]) return node;
+
+    // 先序编号下直接子类依次排列，每个子类的子树之后紧接着下一个子类
+    const auto* range = classTable.getClassIdRange(classType);
+    for (int child = range->id + 1; child <= range->lastDescendant;) {
+        target = dispatchNode(child, methodIndex);
+        nodes[node].callees.push_back({target, false});
+        const auto* childDecl = classTable.getClassById(child);
+        child = classTable.getClassIdRange(Type::classType(childDecl->name))->lastDescendant + 1;
+    }
+    return node;
+}
+
+// 指针类型的值是否可能指向当前函数参数（含 self）所指对象之外的内存
+bool EffectAnalyzer::isForeignPointer(const Expression& expr) const
+{
+    auto kind = expr.getType().getKind();
+    if (kind != Type::Kind::STR && kind != Type::Kind::CLASS) return false;
+    const auto* identifier = dyn_cast<IdentifierExpression>(&expr);
+    if (!identifier) return true;
+    if (identifier->binding.kind == Binding::Kind::SELF) return false;
+    return identifier->binding.kind != Binding::Kind::LOCAL ||
+           identifier->binding.index >= nodes[current].paramCount;
+}
+
+void EffectAnalyzer::addEdge(int target, bool foreignPointers)
+{
+    nodes[current].callees.push_back({target, foreignPointers});
+}
+
+int EffectAnalyzer::enterFunction(FunctionDeclaration& decl)
+{
+    int saved = current;
+    int node  = functionNode(&decl);
+
+    nodes[node].function   = &decl;
+    nodes[node].paramCount = decl.parameters.size();
+    if (std::count(BUILTIN::BUILTIN_FUNC.begin(), BUILTIN::BUILTIN_FUNC.end(), decl.name)) {
+        // 内建函数的占位函数体不记录
+        nodes[node].local = builtinEffects(decl.name);
+        current           = -1;
+    }
+    else {
+        current = node;
+    }
+    return saved;
+}
+
+// 类的构造过程：基类构造参数、属性初始值和 init 块，并先执行父类的构造过程
+int EffectAnalyzer::enterConstruction(int classId)
+{
+    int saved = current;
+    current   = constructionNode(classId);
+
+    const auto* classDecl = classTable.getClassById(classId);
+    if (!classDecl->baseClass.empty()) {
+        const auto* parent = classTable.getClassIdRange(Type::classType(classDecl->baseClass));
+        addEdge(constructionNode(parent->id), false);
+    }
+    return saved;
+}
+
+void EffectAnalyzer::addEffects(uint8_t effects)
+{
+    if (current >= 0) nodes[current].local |= effects;
+}
+
+void EffectAnalyzer::addAssignment(const Expression& target)
+{
+    if (current < 0) return;
+    if (const auto* identifier = dyn_cast<IdentifierExpression>(&target)) {
+        if (identifier->binding.kind == Binding::Kind::FIELD) {
+            addEffects(Effects::WRITES_MEMORY);
+        }
+        else if (identifier->binding.kind == Binding::Kind::LOCAL &&
+                 identifier->binding.index < nodes[current].paramCount &&
+                 isForeignPointer(target)) {
+            // 参数被重新赋值后不再指向调用者传入的对象
+            addEffects(Effects::NON_ARG_MEMORY);
+        }
+    }
+    else if (const auto* member = dyn_cast<MemberExpression>(&target)) {
+        addEffects(Effects::WRITES_MEMORY);
+        if (isForeignPointer(*member->object)) addEffects(Effects::NON_ARG_MEMORY);
+    }
+}
+
+void EffectAnalyzer::addPropertyAccess(const MemberExpression& expr)
+{
+    if (current < 0) return;
+    addEffects(Effects::READS_MEMORY);
+    if (isForeignPointer(*expr.object)) addEffects(Effects::NON_ARG_MEMORY);
+}
+
+void EffectAnalyzer::addCall(const FunctionDeclaration&    callee,
+                             const ArenaSpan<Expression*>& arguments)
+{
+    if (current < 0) return;
+    bool foreign = std::any_of(arguments.begin(), arguments.end(), [this](const Expression* arg) {
+        return isForeignPointer(*arg);
+    });
+    // 省略的参数由默认值提供，不是当前函数的参数
+    for (size_t i = arguments.size(); i < callee.parameters.size(); i++) {
+        auto kind = callee.parameters[i].type->getKind();
+        foreign   = foreign || kind == Type::Kind::STR || kind == Type::Kind::CLASS;
+    }
+    addEdge(functionNode(&callee), foreign);
+}
+
+void EffectAnalyzer::addMethodCall(MemberExpression& expr)
+{
+    if (current < 0) return;
+    bool foreign = isForeignPointer(*expr.object) ||
+                   std::any_of(expr.arguments.begin(),
+                               expr.arguments.end(),
+                               [this](const Expression* arg) { return isForeignPointer(*arg); });
+
+    const auto& objectType = expr.object->getType();
+    if (expr.monomorphic) {
+        const auto* layout = classTable.getLayout(objectType);
+        addEdge(functionNode(layout->methods[expr.binding.index].method->function), foreign);
+        return;
+    }
+    // 从对象头读取虚表指针，再从全局的虚表读取方法指针
+    addEffects(Effects::READS_MEMORY | Effects::NON_ARG_MEMORY);
+    int node = dispatchNode(classTable.getClassIdRange(objectType)->id, expr.binding.index);
+    addEdge(node, foreign);
+    dispatchSites.emplace_back(&expr, node);
+}
+
+void EffectAnalyzer::addConstruction(int classId)
+{
+    if (current < 0) return;
+    addEffects(Effects::ALLOCATES | Effects::WRITES_MEMORY);
+    addEdge(constructionNode(classId), false);
+}
+
+// for 循环直接调用迭代对象静态类型上的 _first/_end/_current/_next
+void EffectAnalyzer::addIteration(const Expression& iterable)
+{
+    if (current < 0) return;
+    addEffects(Effects::MAY_DIVERGE);
+    bool        foreign = isForeignPointer(iterable);
+    const auto* layout  = classTable.getLayout(iterable.getType());
+    for (const char* name : {"_first", "_end", "_current", "_next"}) {
+        auto it = layout->methodIndex.find(name);
+        if (it == layout->methodIndex.end()) continue;
+        addEdge(functionNode(layout->methods[it->second].method->function), foreign);
+    }
+}
+
+// 字符串的 when 经 _str_hash/_str_equals 比较内容
+void EffectAnalyzer::addStringMatch(const WhenStatement& stmt)
+{
+    if (current < 0) return;
+    addEffects(Effects::READS_MEMORY);
+    bool foreign = isForeignPointer(*stmt.subject) ||
+                   std::any_of(stmt.cases.begin(), stmt.cases.end(), [this](const auto& c) {
+                       return isForeignPointer(*c.value);
+                   });
+    if (foreign) addEffects(Effects::NON_ARG_MEMORY);
+}
+
+// 用 Tarjan 算法（非递归）求强连通分量，分量按被调用者在前的顺序产生，逐个求不动点
+void EffectAnalyzer::solve()
+{
+    int                                 count = nodes.size();
+    int                                 order = 0;
+    std::vector<int>                    index(count, -1);
+    std::vector<int>                    lowLink(count, 0);
+    std::vector<int>                    stack;
+    std::vector<bool>                   onStack(count, false);
+    std::vector<std::pair<int, size_t>> work;   // (结点, 下一条要访问的边)
+
+    auto visit = [&](int node) {
+        index[node] = lowLink[node] = order++;
+        stack.push_back(node);
+        onStack[node] = true;
+        work.emplace_back(node, 0);
+    };
+
+    for (int root = 0; root < count; root++) {
+        if (index[root] >= 0) continue;
+        visit(root);
+        while (!work.empty()) {
+            auto [node, next] = work.back();
+            if (next < nodes[node].callees.size()) {
+                work.back().second++;
+                int target = nodes[node].callees[next].target;
+                if (index[target] < 0) {
+                    visit(target);
+                }
+                else if (onStack[target]) {
+                    lowLink[node] = std::min(lowLink[node], index[target]);
+                }
+                continue;
+            }
+            work.pop_back();
+            if (!work.empty()) {
+                int caller      = work.back().first;
+                lowLink[caller] = std::min(lowLink[caller], lowLink[node]);
+            }
+            if (lowLink[node] != index[node]) continue;
+
+            std::vector<int> component;
+            int              member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component.push_back(member);
+            } while (member != node);
+            solveComponent(component);
+        }
+    }
+
+    for (auto& node : nodes) {
+        if (node.function) node.function->effects = node.effects;
+    }
+    for (auto [site, node] : dispatchSites) {
+        site->effects = nodes[node].effects;
+    }
+}
+
+void EffectAnalyzer::solveComponent(const std::vector<int>& component)
+{
+    // 递归调用可能不返回
+    bool recursive = component.size() > 1;
+    for (const auto& edge : nodes[component[0]].callees) {
+        recursive = recursive || edge.target == component[0];
+    }
+    for (int node : component) {
+        nodes[node].effects = nodes[node].local | (recursive ? Effects::MAY_DIVERGE : 0);
+    }
+
+    // 分量外的被调用者已经求出，分量内单调增长直到不变
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int node : component) {
+            uint8_t effects = nodes[node].effects;
+            for (const auto& edge : nodes[node].callees) {
+                uint8_t callee = nodes[edge.target].effects;
+                effects |= callee;
+                if (edge.foreignPointers &&
+                    (callee & (Effects::READS_MEMORY | Effects::WRITES_MEMORY))) {
+                    effects |= Effects::NON_ARG_MEMORY;
+                }
+            }
+            if (effects != nodes[node].effects) {
+                nodes[node].effects = effects;
+                changed             = true;
+            }
+        }
+    }
+}
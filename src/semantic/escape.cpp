@@ -0,0 +1,336 @@
+#include "semantic/semantic.hpp"
+
+#include <utility>
+
+EscapeAnalyzer::EscapeAnalyzer(const ClassTable& classTable)
+    : classTable(classTable)
+    , constructionStates(classTable.size(), State::UNKNOWN)
+    , methodStates(classTable.size())
+    , stackClasses(classTable.size(), false)
+{
+}
+
+int EscapeAnalyzer::analyze(Program& program)
+{
+    for (auto& decl : program.declarations) {
+        // 没有构造调用的函数不会产生候选对象，不必遍历
+        if (auto* funcDecl = dyn_cast<FunctionDeclaration>(decl)) {
+            if (funcDecl->body && funcDecl->allocationSites > 0) analyzeFunction(*funcDecl->body);
+        }
+        else if (auto* classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            for (auto& member : classDecl->members) {
+                if (auto* method = dyn_cast<MethodMember>(member)) {
+                    const auto* function = method->function;
+                    if (function->body && function->allocationSites > 0) {
+                        analyzeFunction(*function->body);
+                    }
+                }
+                else if (auto* init = dyn_cast<InitBlockMember>(member)) {
+                    if (init->allocationSites > 0) analyzeFunction(*init->block);
+                }
+            }
+        }
+    }
+    // 记录到类声明上，IRGen 据此判断方法中的 self 是否可能是栈上对象
+    for (auto& decl : program.declarations) {
+        if (auto* classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            const auto* range = classTable.getClassIdRange(Type::classType(classDecl->name));
+            classDecl->stackAllocated = stackClasses[range->id];
+        }
+    }
+    return stackAllocations;
+}
+
+// 构造过程中 self 是否逃逸：沿继承链检查基类构造参数、构造参数默认值、属性初始值和 init 块，
+// 其中的 self 都是实际类型为 classId 的新对象
+bool EscapeAnalyzer::constructionEscapes(int classId)
+{
+    auto& state = constructionStates[classId];
+    if (state == State::CAPTURED) return false;
+    // 构造过程中又新建同类对象时保守地按逃逸处理
+    if (state != State::UNKNOWN) return true;
+    state = State::VISITING;
+
+    const auto* classDecl = classTable.getClassById(classId);
+    std::vector<const ClassDeclaration*> chain = {classDecl};
+    if (const auto* parents = classTable.getInheritMap(classDecl->name)) {
+        chain.insert(chain.end(), parents->begin(), parents->end());
+    }
+
+    auto saved = std::exchange(context, Context{classId});
+    for (const auto* cls : chain) {
+        for (auto* arg : cls->baseConstructorArgs) {
+            visitExpression(*arg);
+        }
+        for (const auto& param : cls->constructorParameters) {
+            if (param.defaultValue) visitExpression(*param.defaultValue);
+        }
+        for (auto* member : cls->members) {
+            if (auto* property = dyn_cast<PropertyMember>(member)) {
+                if (property->initializer) visitExpression(*property->initializer);
+            }
+            else if (auto* init = dyn_cast<InitBlockMember>(member)) {
+                visitStatement(*init->block);
+            }
+        }
+    }
+    bool escaped = context.selfEscaped;
+    context      = saved;
+
+    constructionStates[classId] = escaped ? State::ESCAPED : State::CAPTURED;
+    return escaped;
+}
+
+// 在实际类型为 classId 的对象上调用 layout 中第 methodIndex 个方法时 self 是否逃逸
+bool EscapeAnalyzer::methodEscapes(int classId, int methodIndex)
+{
+    const auto* classDecl = classTable.getClassById(classId);
+    const auto* layout    = classTable.getLayout(Type::classType(classDecl->name));
+    auto&       states    = methodStates[classId];
+    if (states.empty()) states.assign(layout->methods.size(), State::UNKNOWN);
+
+    if (states[methodIndex] == State::CAPTURED) return false;
+    // 正在检查的方法（self 上的递归调用）保守地按逃逸处理，避免缓存依赖未定结果的结论
+    if (states[methodIndex] != State::UNKNOWN) return true;
+    states[methodIndex] = State::VISITING;
+
+    bool escaped = true;
+    auto* body   = layout->methods[methodIndex].method->function->body;
+    if (body) {
+        auto saved = std::exchange(context, Context{classId});
+        visitStatement(*body);
+        escaped = context.selfEscaped;
+        context = saved;
+    }
+    methodStates[classId][methodIndex] = escaped ? State::ESCAPED : State::CAPTURED;
+    return escaped;
+}
+
+// for 循环会在迭代对象上调用 _first/_end/_current/_next
+bool EscapeAnalyzer::iterationEscapes(int classId)
+{
+    const auto* classDecl = classTable.getClassById(classId);
+    const auto* layout    = classTable.getLayout(Type::classType(classDecl->name));
+    for (const char* name : {"_first", "_end", "_current", "_next"}) {
+        auto it = layout->methodIndex.find(name);
+        if (it == layout->methodIndex.end() || methodEscapes(classId, it->second)) return true;
+    }
+    return false;
+}
+
+// 表达式是否是仍被跟踪的对象（self 或尚未逃逸的候选局部变量），返回其实际类型编号，否则返回 -1
+int EscapeAnalyzer::trackedClass(const Expression& expr) const
+{
+    const auto* identifier = dyn_cast<IdentifierExpression>(&expr);
+    if (!identifier) return -1;
+    if (identifier->binding.kind == Binding::Kind::SELF) {
+        return context.selfEscaped ? -1 : context.selfClassId;
+    }
+    if (identifier->binding.kind == Binding::Kind::LOCAL && context.candidates) {
+        auto it = context.candidates->find(identifier->binding.index);
+        if (it != context.candidates->end() && !it->second.escaped) return it->second.classId;
+    }
+    return -1;
+}
+
+void EscapeAnalyzer::markEscaped(const Expression& expr)
+{
+    const auto* identifier = dyn_cast<IdentifierExpression>(&expr);
+    if (!identifier) return;
+    if (identifier->binding.kind == Binding::Kind::SELF) {
+        context.selfEscaped = true;
+    }
+    else if (identifier->binding.kind == Binding::Kind::LOCAL && context.candidates) {
+        auto it = context.candidates->find(identifier->binding.index);
+        if (it != context.candidates->end()) it->second.escaped = true;
+    }
+}
+
+// 只有在函数体中才改为栈上分配：构造参数和属性初始值在没有 alloca 插入点的构造函数里生成
+void EscapeAnalyzer::markStackAllocated(CallExpression& site)
+{
+    if (!context.candidates || site.stackAllocated) return;
+    site.stackAllocated                = true;
+    stackClasses[allocatedClass(site)] = true;
+    stackAllocations++;
+}
+
+// 表达式是构造调用时返回所构造的类编号，否则返回 -1
+int EscapeAnalyzer::allocatedClass(const Expression& expr) const
+{
+    const auto* call = dyn_cast<CallExpression>(&expr);
+    if (!call) return -1;
+    const auto& binding = cast<IdentifierExpression>(call->callee)->binding;
+    return binding.kind == Binding::Kind::CLASS ? binding.index : -1;
+}
+
+void EscapeAnalyzer::analyzeFunction(Statement& body)
+{
+    std::unordered_map<int, Candidate> candidates;
+
+    auto saved = std::exchange(context, Context{-1, false, &candidates});
+    visitStatement(body);
+    for (auto& [slot, candidate] : candidates) {
+        if (!candidate.escaped) markStackAllocated(*candidate.site);
+    }
+    context = saved;
+}
+
+void EscapeAnalyzer::visitStatement(Statement& stmt)
+{
+    switch (stmt.getNodeKind()) {
+        case NodeKind::EXPRESSION_STMT:
+            visitExpression(*cast<ExpressionStatement>(&stmt)->expression);
+            break;
+        case NodeKind::BLOCK_STMT:
+            for (auto* child : cast<BlockStatement>(&stmt)->statements) {
+                visitStatement(*child);
+            }
+            break;
+        case NodeKind::IF_STMT:
+        {
+            auto* ifStmt = cast<IfStatement>(&stmt);
+            visitExpression(*ifStmt->condition);
+            visitStatement(*ifStmt->thenBranch);
+            if (ifStmt->elseBranch) visitStatement(*ifStmt->elseBranch);
+            break;
+        }
+        case NodeKind::WHEN_STMT:
+        {
+            auto* whenStmt = cast<WhenStatement>(&stmt);
+            visitExpression(*whenStmt->subject);
+            for (auto& c : whenStmt->cases) {
+                visitExpression(*c.value);
+                visitStatement(*c.body);
+            }
+            break;
+        }
+        case NodeKind::FOR_STMT:
+        {
+            auto* forStmt  = cast<ForStatement>(&stmt);
+            auto& iterable = *forStmt->iterable;
+            if (int classId = allocatedClass(iterable); classId >= 0) {
+                auto& call = *cast<CallExpression>(&iterable);
+                for (auto* arg : call.arguments) {
+                    visitExpression(*arg);
+                }
+                if (!constructionEscapes(classId) && !iterationEscapes(classId)) {
+                    markStackAllocated(call);
+                }
+            }
+            else if (int classId = trackedClass(iterable); classId >= 0) {
+                if (iterationEscapes(classId)) markEscaped(iterable);
+            }
+            else {
+                visitExpression(iterable);
+            }
+            visitStatement(*forStmt->body);
+            break;
+        }
+        case NodeKind::RETURN_STMT:
+        {
+            auto* returnStmt = cast<ReturnStatement>(&stmt);
+            if (returnStmt->value) visitExpression(*returnStmt->value);
+            break;
+        }
+        case NodeKind::VARIABLE_STMT:
+        {
+            auto* varStmt = cast<VariableStatement>(&stmt);
+            if (!varStmt->initializer) break;
+            int classId = allocatedClass(*varStmt->initializer);
+            if (classId < 0 || !context.candidates) {
+                visitExpression(*varStmt->initializer);
+                break;
+            }
+            auto* call = cast<CallExpression>(varStmt->initializer);
+            for (auto* arg : call->arguments) {
+                visitExpression(*arg);
+            }
+            if (!constructionEscapes(classId)) {
+                context.candidates->emplace(varStmt->slot, Candidate{call, classId});
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+void EscapeAnalyzer::visitExpression(Expression& expr)
+{
+    switch (expr.getNodeKind()) {
+        case NodeKind::IDENTIFIER_EXPR:
+            // 被跟踪的对象出现在取值的位置（赋给变量、传参、返回、参与运算），视为逃逸
+            markEscaped(expr);
+            break;
+        case NodeKind::BINARY_EXPR:
+        {
+            auto* binary = cast<BinaryExpression>(&expr);
+            if (binary->op == BinaryExpression::Operator::ASSIGN) {
+                if (isa<IdentifierExpression>(binary->left)) {
+                    // 候选局部变量被重新赋值后不再只指向一个对象
+                    markEscaped(*binary->left);
+                }
+                else {
+                    visitExpression(*binary->left);
+                }
+            }
+            else {
+                visitExpression(*binary->left);
+            }
+            visitExpression(*binary->right);
+            break;
+        }
+        case NodeKind::UNARY_EXPR: visitExpression(*cast<UnaryExpression>(&expr)->operand); break;
+        case NodeKind::CALL_EXPR:
+            for (auto* arg : cast<CallExpression>(&expr)->arguments) {
+                visitExpression(*arg);
+            }
+            break;
+        case NodeKind::MEMBER_EXPR: visitMemberExpression(*cast<MemberExpression>(&expr)); break;
+        case NodeKind::METHOD_CALL_EXPR:
+        {
+            auto* call = cast<MethodCallExpression>(&expr);
+            visitExpression(*call->object);
+            for (auto* arg : call->arguments) {
+                visitExpression(*arg);
+            }
+            break;
+        }
+        case NodeKind::ARRAY_EXPR:
+            for (auto* element : cast<ArrayExpression>(&expr)->elements) {
+                visitExpression(*element);
+            }
+            break;
+        case NodeKind::LAMBDA_EXPR: visitExpression(*cast<LambdaExpression>(&expr)->body); break;
+        case NodeKind::TYPE_CHECK_EXPR:
+            visitExpression(*cast<TypeCheckExpression>(&expr)->expression);
+            break;
+        default: break;
+    }
+}
+
+// 访问字段和调用 self 不逃逸的方法不会让接收者逃逸
+void EscapeAnalyzer::visitMemberExpression(MemberExpression& expr)
+{
+    bool isMethod = expr.kind == MemberExpression::Kind::METHOD;
+    auto& object  = *expr.object;
+    if (int classId = allocatedClass(object); classId >= 0) {
+        auto& call = *cast<CallExpression>(&object);
+        for (auto* arg : call.arguments) {
+            visitExpression(*arg);
+        }
+        if (!constructionEscapes(classId) &&
+            !(isMethod && methodEscapes(classId, expr.binding.index))) {
+            markStackAllocated(call);
+        }
+    }
+    else if (int classId = trackedClass(object); classId >= 0) {
+        if (isMethod && methodEscapes(classId, expr.binding.index)) markEscaped(object);
+    }
+    else {
+        visitExpression(object);
+    }
+    for (auto* arg : expr.arguments) {
+        visitExpression(*arg);
+    }
+}
@@ -0,0 +1,263 @@
+#include "semantic/semantic.hpp"
+#include "utils/format.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+void PerfWarning::print() const
+{
+    static const char* costNames[] = {"low", "medium", "high"};
+    std::cerr << (location.filename.empty() ? "" : std::string(location.filename) + ":")
+              << location.line << ":" << location.column << ": ";
+    cout_yellow(Format("warning [{0} cost]: {1}\n", costNames[static_cast<int>(cost)], message));
+    printSourceContext(location, cout_yellow);
+}
+
+std::vector<PerfWarning> PerfLinter::lint(const Program&                  program,
+                                          const std::vector<std::string>& files)
+{
+    for (const auto* decl : program.declarations) {
+        auto filename = decl->getLocation().filename;
+        if (std::find(files.begin(), files.end(), filename) == files.end()) continue;
+
+        if (const auto* funcDecl = dyn_cast<FunctionDeclaration>(decl)) {
+            if (funcDecl->body) lintFunction(*funcDecl->body);
+        }
+        else if (const auto* classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            for (const auto* member : classDecl->members) {
+                if (const auto* method = dyn_cast<MethodMember>(member)) {
+                    if (method->function->body) lintFunction(*method->function->body);
+                }
+                else if (const auto* init = dyn_cast<InitBlockMember>(member)) {
+                    lintFunction(*init->block);
+                }
+            }
+        }
+    }
+    std::stable_sort(
+        warnings.begin(), warnings.end(), [](const PerfWarning& a, const PerfWarning& b) {
+            return std::tie(a.location.filename, a.location.line, a.location.column) <
+                   std::tie(b.location.filename, b.location.line, b.location.column);
+        });
+    return std::move(warnings);
+}
+
+void PerfLinter::report(const Location& location, PerfWarning::Cost cost, std::string message)
+{
+    warnings.push_back({location, cost, std::move(message)});
+}
+
+void PerfLinter::lintFunction(const Statement& body)
+{
+    slotDepths.clear();
+    countedLoopSlots.clear();
+    exactClasses.clear();
+    assignedSlots.clear();
+    lengthSites.clear();
+    visitStatement(body);
+
+    // 字符串不可变，变量没有被重新赋值时 len() 的结果不变
+    for (const auto& [slot, sites] : lengthSites) {
+        if (assignedSlots.count(slot)) continue;
+        for (size_t i = 0; i < sites.size(); i++) {
+            if (sites[i].inLoop) {
+                report(sites[i].location,
+                       PerfWarning::Cost::MEDIUM,
+                       "'len()' rescans a string that does not change inside the loop on every "
+                       "iteration; compute it once before the loop");
+            }
+            else if (i > 0) {
+                report(sites[i].location,
+                       PerfWarning::Cost::MEDIUM,
+                       "repeated 'len()' rescans the same string; reuse the first result");
+            }
+        }
+    }
+}
+
+void PerfLinter::visitStatement(const Statement& stmt)
+{
+    switch (stmt.getNodeKind()) {
+        case NodeKind::EXPRESSION_STMT:
+            visitExpression(*cast<ExpressionStatement>(&stmt)->expression);
+            break;
+        case NodeKind::BLOCK_STMT:
+            for (const auto* child : cast<BlockStatement>(&stmt)->statements) {
+                visitStatement(*child);
+            }
+            break;
+        case NodeKind::IF_STMT:
+        {
+            const auto* ifStmt = cast<IfStatement>(&stmt);
+            visitExpression(*ifStmt->condition);
+            visitStatement(*ifStmt->thenBranch);
+            if (ifStmt->elseBranch) visitStatement(*ifStmt->elseBranch);
+            break;
+        }
+        case NodeKind::WHEN_STMT:
+        {
+            const auto* whenStmt = cast<WhenStatement>(&stmt);
+            visitExpression(*whenStmt->subject);
+            for (const auto& c : whenStmt->cases) {
+                visitExpression(*c.value);
+                visitStatement(*c.body);
+            }
+            break;
+        }
+        case NodeKind::FOR_STMT:
+        {
+            // 迭代对象在进入循环前求值一次，循环变量每次迭代都会改变；
+            // 计数循环不构造迭代对象，只求值其构造参数
+            const auto* forStmt = cast<ForStatement>(&stmt);
+            if (forStmt->countEnd) {
+                for (const auto* arg : cast<CallExpression>(forStmt->iterable)->arguments) {
+                    visitExpression(*arg);
+                }
+                countedLoopSlots.insert(forStmt->slot);
+            }
+            else {
+                visitExpression(*forStmt->iterable);
+            }
+            loopDepth++;
+            slotDepths[forStmt->slot] = loopDepth;
+            assignedSlots.insert(forStmt->slot);
+            visitStatement(*forStmt->body);
+            loopDepth--;
+            break;
+        }
+        case NodeKind::RETURN_STMT:
+        {
+            const auto* returnStmt = cast<ReturnStatement>(&stmt);
+            if (returnStmt->value) visitExpression(*returnStmt->value);
+            break;
+        }
+        case NodeKind::VARIABLE_STMT:
+        {
+            const auto* varStmt = cast<VariableStatement>(&stmt);
+            if (varStmt->initializer) visitExpression(*varStmt->initializer);
+            slotDepths[varStmt->slot] = loopDepth;
+            const auto* call = dyn_cast<CallExpression>(varStmt->initializer);
+            if (varStmt->immutable && call) {
+                const auto& binding = cast<IdentifierExpression>(call->callee)->binding;
+                if (binding.kind == Binding::Kind::CLASS) {
+                    exactClasses[varStmt->slot] = binding.index;
+                }
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+void PerfLinter::visitExpression(const Expression& expr)
+{
+    switch (expr.getNodeKind()) {
+        case NodeKind::BINARY_EXPR:
+        {
+            const auto* binary = cast<BinaryExpression>(&expr);
+            if (binary->op == BinaryExpression::Operator::ASSIGN) {
+                const auto* target = dyn_cast<IdentifierExpression>(binary->left);
+                if (target && target->binding.kind == Binding::Kind::LOCAL) {
+                    assignedSlots.insert(target->binding.index);
+                }
+                else if (!target) {
+                    visitExpression(*binary->left);
+                }
+            }
+            else {
+                visitExpression(*binary->left);
+            }
+            visitExpression(*binary->right);
+            if (binary->op == BinaryExpression::Operator::ADD && expr.getType().isStr() &&
+                loopDepth > 0) {
+                report(expr.getLocation(),
+                       PerfWarning::Cost::HIGH,
+                       "string concatenation inside a loop calls _concat_strs and allocates a "
+                       "new string on every iteration");
+            }
+            break;
+        }
+        case NodeKind::UNARY_EXPR: visitExpression(*cast<UnaryExpression>(&expr)->operand); break;
+        case NodeKind::TYPE_CHECK_EXPR:
+            visitExpression(*cast<TypeCheckExpression>(&expr)->expression);
+            break;
+        case NodeKind::CALL_EXPR: visitCall(*cast<CallExpression>(&expr)); break;
+        case NodeKind::MEMBER_EXPR:
+        {
+            const auto* member = cast<MemberExpression>(&expr);
+            visitExpression(*member->object);
+            for (const auto* arg : member->arguments) {
+                visitExpression(*arg);
+            }
+            if (member->kind == MemberExpression::Kind::METHOD) visitMethodCall(*member);
+            break;
+        }
+        default: break;
+    }
+}
+
+void PerfLinter::visitCall(const CallExpression& expr)
+{
+    for (const auto* arg : expr.arguments) {
+        visitExpression(*arg);
+    }
+    const auto* callee = cast<IdentifierExpression>(expr.callee);
+    if (callee->binding.kind == Binding::Kind::CLASS) {
+        // 逃逸分析改为栈上分配的对象没有堆分配的开销
+        if (loopDepth > 0 && !expr.stackAllocated) {
+            report(expr.getLocation(),
+                   PerfWarning::Cost::HIGH,
+                   Format("constructing '{0}' inside a loop allocates it with gc_alloc on every "
+                          "iteration",
+                          callee->name));
+        }
+        return;
+    }
+    if (callee->binding.kind != Binding::Kind::FUNCTION || callee->name != "len") return;
+    const auto* arg = expr.arguments.size() == 1
+                          ? dyn_cast<IdentifierExpression>(expr.arguments[0])
+                          : nullptr;
+    if (!arg || arg->binding.kind != Binding::Kind::LOCAL) return;
+    auto it     = slotDepths.find(arg->binding.index);
+    int  depth  = it == slotDepths.end() ? 0 : it->second;   // 参数在循环之外
+    lengthSites[arg->binding.index].push_back({expr.getLocation(), loopDepth > depth});
+}
+
+void PerfLinter::visitMethodCall(const MemberExpression& expr)
+{
+    const auto& objectType = expr.object->getType();
+    const auto* layout     = classTable.getLayout(objectType);
+    const auto& method     = layout->methods[expr.binding.index];
+    const auto* receiver   = dyn_cast<IdentifierExpression>(expr.object);
+    bool        local      = receiver && receiver->binding.kind == Binding::Kind::LOCAL;
+
+    if (loopDepth > 0 && method.owner->name == "IntArray" && expr.methodName == "at") {
+        const auto* index = dyn_cast<IdentifierExpression>(expr.arguments[0]);
+        if (index && index->binding.kind == Binding::Kind::LOCAL &&
+            countedLoopSlots.count(index->binding.index)) {
+            report(expr.getLocation(),
+                   PerfWarning::Cost::MEDIUM,
+                   "'IntArray.at' re-checks the index and calls _builtin_int_array_at_impl on "
+                   "every iteration although the index comes from a counted loop");
+        }
+    }
+
+    // 接收者是以构造调用初始化的 val：实际类型已知，按实际类型调用可以绕过虚表
+    if (expr.monomorphic || !local) return;
+    auto it = exactClasses.find(receiver->binding.index);
+    if (it == exactClasses.end()) return;
+    const auto* exactClass  = classTable.getClassById(it->second);
+    const auto* exactLayout = classTable.getLayout(Type::classType(exactClass->name));
+    if (exactLayout->overridden[expr.binding.index] && !exactClass->isFinal &&
+        !exactLayout->methods[expr.binding.index].method->isFinal) {
+        return;
+    }
+    report(expr.getLocation(),
+           PerfWarning::Cost::LOW,
+           Format("call to '{0}.{1}' goes through the vtable although '{2}' is always a '{3}'; "
+                  "declare it as '{3}' to call the method directly",
+                  objectType.getName(),
+                  expr.methodName,
+                  receiver->name,
+                  exactClass->name));
+}
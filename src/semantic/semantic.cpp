@@ -3,25 +3,18 @@
 #include "utils/builtin.hpp"
 #include "utils/format.hpp"
 
-void Scope::add(const std::string& key, Type type, SymbolKind kind)
-{
-    this->map[key] = {type, kind};
-}
+#include <algorithm>
 
-const Type* Scope::findType(const std::string& key)
+void Scope::add(const std::string& key, Symbol symbol)
 {
-    auto it = map.find(key);
-    if (it != map.end()) {
-        return &it->second.first;
-    }
-    return nullptr;
+    this->map[key] = symbol;
 }
 
-const SymbolKind* Scope::findKind(const std::string& key)
+const Symbol* Scope::find(const std::string& key)
 {
     auto it = map.find(key);
     if (it != map.end()) {
-        return &it->second.second;
+        return &it->second;
     }
     return nullptr;
 }
@@ -38,38 +31,39 @@ void SymbolTable::exitScope()
     }
 }
 
-const Type* SymbolTable::findType(const std::string& key)
+const Symbol* SymbolTable::find(const std::string& key)
 {
     for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        const Type* type = it->findType(key);
-        if (type) {
-            return type;
+        const Symbol* symbol = it->find(key);
+        if (symbol) {
+            return symbol;
         }
     }
     return nullptr;
 }
 
+const Type* SymbolTable::findType(const std::string& key)
+{
+    const Symbol* symbol = find(key);
+    return symbol ? &symbol->type : nullptr;
+}
+
 const SymbolKind* SymbolTable::findKind(const std::string& key)
 {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        const SymbolKind* kind = it->findKind(key);
-        if (kind) {
-            return kind;
-        }
-    }
-    return nullptr;
+    const Symbol* symbol = find(key);
+    return symbol ? &symbol->kind : nullptr;
 }
 
-void SymbolTable::add(const std::string& key, const Type& type, SymbolKind kind)
+void SymbolTable::add(const std::string& key, const Type& type, SymbolKind kind, Binding binding)
 {
     if (!scopes.empty()) {
-        scopes.back().add(key, Type(type), kind);
+        scopes.back().add(key, {type, kind, binding});
     }
 }
-void SymbolTable::add(const std::string& key, const Type& type, bool immutable)
+void SymbolTable::add(const std::string& key, const Type& type, bool immutable, Binding binding)
 {
     if (!scopes.empty()) {
-        scopes.back().add(key, Type(type), immutable ? SymbolKind::VAL : SymbolKind::VAR);
+        scopes.back().add(key, {type, immutable ? SymbolKind::VAL : SymbolKind::VAR, binding});
     }
 }
 
@@ -79,7 +73,7 @@ void SymbolTable::debug() const
     for (size_t i = 0; i < scopes.size(); ++i) {
         std::cout << "Scope " << i << " " << scopes[i].getName() << ":\n";
         for (const auto& pair : scopes[i].getMap()) {
-            std::cout << "  Key: " << pair.first << ", Symbol Type: " << pair.second.first.getName()
+            std::cout << "  Key: " << pair.first << ", Symbol Type: " << pair.second.type.getName()
                       << "\n";
         }
     }
@@ -89,6 +83,7 @@ void SymbolTable::debug() const
 void ClassTable::add(const std::string& className, const ClassDeclaration* classDecl)
 {
     classes.insert(std::pair<std::string, const ClassDeclaration*>(className, classDecl));
+    classOrder.push_back(classDecl);
     classIterableMap[className] = {false, Type()};
 }
 
@@ -112,15 +107,142 @@ const std::vector<const ClassDeclaration*>* ClassTable::getInheritMap(
     return iter != inheritMap.end() ? &(iter->second) : nullptr;
 }
 
-bool ClassTable::checkInherit(const std::string& child, const std::string& parent) const
+const ClassIdRange* ClassTable::getClassIdRange(const Type& classType) const
 {
-    if (child == parent) return true;
-    const auto* inheritMap = getInheritMap(child);
-    if (inheritMap == nullptr) return false;
-    for (const auto* inherit : *inheritMap) {
-        if (inherit->name == parent) return true;
+    auto iter = classIdRanges.find(classType);
+    return iter != classIdRanges.end() ? &(iter->second) : nullptr;
+}
+
+const ClassDeclaration* ClassTable::getClassById(int id) const
+{
+    return classesById[id];
+}
+
+const ClassLayout* ClassTable::getLayout(const Type& classType) const
+{
+    auto iter = layouts.find(classType);
+    return iter != layouts.end() ? &(iter->second) : nullptr;
+}
+
+// 在 inheritMap 建好之后调用：按声明顺序对继承森林做一次先序遍历
+void ClassTable::numberClasses()
+{
+    std::unordered_map<std::string, std::vector<const ClassDeclaration*>> children;
+    std::vector<const ClassDeclaration*>                                  roots;
+    for (const auto* classDecl : classOrder) {
+        const auto* parents = getInheritMap(classDecl->name);
+        if (parents == nullptr || parents->empty()) {
+            roots.push_back(classDecl);
+        }
+        else {
+            children[parents->front()->name].push_back(classDecl);
+        }
+    }
+
+    classIdRanges.clear();
+    classesById.assign(classOrder.size(), nullptr);
+    int nextId = 0;
+    // 显式栈，避免很深的继承链递归；second 表示子树是否已经遍历完
+    std::vector<std::pair<const ClassDeclaration*, bool>> stack;
+    for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+        stack.emplace_back(*root, false);
+    }
+    while (!stack.empty()) {
+        auto [classDecl, visited] = stack.back();
+        stack.pop_back();
+        auto& range = classIdRanges[Type::classType(classDecl->name)];
+        if (visited) {
+            range.lastDescendant = nextId - 1;
+            continue;
+        }
+        range.id              = nextId++;
+        classesById[range.id] = classDecl;
+        stack.emplace_back(classDecl, true);
+        auto iter = children.find(classDecl->name);
+        if (iter != children.end()) {
+            for (auto child = iter->second.rbegin(); child != iter->second.rend(); ++child) {
+                stack.emplace_back(*child, false);
+            }
+        }
     }
-    return false;
+}
+
+void ClassTable::buildLayouts()
+{
+    layouts.clear();
+    layouts.reserve(classesById.size());
+    // 先序编号保证父类先于子类，子类布局在父类布局的基础上追加
+    for (const auto* classDecl : classesById) {
+        ClassLayout layout;
+        const auto* parents = getInheritMap(classDecl->name);
+        if (parents != nullptr && !parents->empty()) {
+            layout = layouts.at(Type::classType(parents->front()->name));
+        }
+
+        // 同名字段以最后出现的为准
+        auto addField = [&](ClassField field, const std::string& name) {
+            layout.fieldIndex[name] = layout.fields.size();
+            layout.fields.push_back(field);
+        };
+        for (const auto& param : classDecl->constructorParameters) {
+            addField(&param, param.name);
+        }
+        size_t inheritedMethods = layout.methods.size();
+        for (const auto& member : classDecl->members) {
+            if (const auto* property = dyn_cast<PropertyMember>(member)) {
+                addField(property, property->name);
+            }
+            else if (const auto* method = dyn_cast<MethodMember>(member)) {
+                auto iter = layout.methodIndex.find(method->getName());
+                if (iter != layout.methodIndex.end()) {
+                    layout.methods[iter->second] = {classDecl, method};
+                }
+                else {
+                    layout.methodIndex[method->getName()] = layout.methods.size();
+                    layout.methods.push_back({classDecl, method});
+                }
+            }
+        }
+        // 本类新增的方法按名字排序后追加在父类方法之后
+        std::sort(layout.methods.begin() + inheritedMethods,
+                  layout.methods.end(),
+                  [](const ClassMethod& a, const ClassMethod& b) {
+                      return a.method->getName() < b.method->getName();
+                  });
+        for (size_t i = inheritedMethods; i < layout.methods.size(); i++) {
+            layout.methodIndex[layout.methods[i].method->getName()] = i;
+            layout.vtableSlots.push_back(layout.methods[i].method->isFinal ? -1
+                                                                           : layout.vtableSize++);
+        }
+        layouts.emplace(Type::classType(classDecl->name), std::move(layout));
+    }
+
+    // 类层次分析：逆先序遍历保证子类先于父类处理，把子类中的覆盖情况汇总到父类
+    for (auto iter = classesById.rbegin(); iter != classesById.rend(); ++iter) {
+        const auto* classDecl = *iter;
+        auto&       layout    = layouts.at(Type::classType(classDecl->name));
+        layout.overridden.resize(layout.methods.size(), false);
+
+        const auto* parents = getInheritMap(classDecl->name);
+        if (parents == nullptr || parents->empty()) continue;
+        auto& parentLayout = layouts.at(Type::classType(parents->front()->name));
+        parentLayout.overridden.resize(parentLayout.methods.size(), false);
+        // 父类的方法在子类中下标不变
+        for (size_t i = 0; i < parentLayout.methods.size(); i++) {
+            if (layout.overridden[i] || layout.methods[i].owner != parentLayout.methods[i].owner) {
+                parentLayout.overridden[i] = true;
+            }
+        }
+    }
+}
+
+bool ClassTable::checkInherit(const Type& child, const Type& parent) const
+{
+    if (child == parent) return true;
+    const auto* childRange  = getClassIdRange(child);
+    const auto* parentRange = getClassIdRange(parent);
+    if (childRange == nullptr || parentRange == nullptr) return false;
+    return parentRange->contains(*childRange);
 }
 
 void ClassTable::setClassIterableMap(const std::string& className, bool iterable, const Type& type)
@@ -139,16 +261,67 @@ const std::pair<bool, Type>* ClassTable::isClassIterable(const std::string& clas
     }
 }
 
-void FunctionTable::add(const std::string& functionName, const FunctionDeclaration* functionDecl)
+int FunctionTable::add(const std::string& functionName, const FunctionDeclaration* functionDecl)
 {
-    functions.insert(
-        std::pair<std::string, const FunctionDeclaration*>(functionName, functionDecl));
+    auto [iter, inserted] = functionIds.insert({functionName, functions.size()});
+    if (inserted) functions.push_back(functionDecl);
+    return iter->second;
 }
 
 const FunctionDeclaration* FunctionTable::find(const std::string& functionName)
 {
-    auto iter = functions.find(functionName);
-    return iter != functions.end() ? iter->second : nullptr;
+    auto iter = functionIds.find(functionName);
+    return iter != functionIds.end() ? functions[iter->second] : nullptr;
+}
+
+int EnumTable::add(const std::string& enumName, const EnumDeclaration* enumDecl)
+{
+    auto [iter, inserted] = enumIds.insert({enumName, enums.size()});
+    if (inserted) enums.push_back(enumDecl);
+    return iter->second;
+}
+
+const EnumDeclaration* EnumTable::find(const std::string& enumName) const
+{
+    auto iter = enumIds.find(enumName);
+    return iter != enumIds.end() ? enums[iter->second] : nullptr;
+}
+
+// 语法分析时类型名一律当作类名，是枚举名时改为枚举类型
+void SemanticAnalyzer::resolveType(Type* type) const
+{
+    if (type && type->getKind() == Type::Kind::CLASS && this->enumTable.find(type->getName())) {
+        *type = Type::enumType(type->getName());
+    }
+}
+
+// 函数、构造参数和属性的类型在分析任何函数体之前确定
+void SemanticAnalyzer::resolveSignatureTypes()
+{
+    auto resolveFunction = [this](FunctionDeclaration& function) {
+        for (auto& param : function.parameters) {
+            resolveType(param.type);
+        }
+        resolveType(function.returnType);
+    };
+    for (auto& decl : program->declarations) {
+        if (auto funcDecl = dyn_cast<FunctionDeclaration>(decl)) {
+            resolveFunction(*funcDecl);
+        }
+        else if (auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            for (auto& param : classDecl->constructorParameters) {
+                resolveType(param.type);
+            }
+            for (auto& member : classDecl->members) {
+                if (auto property = dyn_cast<PropertyMember>(member)) {
+                    resolveType(property->type);
+                }
+                else if (auto method = dyn_cast<MethodMember>(member)) {
+                    resolveFunction(*method->function);
+                }
+            }
+        }
+    }
 }
 
 std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::analyze()
@@ -156,28 +329,39 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::anal
     bool mainFlag = false;
     this->symbolTable.enterScope("global");
     for (const auto& decl : program->declarations) {
-        if (const auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
+        if (const auto funcDecl = dyn_cast<FunctionDeclaration>(decl)) {
             if (funcDecl->name == "main") {
                 mainFlag = true;
             }
         }
-        else if (const auto classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
-            if (this->classTable.find(classDecl->name)) {
+        else if (const auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            if (this->classTable.find(classDecl->name) || this->enumTable.find(classDecl->name)) {
                 return {nullptr,
                         Error(Format("Class '{0}' is already defined", classDecl->name),
                               classDecl->getLocation())};
             }
             this->classTable.add(classDecl->name, classDecl);
-            this->symbolTable.add(
-                classDecl->name, Type::classType(classDecl->name), SymbolKind::CLASS);
+        }
+        else if (const auto enumDecl = dyn_cast<EnumDeclaration>(decl)) {
+            if (this->classTable.find(enumDecl->name) || this->enumTable.find(enumDecl->name)) {
+                return {nullptr,
+                        Error(Format("Enum '{0}' is already defined", enumDecl->name),
+                              enumDecl->getLocation())};
+            }
+            int id = this->enumTable.add(enumDecl->name, enumDecl);
+            this->symbolTable.add(enumDecl->name,
+                                  Type::enumType(enumDecl->name),
+                                  SymbolKind::ENUM,
+                                  {Binding::Kind::ENUM, id});
         }
     }
     if (!mainFlag) {
         return {nullptr, Error("Program requires a 'main' function")};
     }
+    this->resolveSignatureTypes();
 
     for (auto& decl : program->declarations) {
-        if (auto classDecl = dynamic_cast<ClassDeclaration*>(decl.get())) {
+        if (auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
             if (classDecl->baseClass.empty() && classDecl->name != BUILTIN::BUILTIN_CLASS[0]) {
                 classDecl->baseClass = BUILTIN::BUILTIN_CLASS[0];
             }
@@ -186,12 +370,14 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::anal
 
     // check inheritance
     for (const auto& decl : program->declarations) {
-        if (const auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
-            this->functionTable.add(funcDecl->name, funcDecl);
-            this->symbolTable.add(
-                funcDecl->name, Type::functionType(funcDecl->name), SymbolKind::FUNC);
+        if (const auto funcDecl = dyn_cast<FunctionDeclaration>(decl)) {
+            int id = this->functionTable.add(funcDecl->name, funcDecl);
+            this->symbolTable.add(funcDecl->name,
+                                  Type::functionType(funcDecl->name),
+                                  SymbolKind::FUNC,
+                                  {Binding::Kind::FUNCTION, id});
         }
-        else if (const auto classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
+        else if (const auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
             std::vector<const ClassDeclaration*> parents;
             std::string                          currParent = classDecl->baseClass;
             while (1) {
@@ -222,12 +408,24 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::anal
             this->classTable.addInheritMap(classDecl->name, std::move(parents));
         }
     }
+    this->classTable.numberClasses();
+    this->classTable.buildLayouts();
+    for (const auto& decl : program->declarations) {
+        if (const auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
+            auto classType = Type::classType(classDecl->name);
+            this->symbolTable.add(classDecl->name,
+                                  classType,
+                                  SymbolKind::CLASS,
+                                  {Binding::Kind::CLASS,
+                                   this->classTable.getClassIdRange(classType)->id});
+        }
+    }
 
     // cat -> Dog -> animal
     for (const auto& decl : program->declarations) {
-        if (const auto classDecl = dynamic_cast<const ClassDeclaration*>(decl.get())) {
+        if (const auto classDecl = dyn_cast<ClassDeclaration>(decl)) {
             for (const auto& member : classDecl->members) {
-                if (const auto property = dynamic_cast<const PropertyMember*>(member.get())) {
+                if (const auto property = dyn_cast<PropertyMember>(member)) {
                     if (auto error = checkPropertyConstructorConflict(property, classDecl)) {
                         return {nullptr, *error};
                     }
@@ -241,15 +439,14 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::anal
             }
             for (const auto& member : classDecl->members) {
                 for (const auto& parentClass : *parents) {
-                    const ClassMember* parentMember = parentClass->containMember(member.get());
-                    if (const auto method = dynamic_cast<const MethodMember*>(member.get())) {
+                    const ClassMember* parentMember = parentClass->containMember(member);
+                    if (const auto method = dyn_cast<MethodMember>(member)) {
                         if (auto error = validateMethodOverride(
                                 method, parentMember, classDecl, parentClass)) {
                             return {nullptr, *error};
                         }
                     }
-                    else if (const auto property =
-                                 dynamic_cast<const PropertyMember*>(member.get())) {
+                    else if (const auto property = dyn_cast<PropertyMember>(member)) {
                         if (auto error = checkPropertyConstructorConflict(property, parentClass)) {
                             return {nullptr, *error};
                         }
@@ -268,6 +465,9 @@ std::pair<std::unique_ptr<Program>, std::optional<Error>> SemanticAnalyzer::anal
         if (errorDecl) return {nullptr, errorDecl};
     }
     this->symbolTable.exitScope();
+    this->constantEvaluator.evaluatePendingCalls();
+    this->effectAnalyzer.solve();
+    EscapeAnalyzer(this->classTable).analyze(*program);
     return {std::move(program), std::nullopt};
 }
 
@@ -277,7 +477,7 @@ std::optional<Error> SemanticAnalyzer::validateMethodOverride(const MethodMember
                                                               const ClassDeclaration* parentClass)
 {
     if (!parentMember) return std::nullopt;
-    const auto parentMethod = dynamic_cast<const MethodMember*>(parentMember);
+    const auto parentMethod = dyn_cast<MethodMember>(parentMember);
     if (!parentMethod) {
         return Error(
             Format("Type mismatch: '{0}' is a property in parent class but a method in class '{1}'",
@@ -293,7 +493,7 @@ std::optional<Error> SemanticAnalyzer::validateMethodOverride(const MethodMember
                             parentClass->name),
                      method->getLocation());
     }
-    if (!method->function->checkParam(parentMethod->function.get())) {
+    if (!method->function->checkParam(parentMethod->function)) {
         return Error(Format("Method override error: parameter types in '{0}::{1}' don't match "
                             "parent class '{2}'",
                             classDecl->name,
@@ -302,7 +502,7 @@ std::optional<Error> SemanticAnalyzer::validateMethodOverride(const MethodMember
                      method->getLocation());
     }
 
-    if (!method->function->checkReturnType(parentMethod->function.get())) {
+    if (!method->function->checkReturnType(parentMethod->function)) {
         return Error(
             Format(
                 "Method override error: return type of '{0}::{1}' doesn't match parent class '{2}'",
@@ -321,7 +521,7 @@ std::optional<Error> SemanticAnalyzer::validatePropertyOverride(const PropertyMe
                                                                 const ClassDeclaration* parentClass)
 {
     if (!parentMember) return std::nullopt;
-    const auto parentProperty = dynamic_cast<const PropertyMember*>(parentMember);
+    const auto parentProperty = dyn_cast<PropertyMember>(parentMember);
     if (!parentProperty) {
         return Error(
             Format("Type mismatch: '{0}' is a method in parent class but a property in class '{1}'",
@@ -355,7 +555,7 @@ std::optional<Error> SemanticAnalyzer::checkClassOperator(const ClassDeclaration
     Type currentReturnType;
 
     for (const auto& member : classDecl->members) {
-        if (const auto method = dynamic_cast<const MethodMember*>(member.get())) {
+        if (const auto method = dyn_cast<MethodMember>(member)) {
             if (method->function->isOperator) {
                 if (method->function->name == "_first") {
                     hasFirst        = true;
@@ -3,6 +3,7 @@
 #include "ir/ir.hpp"
 #include "lexer/lexer.hpp"
 #include "lexer/token.hpp"
+#include "lexer/token_stream.hpp"
 #include "parser/parser.hpp"
 #include "semantic/semantic.hpp"
 
@@ -73,36 +74,25 @@ std::string readFile(const std::string& filepath)
 }
 
 void processFiles(const std::vector<std::string>& stdLibFiles,
-                  const std::vector<std::string>& userFiles)
+                  const std::vector<std::string>& userFiles, const CompileOptions& options)
 {
     std::vector<std::string> filepaths;
     filepaths.reserve(stdLibFiles.size() + userFiles.size());
     filepaths.insert(filepaths.end(), stdLibFiles.begin(), stdLibFiles.end());
     filepaths.insert(filepaths.end(), userFiles.begin(), userFiles.end());
 
-    std::vector<Token> tokens;
-    cout_pink("  [1/6] Lexical analysis... ");
-    for (int i = 0; i < filepaths.size(); i++) {
-        auto        filename = filepaths[i];
-        std::string source   = readFile(filename);
-        Lexer       lexer(source, filename);
-        auto [currTokens, lexerError] = lexer.tokenize();
-        if (i != filepaths.size() - 1) {
-            currTokens.pop_back();
-        }
-        if (lexerError) {
-            cout_red("Failed");
-            std::cout << std::endl;
-            lexerError->print();
-            return;
-        }
-        tokens.insert(tokens.end(), currTokens.begin(), currTokens.end());
+    // 词法分析与语法分析合并为一遍：Parser 通过 TokenStream 按需从各文件的 Lexer 拉取 token
+    cout_pink("  [1/6] Reading sources... ");
+    std::vector<Lexer> lexers;
+    lexers.reserve(filepaths.size());
+    for (const auto& filename : filepaths) {
+        lexers.emplace_back(readFile(filename), filename);
     }
     cout_green("Passed");
     std::cout << std::endl;
 
-    cout_pink("  [2/6] Syntax analysis...  ");
-    Parser parser(tokens);
+    cout_pink("  [2/6] Lexical & syntax analysis...  ");
+    Parser parser{TokenStream(std::move(lexers))};
     auto [program, parserError] = parser.parse();
     if (parserError) {
         cout_red("Failed");
@@ -114,7 +104,7 @@ void processFiles(const std::vector<std::string>& stdLibFiles,
     std::cout << std::endl;
 
     cout_pink("  [3/6] Semantic analysis... ");
-    SemanticAnalyzer semanticAnalyzer(std::move(program));
+    SemanticAnalyzer semanticAnalyzer(std::move(program), options.constEvalBudget);
     auto [resolveProgram, semanticError] = semanticAnalyzer.analyze();
     if (semanticError) {
         cout_red("Failed");
@@ -125,6 +115,15 @@ void processFiles(const std::vector<std::string>& stdLibFiles,
     cout_green("Passed");
     std::cout << std::endl;
 
+    if (options.perfLint) {
+        auto classTable = semanticAnalyzer.getClassTable();
+        auto warnings   = PerfLinter(classTable).lint(*resolveProgram, userFiles);
+        for (const auto& warning : warnings) {
+            warning.print();
+        }
+        cout_yellow(Format("  {0} performance warning(s)\n", warnings.size()));
+    }
+
     // std::cout << resolveProgram->dump() << std::endl;
 
     cout_pink("  [4/6] LLVM IR generating... ");
@@ -134,6 +133,9 @@ void processFiles(const std::vector<std::string>& stdLibFiles,
     auto  llvmIR = irGen.generateIR();
     cout_green("Passed");
     std::cout << std::endl;
+    if (options.printLayouts) {
+        irGen.printLayouts(userFiles);
+    }
     std::string          outputFilename = "./output.ll";
     std::error_code      EC;
     llvm::raw_fd_ostream outFile(outputFilename, EC);
@@ -198,7 +200,14 @@ void printUsage(const char* programName)
                         " --dir <directory>    Process all files in a directory\n"
                         "  " +
                         std::string(programName) +
-                        " --files <file1> <file2> ...    Process multiple specific files\n";
+                        " --files <file1> <file2> ...    Process multiple specific files\n"
+                        "Options:\n"
+                        "  --const-eval-budget <steps>    Max steps to evaluate one constant call "
+                        "(0 disables evaluating user functions)\n"
+                        "  --perf-lint                    Report code patterns that are costly "
+                        "at runtime\n"
+                        "  --print-layouts                Print the field layout of each class and "
+                        "the bytes saved by reordering\n";
     cout_yellow(usage);
 }
 
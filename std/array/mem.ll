@@ -19,8 +19,8 @@
 ; SOFTWARE.
 
 ; for convenience
-%vTable_IntArray.local = type { void(i8*)*, %IntArray.local*(i8*, i32)*, %IntArray.local*(i32)*, void(i8*)*, i32(i8*, i32)*, i32(i8*)*, i1(i8*)*, void(i8*, i32)*, i32(i8*)*, void(i8*, i32)*, i32(i8*)* }
-%IntArray.local = type { %vTable_IntArray.local*, i32, i32, i32, i8*, i32 }
+%vTable_IntArray.local = type { i32, i32, i32, i32(i8*, i32)*, i32(i8*)*, i1(i8*)*, void(i8*, i32)*, i32(i8*)*, void(i8*, i32)*, i32(i8*)* }
+%IntArray.local = type { %vTable_IntArray.local*, i8*, i32, i32 }
 
 declare i8* @gc_alloc(i64)
 
@@ -34,9 +34,9 @@ entry:
 define void @_builtin_int_array_insert_impl(i8* %0, i32 %element) { 
 entry: 
   %self1 = bitcast i8* %0 to %IntArray.local* 
-  %_data_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 4 
+  %_data_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 1 
   %_data = load i8*, i8** %_data_ptr, align 4 
-  %_size_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 5 
+  %_size_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 3 
   %_size = load i32, i32* %_size_ptr, align 4 
   %byte_offset = mul i32 %_size, 4 
   %insert_ptr = getelementptr inbounds i8, i8* %_data, i32 %byte_offset 
@@ -48,7 +48,7 @@ entry:
 define i32 @_builtin_int_array_at_impl(i8* %0, i32 %index) { 
 entry: 
   %self1 = bitcast i8* %0 to %IntArray.local* 
-  %_data_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 4 
+  %_data_ptr = getelementptr inbounds %IntArray.local, %IntArray.local* %self1, i32 0, i32 1 
   %_data = load i8*, i8** %_data_ptr, align 4 
   %byte_offset = mul i32 %index, 4 
   %at_ptr = getelementptr inbounds i8, i8* %_data, i32 %byte_offset 
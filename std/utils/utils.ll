@@ -99,6 +99,57 @@ copy_strings:                                     ; preds = %both_valid
   ret i8* %result
 }
 
+define i1 @_str_equals(i8* %str1, i8* %str2) {
+entry:
+  %same = icmp eq i8* %str1, %str2
+  br i1 %same, label %return_true, label %check_null
+
+check_null:                                       ; preds = %entry
+  %str1_null = icmp eq i8* %str1, null
+  %str2_null = icmp eq i8* %str2, null
+  %any_null = or i1 %str1_null, %str2_null
+  br i1 %any_null, label %return_false, label %compare
+
+compare:                                          ; preds = %check_null
+  %cmp = call i32 @strcmp(i8* %str1, i8* %str2)
+  %is_equal = icmp eq i32 %cmp, 0
+  ret i1 %is_equal
+
+return_true:                                      ; preds = %entry
+  ret i1 true
+
+return_false:                                     ; preds = %check_null
+  ret i1 false
+}
+
+
+; FNV-1a, the seed is chosen by the compiler for string when statements
+define i32 @_str_hash(i8* %str, i32 %seed) {
+entry:
+  %str_null = icmp eq i8* %str, null
+  br i1 %str_null, label %done, label %loop
+
+loop:                                             ; preds = %body, %entry
+  %index = phi i64 [ 0, %entry ], [ %next_index, %body ]
+  %hash = phi i32 [ %seed, %entry ], [ %next_hash, %body ]
+  %char_ptr = getelementptr inbounds i8, i8* %str, i64 %index
+  %char = load i8, i8* %char_ptr, align 1
+  %is_end = icmp eq i8 %char, 0
+  br i1 %is_end, label %done, label %body
+
+body:                                             ; preds = %loop
+  %byte = zext i8 %char to i32
+  %mixed = xor i32 %hash, %byte
+  %next_hash = mul i32 %mixed, 16777619
+  %next_index = add i64 %index, 1
+  br label %loop
+
+done:                                             ; preds = %loop, %entry
+  %result = phi i32 [ %seed, %entry ], [ %hash, %loop ]
+  ret i32 %result
+}
+
+
 define i8* @int_to_str(i32 %value) {
 entry:
   %buffer = call noalias i8* @gc_alloc(i64 32)